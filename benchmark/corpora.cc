@@ -0,0 +1,188 @@
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "../src/json_document.h"
+#include "../src/json_parser.h"
+
+// Benchmarks of the parser on the usual JSON corpora, and on generated inputs
+// which stress one kind of value, each reported in bytes of input per second,
+// as separate phases:
+//
+//   parse/<corpus>    parsing into a reused JsonDocument
+//   access/<corpus>   visiting every value of the parsed document
+//   destroy/<corpus>  destroying a value parsed on the heap
+//
+// The corpora are read from the directory given as the first argument,
+// test_data/benchmark by default, and the ones which are missing are
+// skipped. To track regressions, save the results as JSON, and compare two
+// runs with the compare.py tool of Google Benchmark:
+//
+//   benchmark_corpora ~/corpora --benchmark_out=results.json
+//       --benchmark_out_format=json
+
+namespace {
+
+const char* const kCorpora[][2] = {
+    {"twitter", "twitter.json"},
+    {"canada", "canada.json"},
+    {"citm", "citm_catalog.json"},
+    {"gsoc", "gsoc-2018.json"},
+};
+
+// Records with long strings, some of them escaped or not ASCII
+std::string MakeStrings() {
+  std::mt19937 gen(1);
+  const char* const words[] = {"lorem",   "ipsum",      "dolor",
+                               "sit",     "amet",       "\\\"quoted\\\"",
+                               "tab\\t",  "\xc3\xa9t\xc3\xa9", "\\u00e9",
+                               "\xe6\x97\xa5\xe6\x9c\xac"};
+  std::string out = "[";
+  for (size_t i = 0; i < 20000; ++i) {
+    out += i ? ", " : "";
+    out += "{\"title\": \"";
+    for (size_t j = 0, n = 5 + gen() % 50; j < n; ++j) {
+      out += j ? " " : "";
+      out += words[gen() % 10];
+    }
+    out += "\", \"tags\": [\"a\", \"bb\", \"ccc\"]}";
+  }
+  return out + "]";
+}
+
+// Arrays of coordinates, as doubles and integers, like canada.json
+std::string MakeNumbers() {
+  std::mt19937 gen(2);
+  std::uniform_real_distribution<double> coordinate(-180, 180);
+  std::string out = "[";
+  char buffer[80];
+  for (size_t i = 0; i < 100000; ++i) {
+    std::snprintf(buffer, sizeof(buffer), "%s[%.15g, %.15g, %u]",
+                  i ? ", " : "", coordinate(gen), coordinate(gen),
+                  static_cast<unsigned>(gen() % 100000));
+    out += buffer;
+  }
+  return out + "]";
+}
+
+// Arrays and objects nested 500 deep, many times over
+std::string MakeNested() {
+  std::string out = "[";
+  for (size_t i = 0; i < 200; ++i) {
+    out += i ? ", " : "";
+    for (size_t depth = 0; depth < 500; ++depth) {
+      out += depth % 2 ? "{\"a\": " : "[1, ";
+    }
+    out += "null";
+    for (size_t depth = 500; depth-- > 0;) {
+      out += depth % 2 ? "}" : "]";
+    }
+  }
+  return out + "]";
+}
+
+bool ReadFile(const std::string& file_name, std::string* out) {
+  std::ifstream in(file_name, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  out->assign(std::istreambuf_iterator<char>(in),
+              std::istreambuf_iterator<char>());
+  return true;
+}
+
+// Visits every value, like code which reads the whole document would
+size_t Visit(const jp::JsonValue& val) {
+  switch (val.type()) {
+    case jp::JsonValue::OBJECT: {
+      size_t n = 1;
+      for (const auto& member : val.getObject()) {
+        n += member.first.size() + Visit(member.second);
+      }
+      return n;
+    }
+    case jp::JsonValue::ARRAY: {
+      size_t n = 1;
+      for (const jp::JsonValue& element : val.getArray()) {
+        n += Visit(element);
+      }
+      return n;
+    }
+    case jp::JsonValue::STRING:
+      return val.getString().size();
+    case jp::JsonValue::NUMBER:
+      return val.getNumber() > 0;
+    case jp::JsonValue::BOOL:
+      return val.getBool();
+    default:
+      return 1;
+  }
+}
+
+void Parse(benchmark::State& state, const std::string& json) {
+  jp::JsonDocument doc;
+  while (state.KeepRunning()) {
+    doc.Parse(json);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+void Access(benchmark::State& state, const std::string& json) {
+  jp::JsonDocument doc;
+  const jp::JsonValue& root = doc.Parse(json);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(Visit(root));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+void Destroy(benchmark::State& state, const std::string& json) {
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    jp::JsonValue val = jp::JsonParser{json}.Parse();
+    state.ResumeTiming();
+    val = jp::JsonValue();
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+void Register(const std::string& name, const std::string& json) {
+  using Phase = void (*)(benchmark::State&, const std::string&);
+  const std::pair<const char*, Phase> phases[] = {
+      {"parse/", Parse}, {"access/", Access}, {"destroy/", Destroy}};
+  for (const auto& phase : phases) {
+    const auto fn = phase.second;
+    benchmark::RegisterBenchmark(
+        (phase.first + name).c_str(),
+        [fn, json](benchmark::State& state) { fn(state, json); });
+  }
+}
+}
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  // the flags of the benchmark library are removed, but not the unknown ones
+  if ((argc > 1 && argv[1][0] == '-') || argc > 2) {
+    benchmark::ReportUnrecognizedArguments(argc, argv);
+    return 1;
+  }
+  const std::string dir = argc > 1 ? argv[1] : "test_data/benchmark";
+  for (const auto& corpus : kCorpora) {
+    std::string json;
+    if (ReadFile(dir + "/" + corpus[1], &json)) {
+      Register(corpus[0], json);
+    } else {
+      std::fprintf(stderr, "skipping %s, %s/%s not found\n", corpus[0],
+                   dir.c_str(), corpus[1]);
+    }
+  }
+  Register("strings", MakeStrings());
+  Register("numbers", MakeNumbers());
+  Register("nested", MakeNested());
+  benchmark::RunSpecifiedBenchmarks();
+}
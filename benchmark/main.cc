@@ -1,9 +1,32 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <new>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 
+#include "../src/document_cache.h"
+#include "../src/dom_builder.h"
+#include "../src/gzip_reader.h"
+#include "../src/json_bind.h"
+#include "../src/json_cursor.h"
+#include "../src/json_document.h"
 #include "../src/json_parser.h"
+#include "../src/json_paths.h"
+#include "../src/json_tape.h"
+#include "../src/json_writer.h"
+#include "../src/mapped_file.h"
+#include "../src/minify.h"
+#include "../src/ndjson_reader.h"
+#include "../src/parallel_parser.h"
+#include "../src/push_parser.h"
+#include "../src/structural_index.h"
+#include "../src/utf8.h"
 #include "nlohmann/json.hpp"
 #include "cpprest/json.h"
 #include "json/json.h"
@@ -23,21 +46,596 @@
  *
  */
 
-// file's size is 1.7 MB and it contains lot of numbers
-static std::ifstream file("test_data/benchmark/citm_catalog.json");
+// file's size is 1.7 MB and it contains lot of numbers. benchmark/corpora.cc
+// runs the parser on the other usual corpora.
+static const char kFileName[] = "test_data/benchmark/citm_catalog.json";
+static std::ifstream file(kFileName);
 static const std::string e((std::istreambuf_iterator<char>(file)),
                            std::istreambuf_iterator<char>());
 
+// Counts every call to operator new, to compare the number of allocations
+// made by the parsers
+static std::atomic<size_t> num_allocs{0};
+
+void* operator new(size_t size) {
+  ++num_allocs;
+  if (void* p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
 static void jpParse(benchmark::State& state) {
+  const size_t allocs = num_allocs;
   while (state.KeepRunning()) {
     jp::JsonParser{e}.Parse();
   }
+  state.SetBytesProcessed(state.iterations() * e.size());
+  state.counters["node_bytes"] = sizeof(jp::JsonValue);
+  state.counters["allocs"] = benchmark::Counter(
+      num_allocs - allocs, benchmark::Counter::kAvgIterations);
+}
+
+static void jpDocumentParse(benchmark::State& state) {
+  const size_t allocs = num_allocs;
+  size_t arena_bytes = 0;
+  while (state.KeepRunning()) {
+    jp::JsonDocument doc;
+    doc.Parse(e);
+    arena_bytes = doc.arena().used();
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+  state.counters["allocs"] = benchmark::Counter(
+      num_allocs - allocs, benchmark::Counter::kAvgIterations);
+  state.counters["arena_bytes"] = arena_bytes;
+}
+
+static void jpDocumentParseZeroCopy(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    jp::JsonDocument doc;
+    doc.ParseZeroCopy(e);
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+// Includes the cost of copying the input, as it's modified by the parser
+static void jpDocumentParseInsitu(benchmark::State& state) {
+  std::string buffer;
+  while (state.KeepRunning()) {
+    buffer = e;
+    jp::JsonDocument doc;
+    doc.ParseInsitu(buffer);
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+// The same input parsed again, through a cache, which only hashes it and
+// compares it with the cached copy. Compare with jpDocumentParse.
+static void jpDocumentCache(benchmark::State& state) {
+  jp::DocumentCache::Options options;
+  options.max_bytes = 1024 * 1024 * 1024;
+  jp::DocumentCache cache{options};
+  cache.Parse(e);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(cache.Parse(e));
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+// The hash of a cache lookup alone
+static void jpHashInput(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(jp::HashInput(e.data(), e.data() + e.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+// Small bodies, like the requests of a server, each parsed by a new document,
+// or all by one document which is reused
+static std::vector<std::string> MakeBodies() {
+  std::vector<std::string> bodies;
+  for (size_t i = 0; i < 1000; ++i) {
+    bodies.push_back("{\"id\": " + std::to_string(i) +
+                     ", \"name\": \"user" + std::to_string(i) +
+                     "\", \"active\": true, \"meta\": {\"tags\": [\"x\", "
+                     "\"y\\n\"]}, \"scores\": [1.5, 2, 3]}");
+  }
+  return bodies;
+}
+
+static void jpSmallDocuments(benchmark::State& state) {
+  static const std::vector<std::string> bodies = MakeBodies();
+  const size_t allocs = num_allocs;
+  size_t bytes = 0;
+  jp::JsonDocument reused;
+  while (state.KeepRunning()) {
+    for (const std::string& body : bodies) {
+      if (state.range(0)) {
+        benchmark::DoNotOptimize(reused.Parse(body));
+      } else {
+        jp::JsonDocument doc;
+        benchmark::DoNotOptimize(doc.Parse(body));
+      }
+      bytes += body.size();
+    }
+  }
+  state.SetLabel(state.range(0) ? "reused" : "new");
+  state.SetBytesProcessed(bytes);
+  state.counters["allocs"] = benchmark::Counter(
+      double(num_allocs - allocs) / bodies.size(),
+      benchmark::Counter::kAvgIterations);
+}
+
+// The bodies above, made invalid in different places
+static std::vector<std::string> MakeInvalidBodies() {
+  std::vector<std::string> bodies = MakeBodies();
+  for (size_t i = 0; i < bodies.size(); ++i) {
+    std::string& body = bodies[i];
+    switch (i % 3) {
+      case 0:
+        body.resize(body.size() / 2);
+        break;
+      case 1:
+        body[body.size() / 2] = '#';
+        break;
+      case 2:
+        body += "}";
+        break;
+    }
+  }
+  return bodies;
+}
+
+// Rejects invalid bodies by catching the exception of Parse, or with the
+// error returned by TryParse, which doesn't build a message
+static void jpRejectInvalid(benchmark::State& state) {
+  static const std::vector<std::string> bodies = MakeInvalidBodies();
+  jp::JsonDocument doc;
+  size_t rejected = 0;
+  while (state.KeepRunning()) {
+    for (const std::string& body : bodies) {
+      if (state.range(0)) {
+        rejected += static_cast<bool>(doc.TryParse(body));
+      } else {
+        try {
+          doc.Parse(body);
+        } catch (const jp::ParseException&) {
+          ++rejected;
+        }
+      }
+    }
+  }
+  state.SetLabel(state.range(0) ? "TryParse" : "exceptions");
+  state.SetItemsProcessed(rejected);
+}
+
+// Reads the file into a string first, like the file above
+static void jpReadAndParse(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    std::ifstream in(kFileName);
+    const std::string json((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+    jp::JsonParser{json}.Parse();
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+static void jpParseFile(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    jp::JsonParser::ParseFile(kFileName);
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+static void jpMappedJson(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    jp::MappedJson json{kFileName};
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+// Startup with a snapshot: the tape of the file is mapped, and checksummed,
+// instead of parsing the file. Compare with jpMappedJson and jpParseFile.
+static const std::string kTapeFileName = std::string(kFileName) + ".tape";
+
+static void jpMappedTape(benchmark::State& state) {
+  jp::WriteTapeFile(jp::JsonParser{e}.Parse(), kTapeFileName);
+  while (state.KeepRunning()) {
+    jp::MappedTape tape{kTapeFileName, state.range(0) != 0};
+    benchmark::DoNotOptimize(tape.root().getObject().at("events").type());
+  }
+  state.SetLabel(state.range(0) ? "checksummed" : "unchecked");
+  std::remove(kTapeFileName.c_str());
+}
+
+// Counts the values of the document, without building it
+struct CountingHandler {
+  void StartObject() { ++values; }
+  void Key(jp::StringRef, bool) {}
+  void EndObject(size_t) {}
+  void StartArray() { ++values; }
+  void EndArray(size_t) {}
+  void String(jp::StringRef, bool) { ++values; }
+  void Int64(int64_t) { ++values; }
+  void Uint64(uint64_t) { ++values; }
+  void Number(double) { ++values; }
+  void Bool(bool) { ++values; }
+  void Null() { ++values; }
+
+  size_t values = 0;
+};
+
+static void jpSaxParse(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    CountingHandler handler;
+    jp::JsonParser{e}.Parse(handler);
+    benchmark::DoNotOptimize(handler.values);
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+// Feeds the input in 64 KB chunks, as if it came from a socket
+static void jpPushParse(benchmark::State& state) {
+  const size_t chunk_size = 64 * 1024;
+  while (state.KeepRunning()) {
+    jp::DomBuilder builder{nullptr, false};
+    jp::PushParser<jp::DomBuilder> parser{builder};
+    for (size_t i = 0; i < e.size(); i += chunk_size) {
+      parser.Feed(e.data() + i, std::min(chunk_size, e.size() - i));
+    }
+    parser.Finish();
+    builder.TakeRoot();
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+static const std::string gzipped = jp::Gzip(e.data(), e.data() + e.size());
+
+// A gzip compressed file, decompressed into a string, then parsed, with 0 by
+// a JsonDocument, with 1 by the PushParser of jpGzipPipelined. The whole
+// decompressed input is in memory with the value.
+static void jpGunzipThenParse(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    const std::string json =
+        jp::Gunzip(gzipped.data(), gzipped.data() + gzipped.size());
+    if (state.range(0) == 0) {
+      jp::JsonDocument doc;
+      doc.Parse(json);
+    } else {
+      jp::Arena arena;
+      jp::DomBuilder builder{&arena, false};
+      jp::PushParser<jp::DomBuilder> parser{builder};
+      parser.Feed(json.data(), json.size());
+      parser.Finish();
+      builder.TakeRoot();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+  // the decompressed string, all of which is held while parsing
+  state.counters["resident_input_bytes"] = e.size();
+}
+
+// The same file, parsed while it's decompressed, a buffer at a time, with 1
+// on another thread, which keeps a few buffers ahead of the parser
+static void jpGzipPipelined(benchmark::State& state) {
+  jp::GzipReader::Options options;
+  options.threaded = state.range(0);
+  while (state.KeepRunning()) {
+    jp::Arena arena;
+    jp::ParseGzip(gzipped.data(), gzipped.data() + gzipped.size(), &arena,
+                  options);
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+  // the buffers of decompressed input, the most of it held while parsing
+  state.counters["resident_input_bytes"] =
+      options.buffer_size * (options.threaded ? options.num_buffers : 1);
+}
+
+// First stage of jpParse alone
+static void jpStructuralIndex(benchmark::State& state) {
+  jp::StructuralIndex index;
+  while (state.KeepRunning()) {
+    index.Build(e.data(), e.data() + e.size());
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+  state.SetLabel(jp::StructuralIndex::Implementation());
+}
+
+// Records with text which is mostly not ASCII, like in many languages
+static std::string MakeUtf8Records() {
+  const char* const words[] = {"\xe6\x97\xa5\xe6\x9c\xac", "caf\xc3\xa9",
+                               "\xd0\xbc\xd0\xb8\xd1\x80", "text",
+                               "\xf0\x9f\x98\x80"};
+  std::string out = "[";
+  for (size_t i = 0; i < 20000; ++i) {
+    out += "{\"id\": " + std::to_string(i) + ", \"text\": \"";
+    for (size_t j = 0; j < 12; ++j) {
+      out += words[(i + j * j) % 5];
+      out += ' ';
+    }
+    out += "\"}, ";
+  }
+  out += "{}]";
+  return out;
+}
+
+static const std::string utf8_records = MakeUtf8Records();
+
+static void jpValidateUtf8(benchmark::State& state) {
+  const std::string& input = state.range(0) ? utf8_records : e;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(
+        jp::ValidateUtf8(input.data(), input.data() + input.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+  state.SetLabel(std::string(jp::Utf8Implementation()) +
+                 (state.range(0) ? " records" : " citm"));
+}
+
+// Parses text which is mostly not ASCII, validating it or not
+static void jpParseUtf8(benchmark::State& state) {
+  const auto mode = state.range(0) ? jp::JsonParser::Utf8Mode::PERMISSIVE
+                                   : jp::JsonParser::Utf8Mode::STRICT;
+  while (state.KeepRunning()) {
+    CountingHandler handler;
+    jp::JsonParser parser{utf8_records};
+    parser.set_utf8_mode(mode);
+    parser.Parse(handler);
+    benchmark::DoNotOptimize(handler.values);
+  }
+  state.SetBytesProcessed(state.iterations() * utf8_records.size());
+  state.SetLabel(state.range(0) ? "permissive" : "strict");
+}
+
+// A 50 KB request with 50 fields, of which a handler reads a few
+static std::string MakePayload() {
+  std::string out = "{";
+  for (size_t i = 0; i < 50; ++i) {
+    out += "\"field" + std::to_string(i) + "\": {\"id\": " + std::to_string(i) +
+           ", \"values\": [";
+    for (size_t j = 0; j < 80; ++j) {
+      out += std::to_string(i * j) + ".25, ";
+    }
+    out += "0], \"name\": \"name " + std::to_string(i) + "\"}, ";
+  }
+  out += "\"user\": {\"id\": 12345, \"name\": \"someone\"}}";
+  return out;
+}
+
+static const std::string payload = MakePayload();
+
+static void jpPayloadParse(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    const jp::JsonValue doc = jp::JsonParser{payload}.Parse();
+    const auto& obj = doc.getObject();
+    benchmark::DoNotOptimize(obj.at("user").getObject().at("id").getNumber());
+    benchmark::DoNotOptimize(obj.at("field3").getObject().at("name"));
+    benchmark::DoNotOptimize(obj.at("field40").getObject().at("id"));
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+static void jpPayloadCursor(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    const jp::JsonCursor doc{payload};
+    benchmark::DoNotOptimize(doc["user"]["id"].getNumber());
+    benchmark::DoNotOptimize(doc["field3"]["name"].getString());
+    benchmark::DoNotOptimize(doc["field40"]["id"].getNumber());
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+// The same fields, extracted in a single pass over the input
+static void jpPayloadPaths(benchmark::State& state) {
+  const jp::JsonPaths paths{{"/user/id", "/field3/name", "/field40/id"}};
+  while (state.KeepRunning()) {
+    paths.Extract(payload, [](size_t path, const jp::JsonCursor& value) {
+      if (path == 1) {
+        benchmark::DoNotOptimize(value.getString());
+      } else {
+        benchmark::DoNotOptimize(value.getNumber());
+      }
+    });
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+// 100k small records, one per line
+static std::string MakeNdjson() {
+  std::string out;
+  for (size_t i = 0; i < 100000; ++i) {
+    out += "{\"id\": " + std::to_string(i) +
+           ", \"name\": \"user" + std::to_string(i) +
+           "\", \"active\": true, \"scores\": [1.5, 2, 3]}\n";
+  }
+  return out;
+}
+
+// Records/s of NdjsonReader with 1..N threads
+static void jpNdjson(benchmark::State& state) {
+  static const std::string input = MakeNdjson();
+  jp::NdjsonReader::Options options;
+  options.num_threads = state.range(0);
+  std::atomic<size_t> records{0};
+  while (state.KeepRunning()) {
+    jp::NdjsonReader{options}.Parse(
+        input, [&](size_t, const jp::JsonValue&) { ++records; });
+  }
+  state.SetItemsProcessed(records);
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+// A single array of 200k records, about 20 MB
+static std::string MakeLargeArray() {
+  std::string out = "[";
+  for (size_t i = 0; i < 200000; ++i) {
+    out += "{\"id\": " + std::to_string(i) + ", \"name\": \"user" +
+           std::to_string(i) +
+           "\", \"active\": true, \"scores\": [1.5, 2, 3]},\n";
+  }
+  out += "null]";
+  return out;
+}
+
+// ParallelParser with 1..N threads
+static void jpParallelParse(benchmark::State& state) {
+  static const std::string input = MakeLargeArray();
+  jp::ParallelParser::Options options;
+  options.num_threads = state.range(0);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(jp::ParallelParser{options}.Parse(input));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+struct Record {
+  int64_t id = 0;
+  std::string name;
+  bool active = false;
+  std::vector<double> scores;
+};
+JP_FIELDS(Record, id, name, active, scores)
+
+// 100k records, with a member which isn't bound
+static std::string MakeRecords() {
+  std::string out = "[";
+  for (size_t i = 0; i < 100000; ++i) {
+    out += std::string(i ? ",\n" : "") + "{\"id\": " + std::to_string(i) +
+           ", \"name\": \"user" + std::to_string(i) +
+           "\", \"active\": true, \"meta\": {\"tags\": [\"x\", \"y\"]}" +
+           ", \"scores\": [1.5, 2, 3]}";
+  }
+  out += "]";
+  return out;
+}
+
+static const std::string records = MakeRecords();
+
+// Parses records straight into structs
+static void jpBindStructs(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(jp::FromJson<std::vector<Record>>(records));
+  }
+  state.SetBytesProcessed(state.iterations() * records.size());
+}
+
+// Parses records into a document, and copies them into structs
+static void jpDocumentToStructs(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    jp::JsonDocument doc;
+    std::vector<Record> out;
+    for (const auto& val : doc.Parse(records).getArray()) {
+      const auto& obj = val.getObject();
+      out.emplace_back();
+      out.back().id = obj.at("id").getInt64();
+      out.back().name = obj.at("name").getString();
+      out.back().active = obj.at("active").getBool();
+      for (const auto& score : obj.at("scores").getArray()) {
+        out.back().scores.push_back(score.getNumber());
+      }
+    }
+    benchmark::DoNotOptimize(out);
+  }
+  state.SetBytesProcessed(state.iterations() * records.size());
+}
+
+static void jpWriteStructs(benchmark::State& state) {
+  const auto structs = jp::FromJson<std::vector<Record>>(records);
+  std::string out;
+  while (state.KeepRunning()) {
+    out.clear();
+    jp::JsonWriter writer{&out};
+    jp::Write(writer, structs);
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+
+// Parsed on first use, rather than during static initialization, where a
+// missing or invalid file would end the program before any benchmark runs
+static const jp::JsonValue& Parsed() {
+  static const jp::JsonValue parsed = jp::JsonParser{e}.Parse();
+  return parsed;
+}
+
+// Looks up every key of an object with state.range(0) members
+static void jpObjectLookup(benchmark::State& state) {
+  std::vector<std::string> keys;
+  std::string json = "{";
+  for (int i = 0; i < state.range(0); ++i) {
+    keys.push_back("key_number_" + std::to_string(i));
+    json += (i ? ",\"" : "\"") + keys.back() + "\":" + std::to_string(i);
+  }
+  json += "}";
+  jp::JsonDocument doc;
+  const auto& obj = doc.Parse(json).getObject();
+
+  int64_t sum = 0;
+  while (state.KeepRunning()) {
+    for (const auto& key : keys) {
+      sum += obj.at(key).getInt64();
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Into the same string every time, so it's only allocated once
+static void jpSerialize(benchmark::State& state) {
+  std::string out;
+  while (state.KeepRunning()) {
+    out.clear();
+    jp::JsonWriter{&out}.Write(Parsed());
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+
+static void jpSerializePretty(benchmark::State& state) {
+  jp::JsonWriter::Options options;
+  options.pretty = true;
+  std::string out;
+  while (state.KeepRunning()) {
+    out.clear();
+    jp::JsonWriter{&out, options}.Write(Parsed());
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+
+// Reformats the input without building a value
+static void jpReformat(benchmark::State& state) {
+  std::string out;
+  while (state.KeepRunning()) {
+    out.clear();
+    jp::JsonWriter writer{&out};
+    jp::JsonParser{e}.Parse(writer);
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+// The same as jpReformat, validating and stripping whitespace, without
+// parsing any value
+static void jpMinify(benchmark::State& state) {
+  std::string out(e.size(), '\0');
+  size_t size;
+  while (state.KeepRunning()) {
+    jp::TryMinify(e.data(), e.data() + e.size(), &out[0], &size);
+  }
+  state.SetBytesProcessed(state.iterations() * e.size());
+}
+
+static void jpToString(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(Parsed().to_string());
+  }
 }
 
 static void nlohmannParse(benchmark::State& state) {
   while (state.KeepRunning()) {
     nlohmann::json::parse(e);
   }
+  state.SetBytesProcessed(state.iterations() * e.size());
 }
 
 static void rapidJsonParse(benchmark::State& state) {
@@ -45,11 +643,13 @@ static void rapidJsonParse(benchmark::State& state) {
     rapidjson::Document doc;
     doc.Parse(e.c_str());
   }
+  state.SetBytesProcessed(state.iterations() * e.size());
 }
 static void microsoftCppRestParse(benchmark::State& state) {
   while (state.KeepRunning()) {
     web::json::value::parse(e);
   }
+  state.SetBytesProcessed(state.iterations() * e.size());
 }
 
 static void jsonCppParse(benchmark::State& state) {
@@ -58,9 +658,48 @@ static void jsonCppParse(benchmark::State& state) {
   while (state.KeepRunning()) {
     reader.parse(e, value, false);
   }
+  state.SetBytesProcessed(state.iterations() * e.size());
 }
 
 BENCHMARK(jpParse);
+BENCHMARK(jpDocumentParse);
+BENCHMARK(jpDocumentParseZeroCopy);
+BENCHMARK(jpDocumentParseInsitu);
+BENCHMARK(jpDocumentCache);
+BENCHMARK(jpHashInput);
+BENCHMARK(jpSmallDocuments)->Arg(0)->Arg(1);
+BENCHMARK(jpRejectInvalid)->Arg(0)->Arg(1);
+BENCHMARK(jpReadAndParse);
+BENCHMARK(jpParseFile);
+BENCHMARK(jpMappedJson);
+BENCHMARK(jpMappedTape)->Arg(1)->Arg(0);
+BENCHMARK(jpSaxParse);
+BENCHMARK(jpPushParse);
+BENCHMARK(jpGunzipThenParse)->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(jpGzipPipelined)->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(jpStructuralIndex);
+BENCHMARK(jpValidateUtf8)->Arg(0)->Arg(1);
+BENCHMARK(jpParseUtf8)->Arg(0)->Arg(1);
+BENCHMARK(jpPayloadParse);
+BENCHMARK(jpPayloadCursor);
+BENCHMARK(jpPayloadPaths);
+BENCHMARK(jpObjectLookup)->Arg(4)->Arg(8)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK(jpBindStructs);
+BENCHMARK(jpDocumentToStructs);
+BENCHMARK(jpWriteStructs);
+BENCHMARK(jpSerialize);
+BENCHMARK(jpSerializePretty);
+BENCHMARK(jpReformat);
+BENCHMARK(jpMinify);
+BENCHMARK(jpToString);
+BENCHMARK(jpNdjson)
+    ->RangeMultiplier(2)
+    ->Range(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+BENCHMARK(jpParallelParse)
+    ->RangeMultiplier(2)
+    ->Range(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
 BENCHMARK(nlohmannParse);
 BENCHMARK(rapidJsonParse);
 BENCHMARK(microsoftCppRestParse);
@@ -0,0 +1,89 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <new>
+
+namespace jp {
+
+const size_t Arena::kDefaultChunkSize;
+const size_t Arena::kMaxChunkSize;
+
+void Arena::Reset() {
+  while (head_) {
+    Chunk* prev = head_->prev;
+    ::operator delete(head_);
+    head_ = prev;
+  }
+  ptr_ = end_ = nullptr;
+  capacity_ = 0;
+  num_chunks_ = 0;
+}
+
+void Arena::Rewind(size_t size) {
+  if (size == 0) {
+    Reset();
+    return;
+  }
+  const size_t wanted = std::max(size, first_chunk_size_);
+
+  Chunk* largest = head_;
+  for (Chunk* chunk = head_; chunk; chunk = chunk->prev) {
+    if (chunk->size > largest->size) {
+      largest = chunk;
+    }
+  }
+  if (!largest || largest->size < wanted || largest->size > 2 * wanted) {
+    largest = nullptr;
+  }
+
+  Chunk* chunk = head_;
+  while (chunk) {
+    Chunk* prev = chunk->prev;
+    if (chunk != largest) {
+      ::operator delete(chunk);
+    }
+    chunk = prev;
+  }
+  head_ = nullptr;
+  capacity_ = 0;
+  num_chunks_ = 0;
+
+  if (largest) {
+    largest->prev = nullptr;
+    head_ = largest;
+    capacity_ = largest->size;
+    num_chunks_ = 1;
+    ptr_ = reinterpret_cast<char*>(largest + 1);
+    end_ = reinterpret_cast<char*>(largest) + largest->size;
+  } else {
+    AddChunk(wanted);
+  }
+  // further chunks grow from the kept one
+  chunk_size_ = std::max(std::min(head_->size * 2, kMaxChunkSize),
+                         first_chunk_size_);
+}
+
+// Starts a new chunk, big enough for the requested allocation. Chunks grow
+// geometrically up to kMaxChunkSize, so large documents need few of them.
+void* Arena::AllocateSlow(size_t size, size_t align) {
+  const size_t header = sizeof(Chunk) + align;
+  AddChunk(std::max(chunk_size_, size + header));
+
+  char* p = AlignUp(ptr_, align);
+  ptr_ = p + size;
+  chunk_size_ = std::min(chunk_size_ * 2, kMaxChunkSize);
+  return p;
+}
+
+void Arena::AddChunk(size_t chunk_size) {
+  Chunk* chunk = static_cast<Chunk*>(::operator new(chunk_size));
+  chunk->prev = head_;
+  chunk->size = chunk_size;
+  head_ = chunk;
+  capacity_ += chunk_size;
+  ++num_chunks_;
+
+  ptr_ = reinterpret_cast<char*>(chunk + 1);
+  end_ = reinterpret_cast<char*>(chunk) + chunk_size;
+}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace jp {
+
+// An Arena is a chunked bump allocator. Allocating is just bumping a pointer
+// in the current chunk, and memory is only given back when the whole arena is
+// destroyed or reset, so objects placed in an arena are never destructed.
+class Arena {
+ public:
+  static const size_t kDefaultChunkSize = 64 * 1024;
+  static const size_t kMaxChunkSize = 4 * 1024 * 1024;
+
+  explicit Arena(size_t chunk_size = kDefaultChunkSize)
+      : chunk_size_(chunk_size), first_chunk_size_(chunk_size) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  ~Arena() { Reset(); }
+
+  void* Allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+    char* p = AlignUp(ptr_, align);
+    if (p + size > end_ || p == nullptr) {
+      return AllocateSlow(size, align);
+    }
+    ptr_ = p + size;
+    return p;
+  }
+
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Copies size chars starting at data into the arena
+  char* CopyString(const char* data, size_t size) {
+    char* p = static_cast<char*>(Allocate(size, 1));
+    std::memcpy(p, data, size);
+    return p;
+  }
+
+  // Frees every chunk
+  void Reset();
+
+  // Frees everything allocated from the arena, like Reset, but keeps a single
+  // chunk of size bytes, to allocate from again without calling malloc. The
+  // largest chunk is kept if it's at least that big, and at most twice as
+  // big, otherwise it's replaced. Chunks are never smaller than the chunk
+  // size the arena was made with. If size is 0, every chunk is freed.
+  void Rewind(size_t size);
+
+  // Total number of bytes in the chunks allocated so far
+  size_t capacity() const { return capacity_; }
+  size_t num_chunks() const { return num_chunks_; }
+
+  // Number of bytes allocated so far, including the unused ends of the chunks
+  // before the current one
+  size_t used() const { return capacity_ - (end_ - ptr_); }
+
+ private:
+  struct Chunk {
+    Chunk* prev;
+    size_t size;
+  };
+
+  static char* AlignUp(char* p, size_t align) {
+    return reinterpret_cast<char*>(
+        (reinterpret_cast<uintptr_t>(p) + align - 1) & ~(align - 1));
+  }
+
+  void* AllocateSlow(size_t size, size_t align);
+
+  // Allocates a chunk of chunk_size bytes, including its header, and makes it
+  // the current one
+  void AddChunk(size_t chunk_size);
+
+  Chunk* head_ = nullptr;
+  char* ptr_ = nullptr;
+  char* end_ = nullptr;
+  size_t chunk_size_;
+  const size_t first_chunk_size_;
+  size_t capacity_ = 0;
+  size_t num_chunks_ = 0;
+};
+
+// ArenaAllocator is an STL allocator, which allocates from an Arena, or from
+// the heap if it doesn't have one. Deallocation is a no-op in the arena case.
+//
+// Copies of containers are always made on the heap, so a copy of a value from a
+// document can outlive the document.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() noexcept : arena_(nullptr) {}
+  explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+      : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    if (arena_) {
+      return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t) noexcept {
+    if (!arena_) {
+      ::operator delete(p);
+    }
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  Arena* arena() const { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return !(a == b);
+}
+}
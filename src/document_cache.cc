@@ -0,0 +1,168 @@
+#include "document_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "arena.h"
+#include "json_parser.h"
+
+namespace jp {
+
+namespace {
+
+const uint64_t kSecrets[4] = {0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+                              0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL};
+
+inline uint64_t Load64(const char* p) {
+  uint64_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+// Multiplies a by b, and folds the 128 bit product in half, like wyhash
+inline uint64_t Mix(uint64_t a, uint64_t b) {
+  const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+// Small documents get a small arena, rather than a chunk of the default size
+size_t ChunkSizeFor(size_t input_size) {
+  return std::min(std::max<size_t>(input_size, 1024),
+                  Arena::kDefaultChunkSize);
+}
+}
+
+uint64_t HashInput(const char* p, const char* end) {
+  // two lanes of 16 bytes, which don't wait for each other's multiplications.
+  // A lane mustn't start with the secret its first word is mixed with, or
+  // swapping its two words wouldn't change the hash.
+  uint64_t a = kSecrets[2] ^ static_cast<uint64_t>(end - p);
+  uint64_t b = kSecrets[3];
+  for (; end - p >= 32; p += 32) {
+    a = Mix(Load64(p) ^ kSecrets[0], Load64(p + 8) ^ a);
+    b = Mix(Load64(p + 16) ^ kSecrets[1], Load64(p + 24) ^ b);
+  }
+  char tail[32] = {};
+  std::memcpy(tail, p, end - p);
+  a = Mix(Load64(tail) ^ kSecrets[0], Load64(tail + 8) ^ a);
+  b = Mix(Load64(tail + 16) ^ kSecrets[1], Load64(tail + 24) ^ b);
+  return Mix(a ^ kSecrets[2], b ^ kSecrets[3]);
+}
+
+// A cached document, whose strings point into its copy of the input
+struct DocumentCache::Entry {
+  Entry(uint64_t hash, const char* p, const char* end)
+      : hash(hash), input(p, end), arena(ChunkSizeFor(end - p)) {
+    root = JsonParser{input, &arena, JsonParser::StringMode::ZERO_COPY}
+               .Parse();
+    bytes = sizeof(Entry) + input.capacity() + arena.capacity();
+  }
+
+  bool Matches(const char* p, size_t size) const {
+    return input.size() == size && std::memcmp(input.data(), p, size) == 0;
+  }
+
+  const uint64_t hash;
+  const std::string input;
+  Arena arena;
+  JsonValue root;
+  size_t bytes;
+};
+
+struct DocumentCache::Shard {
+  using Lru = std::list<std::shared_ptr<const Entry>>;
+
+  // Removes the entry, which is in the shard
+  void Erase(Lru::iterator it) {
+    bytes -= (*it)->bytes;
+    index.erase((*it)->hash);
+    lru.erase(it);
+  }
+
+  std::mutex mutex;
+
+  // The entries, the most recently used first, and where each one is by the
+  // hash of its input. Inputs with the same hash replace each other.
+  Lru lru;
+  std::unordered_map<uint64_t, Lru::iterator> index;
+
+  size_t bytes = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+};
+
+DocumentCache::DocumentCache(Options options) : options_(options) {
+  options_.num_shards = std::max<size_t>(options_.num_shards, 1);
+  for (size_t i = 0; i < options_.num_shards; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+DocumentCache::~DocumentCache() = default;
+
+std::shared_ptr<const JsonValue> DocumentCache::Parse(const char* p,
+                                                      const char* end) {
+  const uint64_t hash = HashInput(p, end);
+  // the index of the shard uses the high bits, its map the low ones
+  Shard& shard = *shards_[(hash >> 32) % shards_.size()];
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.index.find(hash);
+    if (it != shard.index.end() && (*it->second)->Matches(p, end - p)) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      ++shard.hits;
+      const std::shared_ptr<const Entry>& entry = *it->second;
+      return std::shared_ptr<const JsonValue>(entry, &entry->root);
+    }
+    ++shard.misses;
+  }
+
+  // parsed without holding the lock, so lookups of other inputs of the shard
+  // don't wait for it
+  const auto entry = std::make_shared<const Entry>(hash, p, end);
+  const size_t budget = options_.max_bytes / shards_.size();
+  if (entry->bytes <= budget) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // the same input may have been cached by another thread in the meantime
+    const auto it = shard.index.find(hash);
+    if (it != shard.index.end()) {
+      shard.Erase(it->second);
+    }
+    shard.lru.push_front(entry);
+    shard.index.emplace(hash, shard.lru.begin());
+    shard.bytes += entry->bytes;
+    while (shard.bytes > budget) {
+      shard.Erase(std::prev(shard.lru.end()));
+      ++shard.evictions;
+    }
+  }
+  return std::shared_ptr<const JsonValue>(entry, &entry->root);
+}
+
+DocumentCache::Stats DocumentCache::stats() const {
+  Stats stats;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    stats.hits += shard->hits;
+    stats.misses += shard->misses;
+    stats.evictions += shard->evictions;
+    stats.entries += shard->lru.size();
+    stats.bytes += shard->bytes;
+  }
+  return stats;
+}
+
+void DocumentCache::Clear() {
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->lru.clear();
+    shard->index.clear();
+    shard->bytes = 0;
+  }
+}
+}
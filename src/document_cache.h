@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "json_value.h"
+
+namespace jp {
+
+// A hash of the bytes of [p, end), which reads them 32 at a time, so it's
+// many times faster than parsing them. Not cryptographic: anyone can make
+// inputs which collide.
+uint64_t HashInput(const char* p, const char* end);
+
+// A thread-safe cache of parsed documents, keyed by their input, for inputs
+// which are parsed again and again, like the same config sent with every
+// request. Parsing an input which is in the cache only hashes it and compares
+// it with the cached copy, and returns the document parsed the first time.
+//
+// The cache is split into shards, by the hash of the input, each with its
+// own lock and its own share of the memory budget. When a shard is over
+// budget, its least recently used documents are evicted. Documents are
+// immutable and shared, and outlive their eviction as long as they're used.
+class DocumentCache {
+ public:
+  struct Options {
+    // Of every cached input and document, added up
+    size_t max_bytes = 64 * 1024 * 1024;
+
+    // More shards make threads wait less for each other's lookups
+    size_t num_shards = 16;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+  };
+
+  DocumentCache() : DocumentCache(Options()) {}
+  explicit DocumentCache(Options options);
+  ~DocumentCache();
+
+  DocumentCache(const DocumentCache&) = delete;
+  DocumentCache& operator=(const DocumentCache&) = delete;
+
+  // Returns the root of the document parsed from [p, end), which is cached,
+  // unless it's larger than a shard's budget. Throws a ParseException if the
+  // input is invalid, which isn't cached.
+  std::shared_ptr<const JsonValue> Parse(const char* p, const char* end);
+
+  std::shared_ptr<const JsonValue> Parse(const std::string& json) {
+    return Parse(json.data(), json.data() + json.size());
+  }
+
+  Stats stats() const;
+
+  // Evicts every document
+  void Clear();
+
+ private:
+  struct Entry;
+  struct Shard;
+
+  Options options_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+}
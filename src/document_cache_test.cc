@@ -0,0 +1,109 @@
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "document_cache.h"
+#include "json_parser.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+TEST(DocumentCache, HitsAndMisses) {
+  DocumentCache cache;
+  const string config = "{\"name\": \"gateway\", \"limits\": [1, 2, 3]}";
+  const auto first = cache.Parse(config);
+  EXPECT_EQ("gateway", first->getObject().at("name").getString());
+
+  // the same bytes in another buffer
+  const string copy = config;
+  const auto second = cache.Parse(copy);
+  EXPECT_EQ(first.get(), second.get());
+
+  const auto other = cache.Parse("{\"name\": \"gateway\", \"limits\": [1]}");
+  EXPECT_NE(first.get(), other.get());
+  EXPECT_EQ(1, other->getObject().at("limits").getArray().size());
+
+  const DocumentCache::Stats stats = cache.stats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(0, stats.evictions);
+  EXPECT_EQ(2, stats.entries);
+  EXPECT_GT(stats.bytes, 2 * config.size());
+}
+
+TEST(DocumentCache, Invalid) {
+  DocumentCache cache;
+  EXPECT_THROW(cache.Parse("{\"a\": }"), ParseException);
+  EXPECT_THROW(cache.Parse("{\"a\": }"), ParseException);
+  EXPECT_EQ(0, cache.stats().entries);
+  EXPECT_EQ(2, cache.stats().misses);
+}
+
+TEST(DocumentCache, Budget) {
+  DocumentCache::Options options;
+  options.max_bytes = 64 * 1024;
+  options.num_shards = 2;
+  DocumentCache cache{options};
+
+  // too large for a shard, so it's parsed, but not cached
+  const string large = "[" + string(40 * 1024, ' ') + "1]";
+  EXPECT_EQ(1, cache.Parse(large)->getArray().size());
+  EXPECT_EQ(0, cache.stats().entries);
+
+  const auto kept = cache.Parse("[\"kept\"]");
+  for (int i = 0; i < 200; ++i) {
+    cache.Parse("[" + std::to_string(i) + "]");
+  }
+  const DocumentCache::Stats stats = cache.stats();
+  EXPECT_LE(stats.bytes, options.max_bytes);
+  EXPECT_GT(stats.evictions, 0);
+  EXPECT_EQ(201 - stats.evictions, stats.entries);
+  // evicted documents live on as long as they're used
+  EXPECT_EQ("kept", kept->getArray()[0].getString());
+
+  cache.Clear();
+  EXPECT_EQ(0, cache.stats().entries);
+  EXPECT_EQ(0, cache.stats().bytes);
+}
+
+TEST(DocumentCache, Threads) {
+  DocumentCache cache;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache]() {
+      for (int i = 0; i < 1000; ++i) {
+        const int n = i % 10;
+        const auto val = cache.Parse("{\"n\": " + std::to_string(n) + "}");
+        EXPECT_EQ(n, val->getObject().at("n").getInt64());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const DocumentCache::Stats stats = cache.stats();
+  EXPECT_EQ(4000, stats.hits + stats.misses);
+  EXPECT_EQ(10, stats.entries);
+}
+
+TEST(DocumentCache, Hash) {
+  // every prefix of an input, and every single changed byte, hashes to
+  // something else
+  const string input = string(100, 'x') + "{\"a\": [1, 2, 3]}";
+  std::set<uint64_t> hashes;
+  for (size_t size = 0; size <= input.size(); ++size) {
+    hashes.insert(HashInput(input.data(), input.data() + size));
+  }
+  for (size_t i = 0; i < input.size(); ++i) {
+    string changed = input;
+    changed[i] ^= 1;
+    hashes.insert(HashInput(changed.data(), changed.data() + changed.size()));
+  }
+  EXPECT_EQ(2 * input.size() + 1, hashes.size());
+  EXPECT_EQ(HashInput(input.data(), input.data() + input.size()),
+            HashInput(input.data(), input.data() + input.size()));
+}
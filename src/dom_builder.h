@@ -0,0 +1,215 @@
+#pragma once
+
+#include <assert.h>
+#include <deque>
+#include <functional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "arena.h"
+#include "json_value.h"
+#include "string_ref.h"
+
+namespace jp {
+
+// DomBuilder is a JsonParser handler, which builds a JsonValue from the
+// events of the parser. Nodes are allocated from arena, if it's given, or on
+// the heap otherwise.
+//
+// If borrow_strings is set, strings which point into the input are not
+// copied, in which case the input must outlive the built value.
+//
+// Keys which are copied into the arena are interned, so objects with the same
+// keys, as in arrays of records, share a single copy of each.
+class DomBuilder {
+ public:
+  DomBuilder(Arena* arena, bool borrow_strings)
+      : arena_(arena), borrow_strings_(borrow_strings), keys_(MakeKeySet()) {}
+
+  void StartObject() {
+    JsonValue val =
+        arena_ ? JsonValue::Borrowed(arena_->New<JsonValue::ObjectType>(
+                     JsonValue::ObjectType::allocator_type(arena_)))
+               : JsonValue{JsonValue::ObjectType{}};
+    JsonValue::ObjectType* obj = val.obj_;
+    Add(std::move(val));
+    stack_.push_back(Frame{obj, nullptr, nullptr, pending_.size()});
+  }
+
+  void Key(StringRef key, bool copy) {
+    Frame& frame = stack_.back();
+    if (arena_) {
+      // the member is added to the object when it ends, so that its vector
+      // is allocated once with the right size
+      pending_.emplace_back(borrow_strings_ && !copy ? key : Intern(key),
+                            JsonValue());
+      frame.slot = &pending_.back().second;
+      return;
+    }
+    frame.slot = frame.obj->Insert(key);
+    if (!frame.slot) {
+      // duplicate keys keep their first value
+      discarded_.emplace_back();
+      frame.slot = &discarded_.back();
+    }
+  }
+
+  void EndObject(size_t) {
+    if (arena_) {
+      AddPendingMembers(stack_.back());
+    }
+    stack_.pop_back();
+  }
+
+  void StartArray() {
+    JsonValue val =
+        arena_ ? JsonValue::Borrowed(arena_->New<JsonValue::ArrayType>(
+                     ArenaAllocator<JsonValue>(arena_)))
+               : JsonValue{JsonValue::ArrayType{}};
+    JsonValue::ArrayType* arr = val.arr_;
+    Add(std::move(val));
+    stack_.push_back(Frame{nullptr, arr, nullptr, 0});
+  }
+
+  void EndArray(size_t) { stack_.pop_back(); }
+
+  void String(StringRef str, bool copy) {
+    Add(borrow_strings_ && !copy ? JsonValue::Borrowed(str)
+                                 : JsonValue::String(str, arena_));
+  }
+
+  void Int64(int64_t num) { Add(JsonValue{num}); }
+  void Uint64(uint64_t num) { Add(JsonValue{num}); }
+  void Number(double num) { Add(JsonValue{num}); }
+  void Bool(bool val) { Add(JsonValue{val}); }
+  void Null() { Add(JsonValue{}); }
+
+  // Moves the elements, or members, of container to the end of the innermost
+  // container, which must be of the same type. This joins containers which
+  // were built in parts.
+  void Splice(JsonValue container) {
+    Frame& frame = stack_.back();
+    if (frame.arr) {
+      assert(container.type() == JsonValue::ARRAY);
+      frame.arr->reserve(frame.arr->size() + container.arr_->size());
+      for (JsonValue& val : *container.arr_) {
+        frame.arr->push_back(std::move(val));
+      }
+    } else {
+      assert(container.type() == JsonValue::OBJECT);
+      for (auto& member : container.obj_->members_) {
+        if (arena_) {
+          pending_.emplace_back(Intern(member.first), std::move(member.second));
+        } else if (JsonValue* slot = frame.obj->Insert(member.first)) {
+          *slot = std::move(member.second);
+        }
+      }
+    }
+  }
+
+  JsonValue TakeRoot() { return std::move(root_); }
+
+  // Makes the builder start over with another value, keeping its buffers.
+  // The keys interned so far are forgotten, so this has to be called before
+  // the arena is reset.
+  void Reset(bool borrow_strings) {
+    borrow_strings_ = borrow_strings;
+    root_ = JsonValue();
+    stack_.clear();
+    pending_.clear();
+    keys_ = MakeKeySet();
+    key_nodes_.Rewind(key_nodes_.used());
+    discarded_.clear();
+  }
+
+  // Frees the buffers of the builder which are larger than max_bytes
+  void Trim(size_t max_bytes) {
+    if (stack_.capacity() * sizeof(Frame) > max_bytes) {
+      std::vector<Frame>().swap(stack_);
+    }
+    if (pending_.capacity() * sizeof(pending_[0]) > max_bytes) {
+      decltype(pending_)().swap(pending_);
+    }
+    if (key_nodes_.capacity() > max_bytes) {
+      key_nodes_.Reset();
+    }
+  }
+
+ private:
+  // An object or array which is being built. Containers don't move once
+  // they are created, so it's safe to point to them. The slot is only valid
+  // until the next key.
+  struct Frame {
+    JsonValue::ObjectType* obj;
+    JsonValue::ArrayType* arr;
+    JsonValue* slot;  // where the value of the last key goes
+    size_t pending_begin;  // where the members of obj start in pending_
+  };
+
+  // Moves the pending members of the object of frame into it. Duplicate keys
+  // keep their first value.
+  void AddPendingMembers(const Frame& frame) {
+    const auto begin = pending_.begin() + frame.pending_begin;
+    frame.obj->reserve(pending_.end() - begin);
+    for (auto it = begin; it != pending_.end(); ++it) {
+      if (JsonValue* slot = frame.obj->Insert(it->first, false)) {
+        *slot = std::move(it->second);
+      }
+    }
+    pending_.erase(begin, pending_.end());
+  }
+
+  // The nodes of the set of interned keys are allocated from an arena of
+  // their own, rather than with the document, so they're close together, and
+  // can be reused from one document to the next
+  using KeySet = std::unordered_set<StringRef, StringRefHash,
+                                    std::equal_to<StringRef>,
+                                    ArenaAllocator<StringRef>>;
+
+  static const size_t kKeyNodesChunkSize = 4096;
+
+  KeySet MakeKeySet() {
+    return KeySet(0, StringRefHash(), std::equal_to<StringRef>(),
+                  ArenaAllocator<StringRef>(&key_nodes_));
+  }
+
+  // Returns the copy of key in the arena, making it if it's the first
+  StringRef Intern(StringRef key) {
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+      it = keys_.insert(StringRef{arena_->CopyString(key.data(), key.size()),
+                               key.size()}).first;
+    }
+    return *it;
+  }
+
+  // Adds val to the innermost container, or makes it the root
+  void Add(JsonValue val) {
+    if (stack_.empty()) {
+      root_ = std::move(val);
+    } else if (stack_.back().arr) {
+      stack_.back().arr->push_back(std::move(val));
+    } else {
+      *stack_.back().slot = std::move(val);
+    }
+  }
+
+  Arena* const arena_;
+  bool borrow_strings_;
+
+  JsonValue root_;
+  std::vector<Frame> stack_;
+
+  // Members of the objects on the stack, which are built in an arena
+  std::vector<std::pair<StringRef, JsonValue>> pending_;
+
+  // Keys copied into the arena so far
+  Arena key_nodes_{kKeyNodesChunkSize};
+  KeySet keys_;
+
+  // Values of duplicate keys of objects on the heap are parsed into here, and
+  // thrown away
+  std::deque<JsonValue> discarded_;
+};
+}
@@ -0,0 +1,269 @@
+#include "gzip_reader.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "dom_builder.h"
+#include "push_parser.h"
+
+namespace jp {
+
+namespace {
+
+// zlib counts bytes in unsigned ints, so larger ranges are passed in parts
+const size_t kMaxStreamChunk = 1u << 30;
+
+[[noreturn]] void ThrowGzipError(const z_stream& stream, const char* what) {
+  throw std::runtime_error(std::string("invalid gzip input: ") +
+                           (stream.msg ? stream.msg : what) + " at offset " +
+                           std::to_string(stream.total_in));
+}
+
+// Decompresses a range of gzip members, a buffer at a time
+class Inflater {
+ public:
+  Inflater(const char* p, const char* end) : next_(p), end_(end) {
+    // 32 detects gzip or zlib from the header
+    if (inflateInit2(&stream_, 15 + 32) != Z_OK) {
+      throw std::runtime_error("inflateInit2 failed");
+    }
+  }
+
+  ~Inflater() { inflateEnd(&stream_); }
+
+  Inflater(const Inflater&) = delete;
+  Inflater& operator=(const Inflater&) = delete;
+
+  // Decompresses up to size bytes into out, and returns how many, which is
+  // less than size only at the end of the input
+  size_t Read(char* out, size_t size) {
+    stream_.next_out = reinterpret_cast<Bytef*>(out);
+    stream_.avail_out = static_cast<uInt>(size);
+    while (stream_.avail_out > 0 && !finished_) {
+      Refill();
+      const int ret = inflate(&stream_, Z_NO_FLUSH);
+      if (ret == Z_STREAM_END) {
+        // another member may follow
+        Refill();
+        if (stream_.avail_in == 0) {
+          finished_ = true;
+        } else {
+          inflateReset(&stream_);
+        }
+      } else if (ret == Z_BUF_ERROR && stream_.avail_in == 0) {
+        ThrowGzipError(stream_, "unexpected end of input");
+      } else if (ret != Z_OK) {
+        ThrowGzipError(stream_, "corrupt data");
+      }
+    }
+    return size - stream_.avail_out;
+  }
+
+  bool finished() const { return finished_; }
+
+ private:
+  void Refill() {
+    if (stream_.avail_in == 0 && next_ != end_) {
+      const size_t size = std::min<size_t>(end_ - next_, kMaxStreamChunk);
+      stream_.next_in =
+          reinterpret_cast<Bytef*>(const_cast<char*>(next_));
+      stream_.avail_in = static_cast<uInt>(size);
+      next_ += size;
+    }
+  }
+
+  z_stream stream_ = {};
+  const char* next_;
+  const char* const end_;
+  bool finished_ = false;
+};
+
+// The buffers shared by the decompressing thread, which fills them in turn,
+// and the calling thread, which drains them in the same order
+class Ring {
+ public:
+  Ring(size_t num_buffers, size_t buffer_size) : buffer_size_(buffer_size) {
+    for (size_t i = 0; i < num_buffers; ++i) {
+      buffers_.push_back(Buffer{std::unique_ptr<char[]>(new char[buffer_size]),
+                                0});
+    }
+  }
+
+  // Run by the decompressing thread
+  void Fill(Inflater* inflater) {
+    try {
+      for (size_t i = 0;; ++i) {
+        {
+          std::unique_lock<std::mutex> lock{mutex_};
+          changed_.wait(lock, [&] {
+            return filled_ - drained_ < buffers_.size() || stopped_;
+          });
+          if (stopped_) {
+            return;
+          }
+        }
+        Buffer& buffer = buffers_[i % buffers_.size()];
+        buffer.size = inflater->Read(buffer.data.get(), buffer_size_);
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (buffer.size > 0) {
+          ++filled_;
+        }
+        done_ = inflater->finished();
+        changed_.notify_all();
+        if (done_) {
+          return;
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      error_ = std::current_exception();
+      done_ = true;
+      changed_.notify_all();
+    }
+  }
+
+  // Run by the calling thread, until every buffer is drained, or the
+  // decompressing thread failed
+  void Drain(const GzipReader::Callback& callback) {
+    for (size_t i = 0;; ++i) {
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        changed_.wait(lock, [&] { return filled_ > i || done_; });
+        if (filled_ == i || error_) {
+          return;
+        }
+      }
+      const Buffer& buffer = buffers_[i % buffers_.size()];
+      callback(buffer.data.get(), buffer.size);
+      std::lock_guard<std::mutex> lock{mutex_};
+      ++drained_;
+      changed_.notify_all();
+    }
+  }
+
+  // Makes the decompressing thread stop, after the caller failed
+  void Stop() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopped_ = true;
+    changed_.notify_all();
+  }
+
+  void RethrowError() const {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  struct Buffer {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  std::vector<Buffer> buffers_;
+  const size_t buffer_size_;
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  size_t filled_ = 0;         // guarded by mutex_
+  size_t drained_ = 0;        // guarded by mutex_
+  bool done_ = false;         // guarded by mutex_
+  bool stopped_ = false;      // guarded by mutex_
+  std::exception_ptr error_;  // guarded by mutex_
+};
+}
+
+void GzipReader::Read(const char* p, const char* end,
+                      const Callback& callback) const {
+  Inflater inflater{p, end};
+  const size_t buffer_size =
+      std::min(std::max<size_t>(options_.buffer_size, 1), kMaxStreamChunk);
+  if (!options_.threaded) {
+    std::unique_ptr<char[]> buffer{new char[buffer_size]};
+    while (!inflater.finished()) {
+      const size_t size = inflater.Read(buffer.get(), buffer_size);
+      if (size > 0) {
+        callback(buffer.get(), size);
+      }
+    }
+    return;
+  }
+  Ring ring{std::max<size_t>(options_.num_buffers, 1), buffer_size};
+  std::thread decompressor([&] { ring.Fill(&inflater); });
+  try {
+    ring.Drain(callback);
+  } catch (...) {
+    ring.Stop();
+    decompressor.join();
+    throw;
+  }
+  decompressor.join();
+  ring.RethrowError();
+}
+
+std::string Gunzip(const char* p, const char* end) {
+  Inflater inflater{p, end};
+  std::string out;
+  size_t size = 0;
+  while (!inflater.finished()) {
+    // grows like a vector, and guesses the output is a few times the input
+    out.resize(std::max<size_t>(
+        {2 * out.size(), 4 * static_cast<size_t>(end - p), 4096}));
+    size += inflater.Read(&out[size],
+                          std::min(out.size() - size, kMaxStreamChunk));
+  }
+  out.resize(size);
+  return out;
+}
+
+std::string Gzip(const char* p, const char* end, int level) {
+  z_stream stream = {};
+  // 16 writes a gzip header and trailer, rather than zlib ones
+  if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::invalid_argument("invalid compression level " +
+                                std::to_string(level));
+  }
+  std::string out(deflateBound(&stream, end - p), '\0');
+  size_t size = 0;
+  int ret = Z_OK;
+  while (ret != Z_STREAM_END) {
+    if (stream.avail_in == 0) {
+      const size_t chunk = std::min<size_t>(end - p, kMaxStreamChunk);
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(p));
+      stream.avail_in = static_cast<uInt>(chunk);
+      p += chunk;
+    }
+    stream.next_out = reinterpret_cast<Bytef*>(&out[size]);
+    stream.avail_out =
+        static_cast<uInt>(std::min(out.size() - size, kMaxStreamChunk));
+    const uInt avail_out = stream.avail_out;
+    ret = deflate(&stream, p == end ? Z_FINISH : Z_NO_FLUSH);
+    size += avail_out - stream.avail_out;
+  }
+  deflateEnd(&stream);
+  out.resize(size);
+  return out;
+}
+
+JsonValue ParseGzip(const char* p, const char* end, Arena* arena,
+                    GzipReader::Options options) {
+  DomBuilder builder{arena, false};
+  PushParser<DomBuilder> parser{builder};
+  parser.set_max_depth(options.max_depth);
+  GzipReader{options}.Read(p, end, [&](const char* data, size_t size) {
+    parser.Feed(data, size);
+  });
+  parser.Finish();
+  return builder.TakeRoot();
+}
+}
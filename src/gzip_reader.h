@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "arena.h"
+#include "json_parser.h"
+#include "json_value.h"
+
+namespace jp {
+
+// Decompresses gzip input, with zlib, on a thread of its own, into a ring of
+// buffers, which are handed to the caller in order as they're filled. The
+// caller works on one buffer while the next ones are decompressed, and the
+// whole decompressed input is never in memory at once.
+//
+// Concatenated gzip members are decompressed one after another, like gunzip
+// does. zlib streams are accepted as well.
+class GzipReader {
+ public:
+  struct Options {
+    // Size of each buffer of the ring
+    size_t buffer_size = 256 * 1024;
+
+    // How many buffers the decompressing thread may fill ahead of the caller
+    size_t num_buffers = 4;
+
+    // Otherwise the input is decompressed on the calling thread, a buffer at
+    // a time. With a single core, the threads couldn't run at the same time,
+    // and switching between them only costs time.
+    bool threaded = std::thread::hardware_concurrency() > 1;
+
+    // For ParseGzip, how deeply arrays and objects may be nested, see
+    // JsonParser::set_max_depth
+    size_t max_depth = JsonParser::kDefaultMaxDepth;
+  };
+
+  // Called with the next chunk of the decompressed input, which is only valid
+  // until the callback returns
+  using Callback = std::function<void(const char* data, size_t size)>;
+
+  GzipReader() = default;
+  explicit GzipReader(Options options) : options_(options) {}
+
+  // Decompresses [p, end), and calls callback with every chunk of it, on the
+  // calling thread. Throws std::runtime_error if the input isn't valid gzip.
+  // If the callback throws, decompression stops, and the error is rethrown.
+  void Read(const char* p, const char* end, const Callback& callback) const;
+
+  void Read(const std::string& input, const Callback& callback) const {
+    Read(input.data(), input.data() + input.size(), callback);
+  }
+
+ private:
+  Options options_;
+};
+
+// Decompresses all of the gzip input [p, end) into a string. Throws
+// std::runtime_error if it isn't valid gzip.
+std::string Gunzip(const char* p, const char* end);
+
+// Compresses [p, end) into a gzip member, at the given zlib level
+std::string Gzip(const char* p, const char* end, int level = 6);
+
+// Parses the gzip compressed document [p, end) while it's decompressed, with
+// a PushParser fed from a GzipReader, so that the compressed input, a few
+// buffers and the value are in memory at the same time, but never the whole
+// decompressed input. Nodes and strings are allocated from arena, if it's
+// given, or on the heap otherwise.
+//
+// Throws std::runtime_error if the input isn't valid gzip, or doesn't
+// decompress to a single JSON value, or one nested more deeply than
+// options.max_depth.
+JsonValue ParseGzip(const char* p, const char* end, Arena* arena,
+                    GzipReader::Options options = GzipReader::Options());
+}
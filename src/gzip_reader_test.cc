@@ -0,0 +1,157 @@
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gzip_reader.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+static string MakeDocument(size_t n) {
+  string out = "{\"records\": [";
+  for (size_t i = 0; i < n; ++i) {
+    out += i ? ", " : "";
+    out += "{\"id\": " + std::to_string(i) +
+           ", \"name\": \"record \\\"" + std::to_string(i) +
+           "\\\"\", \"score\": -1.5e3, \"tags\": [true, null]}";
+  }
+  return out + "]}";
+}
+
+static string Gzip(const string& input) {
+  return Gzip(input.data(), input.data() + input.size());
+}
+
+TEST(GzipReader, Chunks) {
+  const string input = MakeDocument(1000);
+  const string compressed = Gzip(input);
+  EXPECT_LT(compressed.size(), input.size() / 4);
+
+  for (bool threaded : {false, true}) {
+    GzipReader::Options options;
+    options.buffer_size = 1000;
+    options.num_buffers = 2;
+    options.threaded = threaded;
+    string out;
+    size_t chunks = 0;
+    GzipReader{options}.Read(compressed, [&](const char* data, size_t size) {
+      EXPECT_LE(size, 1000);
+      out.append(data, size);
+      ++chunks;
+    });
+    EXPECT_EQ(input, out);
+    EXPECT_EQ((input.size() + 999) / 1000, chunks);
+  }
+
+  EXPECT_EQ(input, Gunzip(compressed.data(),
+                          compressed.data() + compressed.size()));
+}
+
+TEST(GzipReader, Members) {
+  // like `cat a.gz b.gz`
+  const string compressed = Gzip("[1, 2") + Gzip(", 3]");
+  EXPECT_EQ("[1, 2, 3]",
+            Gunzip(compressed.data(), compressed.data() + compressed.size()));
+  Arena arena;
+  const JsonValue val = ParseGzip(
+      compressed.data(), compressed.data() + compressed.size(), &arena);
+  EXPECT_EQ(3, val.getArray().size());
+}
+
+TEST(GzipReader, Invalid) {
+  const string compressed = Gzip(MakeDocument(100));
+  const string truncated = compressed.substr(0, compressed.size() / 2);
+  for (bool threaded : {false, true}) {
+    GzipReader::Options options;
+    options.buffer_size = 100;
+    options.threaded = threaded;
+    EXPECT_THROW(
+        GzipReader{options}.Read(truncated, [](const char*, size_t) {}),
+        std::runtime_error);
+  }
+  string corrupt = compressed;
+  corrupt[corrupt.size() / 2] ^= 0x55;
+  EXPECT_THROW(Gunzip(corrupt.data(), corrupt.data() + corrupt.size()),
+               std::runtime_error);
+  const string plain = MakeDocument(1);
+  EXPECT_THROW(Gunzip(plain.data(), plain.data() + plain.size()),
+               std::runtime_error);
+}
+
+TEST(GzipReader, CallbackThrows) {
+  const string compressed = Gzip(MakeDocument(1000));
+  for (bool threaded : {false, true}) {
+    GzipReader::Options options;
+    options.buffer_size = 100;
+    options.threaded = threaded;
+    size_t chunks = 0;
+    EXPECT_THROW(GzipReader{options}.Read(compressed,
+                                          [&](const char*, size_t) {
+                                            if (++chunks == 3) {
+                                              throw std::logic_error("stop");
+                                            }
+                                          }),
+                 std::logic_error);
+    EXPECT_EQ(3, chunks);
+  }
+}
+
+TEST(GzipReader, Parse) {
+  const string input = MakeDocument(1000);
+  const string compressed = Gzip(input);
+  GzipReader::Options options;
+  // tokens are split across buffers
+  options.buffer_size = 7;
+  options.threaded = true;
+  Arena arena;
+  const JsonValue val = ParseGzip(
+      compressed.data(), compressed.data() + compressed.size(), &arena,
+      options);
+  const auto& records = val.getObject().at("records").getArray();
+  ASSERT_EQ(1000, records.size());
+  EXPECT_EQ(999, records[999].getObject().at("id").getInt64());
+  EXPECT_EQ("record \"999\"", records[999].getObject().at("name").getString());
+  EXPECT_EQ(-1500, records[0].getObject().at("score").getNumber());
+
+  // the value is on the heap without an arena
+  const JsonValue copy =
+      ParseGzip(compressed.data(), compressed.data() + compressed.size(),
+                nullptr);
+  EXPECT_EQ(1000, copy.getObject().at("records").getArray().size());
+
+  const string invalid = Gzip("{\"a\": [1, 2}");
+  EXPECT_THROW(ParseGzip(invalid.data(), invalid.data() + invalid.size(),
+                         &arena),
+               std::runtime_error);
+  const string incomplete = Gzip("{\"a\": [1, 2]");
+  EXPECT_THROW(ParseGzip(incomplete.data(),
+                         incomplete.data() + incomplete.size(), &arena),
+               std::runtime_error);
+}
+
+TEST(GzipReader, MaxDepth) {
+  // a few KB compressed, which would be too deep to destroy on the heap
+  const size_t depth = 2000000;
+  const string deep = Gzip(string(depth, '[') + string(depth, ']'));
+  EXPECT_LT(deep.size(), 20 * 1024);
+  try {
+    ParseGzip(deep.data(), deep.data() + deep.size(), nullptr);
+    ADD_FAILURE();
+  } catch (const std::runtime_error& e) {
+    EXPECT_NE(string::npos, string(e.what()).find("nested too deeply"));
+  }
+
+  const string nested = Gzip("[[[1]]]");
+  GzipReader::Options options;
+  options.max_depth = 3;
+  EXPECT_EQ(1, ParseGzip(nested.data(), nested.data() + nested.size(),
+                         nullptr, options)
+                   .getArray()
+                   .size());
+  options.max_depth = 2;
+  EXPECT_THROW(ParseGzip(nested.data(), nested.data() + nested.size(),
+                         nullptr, options),
+               std::runtime_error);
+}
@@ -1,10 +1,31 @@
 #pragma once
 
+#include <cstdio>
+#include <cstdlib>
 #include <string>
 
+// JP_THROW(e) throws e, or if exceptions are disabled, e.g. with
+// -fno-exceptions, prints what it says and aborts. The parser, documents and
+// values compile either way, and their Try and try methods report errors
+// without throwing.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+#define JP_THROW(e) throw e
+#else
+#define JP_THROW(e)                             \
+  do {                                          \
+    std::fprintf(stderr, "%s\n", (e).what());   \
+    std::abort();                               \
+  } while (false)
+#endif
+
 namespace jp {
 
-std::string quote(const char c) {
+// Whether c is whitespace, as far as JSON is concerned
+inline bool IsSpace(const char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+inline std::string quote(const char c) {
   std::string out;
   out += "'";
   out += c;
@@ -0,0 +1,712 @@
+#pragma once
+
+#include <array>
+#include <cinttypes>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if __cplusplus >= 201703L
+#include <optional>
+#endif
+
+#include "dom_builder.h"
+#include "json_parser.h"
+#include "json_value.h"
+#include "json_writer.h"
+#include "string_ref.h"
+
+// JP_FIELDS(Type, fields...) binds the listed public fields of a struct to the
+// members of a JSON object with the same names, so it can be parsed straight
+// into the struct with jp::FromJson, and written with jp::ToJson. It has to
+// be in the namespace of Type:
+//
+//   struct Point {
+//     double x = 0;
+//     double y = 0;
+//     std::vector<std::string> tags;
+//   };
+//   JP_FIELDS(Point, x, y, tags)
+//
+//   Point point = jp::FromJson<Point>(json);
+//   std::string out = jp::ToJson(point);
+//
+// Fields can be bools, integers, floating point numbers, std::strings,
+// std::vectors, std::unique_ptrs and std::optionals (where they are null or
+// missing), JsonValues (which hold any value) or structs with JP_FIELDS
+// themselves, up to 32 of them.
+#define JP_FIELDS(Type, ...)                                      \
+  inline auto JpFields(const Type*) {                             \
+    return ::std::make_tuple(JP_MAP(JP_FIELD, Type, __VA_ARGS__)); \
+  }
+
+#define JP_FIELD(Type, name) ::jp::MakeField(#name, &Type::name)
+
+// Applies M(T, arg) to each argument, separated by commas
+#define JP_MAP(M, T, ...) \
+  JP_EXPAND(JP_CONCAT(JP_MAP_, JP_NUM_ARGS(__VA_ARGS__))(M, T, __VA_ARGS__))
+#define JP_EXPAND(x) x
+#define JP_CONCAT(a, b) JP_CONCAT_(a, b)
+#define JP_CONCAT_(a, b) a##b
+#define JP_NUM_ARGS(...) \
+  JP_EXPAND(JP_NUM_ARGS_(__VA_ARGS__, 32, 31, 30, \
+    29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, \
+    11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define JP_NUM_ARGS_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, \
+    _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, \
+    _28, _29, _30, _31, _32, N, ...) N
+#define JP_MAP_1(M, T, a) M(T, a)
+#define JP_MAP_2(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_1(M, T, __VA_ARGS__))
+#define JP_MAP_3(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_2(M, T, __VA_ARGS__))
+#define JP_MAP_4(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_3(M, T, __VA_ARGS__))
+#define JP_MAP_5(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_4(M, T, __VA_ARGS__))
+#define JP_MAP_6(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_5(M, T, __VA_ARGS__))
+#define JP_MAP_7(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_6(M, T, __VA_ARGS__))
+#define JP_MAP_8(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_7(M, T, __VA_ARGS__))
+#define JP_MAP_9(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_8(M, T, __VA_ARGS__))
+#define JP_MAP_10(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_9(M, T, __VA_ARGS__))
+#define JP_MAP_11(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_10(M, T, __VA_ARGS__))
+#define JP_MAP_12(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_11(M, T, __VA_ARGS__))
+#define JP_MAP_13(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_12(M, T, __VA_ARGS__))
+#define JP_MAP_14(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_13(M, T, __VA_ARGS__))
+#define JP_MAP_15(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_14(M, T, __VA_ARGS__))
+#define JP_MAP_16(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_15(M, T, __VA_ARGS__))
+#define JP_MAP_17(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_16(M, T, __VA_ARGS__))
+#define JP_MAP_18(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_17(M, T, __VA_ARGS__))
+#define JP_MAP_19(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_18(M, T, __VA_ARGS__))
+#define JP_MAP_20(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_19(M, T, __VA_ARGS__))
+#define JP_MAP_21(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_20(M, T, __VA_ARGS__))
+#define JP_MAP_22(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_21(M, T, __VA_ARGS__))
+#define JP_MAP_23(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_22(M, T, __VA_ARGS__))
+#define JP_MAP_24(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_23(M, T, __VA_ARGS__))
+#define JP_MAP_25(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_24(M, T, __VA_ARGS__))
+#define JP_MAP_26(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_25(M, T, __VA_ARGS__))
+#define JP_MAP_27(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_26(M, T, __VA_ARGS__))
+#define JP_MAP_28(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_27(M, T, __VA_ARGS__))
+#define JP_MAP_29(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_28(M, T, __VA_ARGS__))
+#define JP_MAP_30(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_29(M, T, __VA_ARGS__))
+#define JP_MAP_31(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_30(M, T, __VA_ARGS__))
+#define JP_MAP_32(M, T, a, ...) M(T, a), JP_EXPAND(JP_MAP_31(M, T, __VA_ARGS__))
+
+namespace jp {
+
+// A field of T, as described by JP_FIELDS
+template <typename T, typename M>
+struct BoundField {
+  StringRef name;
+  M T::*member;
+};
+
+template <typename T, typename M, size_t N>
+BoundField<T, M> MakeField(const char (&name)[N], M T::*member) {
+  return BoundField<T, M>{StringRef{name, N - 1}, member};
+}
+
+class Binding;
+
+// A C++ value, and the Binding of its type
+struct BindTarget {
+  const Binding* binding;
+  void* obj;
+
+  // Targets without a binding are for values which are skipped
+  explicit operator bool() const { return binding != nullptr; }
+};
+
+// A Binding stores JSON values into C++ values of a certain type, which obj
+// points to. The methods for JSON values that the type can't hold throw
+// std::runtime_error.
+class Binding {
+ public:
+  static const size_t kNoField = static_cast<size_t>(-1);
+
+  // expected is what the JSON value has to be, for error messages
+  constexpr explicit Binding(const char* expected) : expected_(expected) {}
+
+  virtual void String(void*, StringRef) const { Mismatch("a string"); }
+  virtual void Int64(void*, int64_t) const { Mismatch("an integer"); }
+  virtual void Uint64(void*, uint64_t) const { Mismatch("an integer"); }
+  virtual void Number(void*, double) const { Mismatch("a number"); }
+  virtual void Bool(void*, bool) const { Mismatch("a bool"); }
+  virtual void Null(void*) const { Mismatch("null"); }
+
+  // Called before the members or elements are bound. If obj is a JsonValue,
+  // returns it, and the whole object or array should be stored into it.
+  virtual JsonValue* StartObject(void*) const { Mismatch("an object"); }
+  virtual JsonValue* StartArray(void*) const { Mismatch("an array"); }
+
+  // Returns the position of the field named key, or kNoField. Members are
+  // usually in the order of the fields, so the search starts from hint.
+  virtual size_t FindField(StringRef, size_t) const { return kNoField; }
+  virtual BindTarget Field(void*, size_t) const { return BindTarget{}; }
+
+  // Appends an element to the array, and returns it
+  virtual BindTarget Element(void*) const { return BindTarget{}; }
+
+ protected:
+  [[noreturn]] void Mismatch(const char* got) const {
+    throw std::runtime_error(std::string("expected ") + expected_ + ", got " +
+                             got);
+  }
+
+ private:
+  const char* const expected_;
+};
+
+// The Binding of T, which also writes values of T to a JsonWriter. This
+// primary template is for structs with JP_FIELDS.
+template <typename T, typename Enable = void>
+class TypeBinding;
+
+template <typename T>
+const Binding* BindingOf() {
+  static const TypeBinding<T> binding;
+  return &binding;
+}
+
+template <typename T>
+bool InRange(int64_t num) {
+  if (num < 0) {
+    return std::is_signed<T>::value &&
+           num >= static_cast<int64_t>(std::numeric_limits<T>::min());
+  }
+  return static_cast<uint64_t>(num) <=
+         static_cast<uint64_t>(std::numeric_limits<T>::max());
+}
+
+template <typename T>
+bool InRange(uint64_t num) {
+  return num <= static_cast<uint64_t>(std::numeric_limits<T>::max());
+}
+
+template <typename T, typename Enable>
+class TypeBinding : public Binding {
+  using Fields = decltype(JpFields(static_cast<const T*>(nullptr)));
+  static const size_t kNumFields = std::tuple_size<Fields>::value;
+  static_assert(kNumFields <= 64, "too many fields");
+
+ public:
+  constexpr TypeBinding() : Binding("an object") {}
+
+  JsonValue* StartObject(void*) const override { return nullptr; }
+
+  size_t FindField(StringRef key, size_t hint) const override {
+    static const std::array<StringRef, kNumFields> names =
+        Names(std::make_index_sequence<kNumFields>());
+    for (size_t i = hint; i < kNumFields; ++i) {
+      if (names[i] == key) {
+        return i;
+      }
+    }
+    for (size_t i = 0; i < hint && i < kNumFields; ++i) {
+      if (names[i] == key) {
+        return i;
+      }
+    }
+    return kNoField;
+  }
+
+  BindTarget Field(void* obj, size_t i) const override {
+    return Field(static_cast<T*>(obj), i,
+                 std::make_index_sequence<kNumFields>());
+  }
+
+  static void Write(JsonWriter& writer, const T& value) {
+    writer.StartObject();
+    WriteFields(writer, value, std::make_index_sequence<kNumFields>());
+    writer.EndObject(kNumFields);
+  }
+
+ private:
+  template <size_t... I>
+  static std::array<StringRef, kNumFields> Names(std::index_sequence<I...>) {
+    const Fields fields = JpFields(static_cast<const T*>(nullptr));
+    return {{std::get<I>(fields).name...}};
+  }
+
+  template <size_t I>
+  static BindTarget FieldTarget(T* obj) {
+    const auto field = std::get<I>(JpFields(obj));
+    auto* member = &(obj->*field.member);
+    return BindTarget{BindingOf<typename std::remove_pointer<decltype(
+                          member)>::type>(),
+                      member};
+  }
+
+  // Dispatches to FieldTarget<i> through a table
+  template <size_t... I>
+  static BindTarget Field(T* obj, size_t i, std::index_sequence<I...>) {
+    using Getter = BindTarget (*)(T*);
+    static constexpr Getter getters[] = {&FieldTarget<I>...};
+    return getters[i](obj);
+  }
+
+  template <typename M>
+  static void WriteField(JsonWriter& writer, const T& value,
+                         const BoundField<T, M>& field) {
+    writer.Key(field.name, false);
+    TypeBinding<M>::Write(writer, value.*field.member);
+  }
+
+  template <size_t... I>
+  static void WriteFields(JsonWriter& writer, const T& value,
+                          std::index_sequence<I...>) {
+    const Fields fields = JpFields(&value);
+    (void)std::initializer_list<int>{
+        (WriteField(writer, value, std::get<I>(fields)), 0)...};
+  }
+};
+
+template <>
+class TypeBinding<bool> : public Binding {
+ public:
+  constexpr TypeBinding() : Binding("a bool") {}
+
+  void Bool(void* obj, bool val) const override {
+    *static_cast<bool*>(obj) = val;
+  }
+
+  static void Write(JsonWriter& writer, bool value) { writer.Bool(value); }
+};
+
+// Integers which don't fit into T throw std::out_of_range
+template <typename T>
+class TypeBinding<T, typename std::enable_if<std::is_integral<T>::value>::type>
+    : public Binding {
+ public:
+  constexpr TypeBinding() : Binding("an integer") {}
+
+  void Int64(void* obj, int64_t num) const override { Store(obj, num); }
+  void Uint64(void* obj, uint64_t num) const override { Store(obj, num); }
+
+  static void Write(JsonWriter& writer, T value) {
+    if (std::is_signed<T>::value) {
+      writer.Int64(static_cast<int64_t>(value));
+    } else {
+      writer.Uint64(static_cast<uint64_t>(value));
+    }
+  }
+
+ private:
+  template <typename N>
+  static void Store(void* obj, N num) {
+    if (!InRange<T>(num)) {
+      throw std::out_of_range("integer out of range: " + std::to_string(num));
+    }
+    *static_cast<T*>(obj) = static_cast<T>(num);
+  }
+};
+
+template <typename T>
+class TypeBinding<
+    T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+    : public Binding {
+ public:
+  constexpr TypeBinding() : Binding("a number") {}
+
+  void Int64(void* obj, int64_t num) const override {
+    *static_cast<T*>(obj) = static_cast<T>(num);
+  }
+  void Uint64(void* obj, uint64_t num) const override {
+    *static_cast<T*>(obj) = static_cast<T>(num);
+  }
+  void Number(void* obj, double num) const override {
+    *static_cast<T*>(obj) = static_cast<T>(num);
+  }
+
+  static void Write(JsonWriter& writer, T value) { writer.Number(value); }
+};
+
+template <>
+class TypeBinding<std::string> : public Binding {
+ public:
+  constexpr TypeBinding() : Binding("a string") {}
+
+  void String(void* obj, StringRef str) const override {
+    static_cast<std::string*>(obj)->assign(str.data(), str.size());
+  }
+
+  static void Write(JsonWriter& writer, const std::string& value) {
+    writer.String(value, false);
+  }
+};
+
+// Holds any JSON value, on the heap
+template <>
+class TypeBinding<JsonValue> : public Binding {
+ public:
+  constexpr TypeBinding() : Binding("a value") {}
+
+  void String(void* obj, StringRef str) const override {
+    *static_cast<JsonValue*>(obj) = JsonValue{str};
+  }
+  void Int64(void* obj, int64_t num) const override {
+    *static_cast<JsonValue*>(obj) = JsonValue{num};
+  }
+  void Uint64(void* obj, uint64_t num) const override {
+    *static_cast<JsonValue*>(obj) = JsonValue{num};
+  }
+  void Number(void* obj, double num) const override {
+    *static_cast<JsonValue*>(obj) = JsonValue{num};
+  }
+  void Bool(void* obj, bool val) const override {
+    *static_cast<JsonValue*>(obj) = JsonValue{val};
+  }
+  void Null(void* obj) const override {
+    *static_cast<JsonValue*>(obj) = JsonValue{};
+  }
+
+  JsonValue* StartObject(void* obj) const override {
+    return static_cast<JsonValue*>(obj);
+  }
+  JsonValue* StartArray(void* obj) const override {
+    return static_cast<JsonValue*>(obj);
+  }
+
+  static void Write(JsonWriter& writer, const JsonValue& value) {
+    writer.Write(value);
+  }
+};
+
+template <typename E>
+class TypeBinding<std::vector<E>> : public Binding {
+  static_assert(!std::is_same<E, bool>::value,
+                "std::vector<bool> can't be bound, as it has no bool&");
+
+ public:
+  constexpr TypeBinding() : Binding("an array") {}
+
+  JsonValue* StartArray(void* obj) const override {
+    static_cast<std::vector<E>*>(obj)->clear();
+    return nullptr;
+  }
+
+  BindTarget Element(void* obj) const override {
+    auto& vec = *static_cast<std::vector<E>*>(obj);
+    vec.emplace_back();
+    return BindTarget{BindingOf<E>(), &vec.back()};
+  }
+
+  static void Write(JsonWriter& writer, const std::vector<E>& value) {
+    writer.StartArray();
+    for (const E& element : value) {
+      TypeBinding<E>::Write(writer, element);
+    }
+    writer.EndArray(value.size());
+  }
+};
+
+// Optional values, which are empty if they are null, and which are made when
+// there's a value for them. O is the type of the optional.
+template <typename O, typename E>
+class OptionalBinding : public Binding {
+ public:
+  constexpr OptionalBinding() : Binding("a value") {}
+
+  void String(void* obj, StringRef str) const override {
+    BindingOf<E>()->String(Emplace(obj), str);
+  }
+  void Int64(void* obj, int64_t num) const override {
+    BindingOf<E>()->Int64(Emplace(obj), num);
+  }
+  void Uint64(void* obj, uint64_t num) const override {
+    BindingOf<E>()->Uint64(Emplace(obj), num);
+  }
+  void Number(void* obj, double num) const override {
+    BindingOf<E>()->Number(Emplace(obj), num);
+  }
+  void Bool(void* obj, bool val) const override {
+    BindingOf<E>()->Bool(Emplace(obj), val);
+  }
+  void Null(void* obj) const override { static_cast<O*>(obj)->reset(); }
+
+  JsonValue* StartObject(void* obj) const override {
+    return BindingOf<E>()->StartObject(Emplace(obj));
+  }
+  JsonValue* StartArray(void* obj) const override {
+    return BindingOf<E>()->StartArray(Emplace(obj));
+  }
+
+  size_t FindField(StringRef key, size_t hint) const override {
+    return BindingOf<E>()->FindField(key, hint);
+  }
+  BindTarget Field(void* obj, size_t i) const override {
+    return BindingOf<E>()->Field(&**static_cast<O*>(obj), i);
+  }
+  BindTarget Element(void* obj) const override {
+    return BindingOf<E>()->Element(&**static_cast<O*>(obj));
+  }
+
+  static void Write(JsonWriter& writer, const O& value) {
+    if (value) {
+      TypeBinding<E>::Write(writer, *value);
+    } else {
+      writer.Null();
+    }
+  }
+
+ private:
+  static E* Emplace(void* obj) {
+    O& opt = *static_cast<O*>(obj);
+    if (!opt) {
+      Make(opt);
+    }
+    return &*opt;
+  }
+
+  static void Make(std::unique_ptr<E>& opt) { opt.reset(new E()); }
+#if __cplusplus >= 201703L
+  static void Make(std::optional<E>& opt) { opt.emplace(); }
+#endif
+};
+
+template <typename E>
+class TypeBinding<std::unique_ptr<E>>
+    : public OptionalBinding<std::unique_ptr<E>, E> {};
+
+#if __cplusplus >= 201703L
+template <typename E>
+class TypeBinding<std::optional<E>>
+    : public OptionalBinding<std::optional<E>, E> {};
+#endif
+
+// ValueBinder is a JsonParser handler, which stores the parsed value into a
+// C++ value through its Binding. Members without a field are skipped, and so
+// are the values of duplicate keys, which keep their first value.
+class ValueBinder {
+ public:
+  explicit ValueBinder(BindTarget root) : next_(root) {}
+
+  void StartObject() {
+    if (passthrough_depth_ > 0) {
+      StartPassthrough(nullptr);
+      if (capture_) {
+        builder_->StartObject();
+      }
+      return;
+    }
+    const BindTarget target = NextTarget();
+    JsonValue* capture = nullptr;
+    if (!target.binding ||
+        (capture = target.binding->StartObject(target.obj))) {
+      StartPassthrough(capture);
+      if (capture_) {
+        builder_->StartObject();
+      }
+      return;
+    }
+    stack_.push_back(Frame{target, false, 0, 0});
+  }
+
+  void Key(StringRef key, bool copy) {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->Key(key, copy);
+      }
+      return;
+    }
+    Frame& frame = stack_.back();
+    const Binding& binding = *frame.target.binding;
+    const size_t i = binding.FindField(key, frame.next_field);
+    if (i == Binding::kNoField || (frame.seen >> i & 1)) {
+      next_ = BindTarget{};
+      return;
+    }
+    frame.seen |= uint64_t{1} << i;
+    frame.next_field = i + 1;
+    next_ = binding.Field(frame.target.obj, i);
+  }
+
+  void EndObject(size_t num_members) {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->EndObject(num_members);
+      }
+      EndPassthrough();
+      return;
+    }
+    stack_.pop_back();
+  }
+
+  void StartArray() {
+    if (passthrough_depth_ > 0) {
+      StartPassthrough(nullptr);
+      if (capture_) {
+        builder_->StartArray();
+      }
+      return;
+    }
+    const BindTarget target = NextTarget();
+    JsonValue* capture = nullptr;
+    if (!target.binding ||
+        (capture = target.binding->StartArray(target.obj))) {
+      StartPassthrough(capture);
+      if (capture_) {
+        builder_->StartArray();
+      }
+      return;
+    }
+    stack_.push_back(Frame{target, true, 0, 0});
+  }
+
+  void EndArray(size_t num_elements) {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->EndArray(num_elements);
+      }
+      EndPassthrough();
+      return;
+    }
+    stack_.pop_back();
+  }
+
+  void String(StringRef str, bool copy) {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->String(str, copy);
+      }
+    } else if (const BindTarget target = NextTarget()) {
+      target.binding->String(target.obj, str);
+    }
+  }
+
+  void Int64(int64_t num) {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->Int64(num);
+      }
+    } else if (const BindTarget target = NextTarget()) {
+      target.binding->Int64(target.obj, num);
+    }
+  }
+
+  void Uint64(uint64_t num) {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->Uint64(num);
+      }
+    } else if (const BindTarget target = NextTarget()) {
+      target.binding->Uint64(target.obj, num);
+    }
+  }
+
+  void Number(double num) {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->Number(num);
+      }
+    } else if (const BindTarget target = NextTarget()) {
+      target.binding->Number(target.obj, num);
+    }
+  }
+
+  void Bool(bool val) {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->Bool(val);
+      }
+    } else if (const BindTarget target = NextTarget()) {
+      target.binding->Bool(target.obj, val);
+    }
+  }
+
+  void Null() {
+    if (passthrough_depth_ > 0) {
+      if (capture_) {
+        builder_->Null();
+      }
+    } else if (const BindTarget target = NextTarget()) {
+      target.binding->Null(target.obj);
+    }
+  }
+
+ private:
+  // An object or array whose members, or elements, are being bound
+  struct Frame {
+    BindTarget target;
+    bool array;
+    uint64_t seen;      // fields which have been bound
+    size_t next_field;  // where the next member probably is
+  };
+
+  // Returns where the next value goes, which is nowhere if it's skipped
+  BindTarget NextTarget() {
+    if (!stack_.empty() && stack_.back().array) {
+      const BindTarget& array = stack_.back().target;
+      return array.binding->Element(array.obj);
+    }
+    const BindTarget target = next_;
+    next_ = BindTarget{};
+    return target;
+  }
+
+  // Skips the object or array which has started, or captures it into a
+  // JsonValue, together with everything in it
+  void StartPassthrough(JsonValue* capture) {
+    if (passthrough_depth_++ == 0) {
+      capture_ = capture;
+      if (capture_ && !builder_) {
+        builder_.reset(new DomBuilder{nullptr, false});
+      }
+    }
+  }
+
+  void EndPassthrough() {
+    if (--passthrough_depth_ == 0 && capture_) {
+      *capture_ = builder_->TakeRoot();
+      capture_ = nullptr;
+    }
+  }
+
+  BindTarget next_;
+  std::vector<Frame> stack_;
+
+  // Depth of the skipped or captured value, if the parser is in one
+  size_t passthrough_depth_ = 0;
+  JsonValue* capture_ = nullptr;
+  std::unique_ptr<DomBuilder> builder_;
+};
+
+// Parses json into value, which is bound to JSON with JP_FIELDS. Members
+// which aren't in json keep their value.
+template <typename T>
+void FromJson(const char* p, const char* end, T* value) {
+  ValueBinder binder{BindTarget{BindingOf<T>(), value}};
+  JsonParser{p, end}.Parse(binder);
+}
+
+template <typename T>
+void FromJson(const std::string& json, T* value) {
+  FromJson(json.data(), json.data() + json.size(), value);
+}
+
+template <typename T>
+T FromJson(const std::string& json) {
+  T value = T();
+  FromJson(json, &value);
+  return value;
+}
+
+// Writes value, which is bound to JSON with JP_FIELDS
+template <typename T>
+void Write(JsonWriter& writer, const T& value) {
+  TypeBinding<T>::Write(writer, value);
+}
+
+template <typename T, typename = typename std::enable_if<
+                          !std::is_same<T, JsonValue>::value>::type>
+std::string ToJson(const T& value,
+                   JsonWriter::Options options = JsonWriter::Options()) {
+  std::string out;
+  {
+    JsonWriter writer{&out, options};
+    Write(writer, value);
+  }
+  return out;
+}
+}
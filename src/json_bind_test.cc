@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "json_bind.h"
+#include "json_parser.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+struct Address {
+  string city;
+  int zip = 0;
+};
+JP_FIELDS(Address, city, zip)
+
+struct Person {
+  string name;
+  int64_t id = 0;
+  uint8_t age = 0;
+  double score = 0;
+  bool active = false;
+  std::vector<string> tags;
+  std::vector<Address> addresses;
+  std::unique_ptr<Address> home;
+  JsonValue extra;
+};
+JP_FIELDS(Person, name, id, age, score, active, tags, addresses, home, extra)
+
+const string kPerson =
+    "{\"name\":\"Ann\",\"id\":-12345678901,\"age\":42,\"score\":2.5,"
+    "\"active\":true,\"tags\":[\"a\",\"b\"],\"addresses\":[{\"city\":\"X\","
+    "\"zip\":1},{\"city\":\"Y\",\"zip\":2}],\"home\":{\"city\":\"Z\","
+    "\"zip\":3},\"extra\":{\"k\":[1,null]}}";
+
+TEST(JsonBind, FromJson) {
+  const Person person = FromJson<Person>(kPerson);
+  EXPECT_EQ("Ann", person.name);
+  EXPECT_EQ(-12345678901, person.id);
+  EXPECT_EQ(42, person.age);
+  EXPECT_EQ(2.5, person.score);
+  EXPECT_TRUE(person.active);
+  EXPECT_EQ((std::vector<string>{"a", "b"}), person.tags);
+  ASSERT_EQ(2, person.addresses.size());
+  EXPECT_EQ("Y", person.addresses[1].city);
+  EXPECT_EQ(2, person.addresses[1].zip);
+  ASSERT_TRUE(person.home);
+  EXPECT_EQ("Z", person.home->city);
+  EXPECT_EQ(2, person.extra.getObject().at("k").getArray().size());
+}
+
+TEST(JsonBind, RoundTrip) {
+  EXPECT_EQ(kPerson, ToJson(FromJson<Person>(kPerson)));
+
+  Person person;
+  person.name = "a\"b";
+  person.score = 0.1;
+  EXPECT_EQ(
+      "{\"name\":\"a\\\"b\",\"id\":0,\"age\":0,\"score\":0.1,\"active\":false,"
+      "\"tags\":[],\"addresses\":[],\"home\":null,\"extra\":null}",
+      ToJson(person));
+}
+
+TEST(JsonBind, Members) {
+  Person person;
+  person.id = 7;
+  person.tags = {"old"};
+  FromJson(
+      "{\"unknown\": {\"name\": \"x\", \"a\": [[], {}]}, \"age\": 1,"
+      " \"tags\": [], \"home\": null, \"name\": \"B\", \"name\": \"C\"}",
+      &person);
+
+  // missing members keep their value, and duplicates their first one
+  EXPECT_EQ(7, person.id);
+  EXPECT_EQ("B", person.name);
+  EXPECT_EQ(1, person.age);
+  EXPECT_TRUE(person.tags.empty());
+  EXPECT_FALSE(person.home);
+  EXPECT_TRUE(person.extra.is<JsonValue::NULL_VALUE>());
+}
+
+TEST(JsonBind, Mismatches) {
+  Person person;
+  EXPECT_THROW(FromJson("{\"name\": 1}", &person), std::runtime_error);
+  EXPECT_THROW(FromJson("{\"id\": 1.5}", &person), std::runtime_error);
+  EXPECT_THROW(FromJson("{\"tags\": {}}", &person), std::runtime_error);
+  EXPECT_THROW(FromJson("{\"home\": []}", &person), std::runtime_error);
+  EXPECT_THROW(FromJson("{\"active\": null}", &person), std::runtime_error);
+  EXPECT_THROW(FromJson("[]", &person), std::runtime_error);
+  EXPECT_THROW(FromJson("{\"age\": 256}", &person), std::out_of_range);
+  EXPECT_THROW(FromJson("{\"id\": 9223372036854775808}", &person),
+               std::out_of_range);
+  EXPECT_THROW(FromJson("{\"name\": \"x\"", &person), std::runtime_error);
+
+  std::vector<uint64_t> nums;
+  FromJson("[0, 18446744073709551615]", &nums);
+  EXPECT_EQ(UINT64_MAX, nums[1]);
+  EXPECT_THROW(FromJson("[-1]", &nums), std::out_of_range);
+}
+
+TEST(JsonBind, Values) {
+  EXPECT_EQ(3, FromJson<int>("3"));
+  EXPECT_EQ(3.0, FromJson<double>("3"));
+  EXPECT_EQ("x", FromJson<string>("\"x\""));
+  EXPECT_EQ((std::vector<std::vector<int>>{{1}, {}}),
+            (FromJson<std::vector<std::vector<int>>>("[[1], []]")));
+  EXPECT_EQ("[[1],[]]", ToJson(std::vector<std::vector<int>>{{1}, {}}));
+
+  JsonWriter::Options options;
+  options.pretty = true;
+  options.indent = 1;
+  Address address;
+  address.city = "X";
+  EXPECT_EQ("{\n \"city\": \"X\",\n \"zip\": 0\n}", ToJson(address, options));
+}
+}
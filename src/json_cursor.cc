@@ -0,0 +1,153 @@
+#include "json_cursor.h"
+
+#include <stdexcept>
+
+#include "dom_builder.h"
+#include "json_parser.h"
+#include "json_scan.h"
+
+namespace jp {
+
+namespace {
+
+const char* kTypeNames[] = {"an object", "an array", "a string",
+                            "a number",  "a bool",   "null"};
+
+[[noreturn]] void ThrowWrongType(JsonValue::Type expected) {
+  throw std::runtime_error(std::string("not ") + kTypeNames[expected]);
+}
+}
+
+JsonCursor::JsonCursor(const char* p, const char* end)
+    : p_(SkipSpace(p, end)), end_(end) {
+  if (p_ == end_) {
+    ThrowEndOfInput();
+  }
+}
+
+JsonValue::Type JsonCursor::type() const {
+  switch (*p_) {
+    case '{':
+      return JsonValue::OBJECT;
+    case '[':
+      return JsonValue::ARRAY;
+    case '"':
+      return JsonValue::STRING;
+    case 't':
+    case 'f':
+      return JsonValue::BOOL;
+    case 'n':
+      return JsonValue::NULL_VALUE;
+    default:
+      return JsonValue::NUMBER;
+  }
+}
+
+const char* JsonCursor::Find(StringRef key) const {
+  if (type() != JsonValue::OBJECT) {
+    ThrowWrongType(JsonValue::OBJECT);
+  }
+  for (const char* p = FirstInContainer(p_, end_, '{', '}'); p;
+       p = NextInContainer(p, end_, '}')) {
+    if (p == end_) {
+      ThrowEndOfInput();
+    }
+    if (*p != '"') {
+      throw std::runtime_error("expected a key");
+    }
+    const char* key_end = SkipString(p, end_);
+    const bool found = KeyEquals(p, key_end, key);
+    p = Consume(SkipSpace(key_end, end_), end_, ':');
+    if (found) {
+      return p;
+    }
+    p = SkipValue(p, end_);
+  }
+  return nullptr;
+}
+
+JsonCursor JsonCursor::operator[](StringRef key) const {
+  const char* p = Find(key);
+  if (!p) {
+    throw std::out_of_range("no such key: " + key.str());
+  }
+  return JsonCursor{p, end_};
+}
+
+bool JsonCursor::contains(StringRef key) const { return Find(key); }
+
+JsonCursor JsonCursor::operator[](size_t index) const {
+  if (type() != JsonValue::ARRAY) {
+    ThrowWrongType(JsonValue::ARRAY);
+  }
+  size_t i = 0;
+  for (const char* p = FirstInContainer(p_, end_, '[', ']'); p;
+       p = NextInContainer(SkipValue(p, end_), end_, ']'), ++i) {
+    if (p == end_) {
+      ThrowEndOfInput();
+    }
+    if (i == index) {
+      return JsonCursor{p, end_};
+    }
+  }
+  throw std::out_of_range("index out of range: " + std::to_string(index));
+}
+
+size_t JsonCursor::size() const {
+  const JsonValue::Type t = type();
+  if (t != JsonValue::OBJECT && t != JsonValue::ARRAY) {
+    throw std::runtime_error("not a container");
+  }
+  const char open = *p_;
+  const char close = open == '{' ? '}' : ']';
+  size_t n = 0;
+  for (const char* p = FirstInContainer(p_, end_, open, close); p;
+       p = NextInContainer(SkipValue(p, end_), end_, close)) {
+    if (p == end_) {
+      ThrowEndOfInput();
+    }
+    if (open == '{') {
+      p = Consume(SkipSpace(SkipString(p, end_), end_), end_, ':');
+    }
+    ++n;
+  }
+  return n;
+}
+
+JsonValue JsonCursor::ParseScalar() const {
+  const JsonValue::Type t = type();
+  if (t == JsonValue::OBJECT || t == JsonValue::ARRAY) {
+    // so that the getter throws
+    return t == JsonValue::OBJECT ? JsonValue{JsonValue::ObjectType{}}
+                                  : JsonValue{JsonValue::ArrayType{}};
+  }
+  DomBuilder builder{nullptr, false};
+  JsonParser{p_, end_}.ParseScalar(builder);
+  return builder.TakeRoot();
+}
+
+std::string JsonCursor::getString() const {
+  return ParseScalar().getString().str();
+}
+
+JsonValue::NumberType JsonCursor::getNumber() const {
+  return ParseScalar().getNumber();
+}
+
+int64_t JsonCursor::getInt64() const { return ParseScalar().getInt64(); }
+
+uint64_t JsonCursor::getUint64() const { return ParseScalar().getUint64(); }
+
+JsonValue::BoolType JsonCursor::getBool() const {
+  return ParseScalar().getBool();
+}
+
+StringRef JsonCursor::raw() const {
+  return StringRef{p_, static_cast<size_t>(SkipValue(p_, end_) - p_)};
+}
+
+JsonValue JsonCursor::Parse() const {
+  const StringRef json = raw();
+  return JsonParser{json.begin(), json.end()}.Parse();
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cinttypes>
+#include <string>
+
+#include "json_value.h"
+#include "string_ref.h"
+
+namespace jp {
+
+// A JsonCursor points to a value of a JSON input, which is parsed on demand,
+// only as far as it's accessed. Looking up a key or an index skips the values
+// before it with a bracket matching scan, without parsing or allocating
+// anything for them, so reading a few fields of a large document is cheap:
+//
+//   JsonCursor doc{json};
+//   std::string name = doc["events"][3]["name"].getString();
+//
+// Only the parts of the input which are visited are validated. The input must
+// outlive the cursor, and cursors are cheap to copy.
+class JsonCursor {
+ public:
+  JsonCursor(const char* p, const char* end);
+  explicit JsonCursor(const std::string& json)
+      : JsonCursor(json.data(), json.data() + json.size()) {}
+
+  JsonValue::Type type() const;
+
+  // The value of key, which is the first one, if the key is duplicated.
+  // Throws std::out_of_range if there's no such key.
+  JsonCursor operator[](StringRef key) const;
+
+  // Throws std::out_of_range if the array is too short
+  JsonCursor operator[](size_t index) const;
+
+  bool contains(StringRef key) const;
+
+  // Number of elements of an array, or members of an object
+  size_t size() const;
+
+  std::string getString() const;
+  JsonValue::NumberType getNumber() const;
+  int64_t getInt64() const;
+  uint64_t getUint64() const;
+  JsonValue::BoolType getBool() const;
+  bool isNull() const { return type() == JsonValue::NULL_VALUE; }
+
+  // The JSON text of the value
+  StringRef raw() const;
+
+  // Parses the whole value, like JsonParser::Parse()
+  JsonValue Parse() const;
+
+ private:
+  // Finds the value of key, or returns nullptr
+  const char* Find(StringRef key) const;
+
+  // Parses the scalar value at the cursor
+  JsonValue ParseScalar() const;
+
+  const char* p_;
+  const char* end_;
+};
+}
@@ -0,0 +1,84 @@
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "json_cursor.h"
+#include "json_parser.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+const string kJson =
+    " {\"skipped\": {\"a\": [1, {\"b\": \"}]\\\"\"}], \"c\": \"x\"},"
+    " \"events\": [{\"name\": \"first\"}, [], \"[{\", -1.5e1,"
+    "   {\"name\": \"second\", \"id\": 18446744073709551615}],"
+    " \"esc\\taped\": true, \"null\": null, \"dup\": 1, \"dup\": 2} ";
+}
+
+TEST(JsonCursor, Lookup) {
+  const JsonCursor doc{kJson};
+  EXPECT_EQ(JsonValue::OBJECT, doc.type());
+  EXPECT_EQ("first", doc["events"][0]["name"].getString());
+  EXPECT_EQ("second", doc["events"][4]["name"].getString());
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(),
+            doc["events"][4]["id"].getUint64());
+  EXPECT_EQ("[{", doc["events"][2].getString());
+  EXPECT_EQ(-15, doc["events"][3].getNumber());
+  EXPECT_EQ(-15, doc["events"][3].getInt64());
+  EXPECT_TRUE(doc["esc\taped"].getBool());
+  EXPECT_TRUE(doc["null"].isNull());
+  EXPECT_EQ(1, doc["dup"].getNumber());
+  EXPECT_EQ("}]\"", doc["skipped"]["a"][1]["b"].getString());
+
+  EXPECT_EQ(6, doc.size());
+  EXPECT_EQ(5, doc["events"].size());
+  EXPECT_EQ(0, doc["events"][1].size());
+  EXPECT_TRUE(doc.contains("events"));
+  EXPECT_FALSE(doc.contains("event"));
+}
+
+TEST(JsonCursor, Errors) {
+  const JsonCursor doc{kJson};
+  EXPECT_THROW(doc["missing"], std::out_of_range);
+  EXPECT_THROW(doc["events"][5], std::out_of_range);
+  EXPECT_THROW(doc[0], std::runtime_error);
+  EXPECT_THROW(doc["events"]["name"], std::runtime_error);
+  EXPECT_THROW(doc["events"].getString(), std::runtime_error);
+  EXPECT_THROW(doc["null"].getNumber(), std::runtime_error);
+
+  EXPECT_THROW(JsonCursor{"  "}, std::runtime_error);
+  EXPECT_THROW(JsonCursor{"{\"a\" 1}"}["a"], std::runtime_error);
+  EXPECT_THROW(JsonCursor{"[[1, 2]"}[1], std::runtime_error);
+  EXPECT_THROW(JsonCursor{"[\"abc"}[1], std::runtime_error);
+
+  // truncated inputs
+  for (const char* json :
+       {"{", "{\"a\":1,", "{\"a\":1, ", "[", "[1,", "[1, "}) {
+    const string input = json;
+    // a copy of exactly the input, so that reading past it is caught
+    const std::unique_ptr<char[]> copy{new char[input.size()]};
+    std::memcpy(copy.get(), input.data(), input.size());
+    const JsonCursor cursor{copy.get(), copy.get() + input.size()};
+    if (input[0] == '{') {
+      EXPECT_THROW(cursor.contains("b"), std::runtime_error) << json;
+      EXPECT_THROW(cursor["b"], std::runtime_error) << json;
+    } else {
+      EXPECT_THROW(cursor[1], std::runtime_error) << json;
+    }
+    EXPECT_THROW(cursor.size(), std::runtime_error) << json;
+  }
+}
+
+TEST(JsonCursor, Parse) {
+  const JsonCursor doc{kJson};
+  EXPECT_EQ("{\"name\": \"first\"}", doc["events"][0].raw());
+  const JsonValue events = doc["events"].Parse();
+  EXPECT_EQ(5, events.getArray().size());
+  EXPECT_EQ("second",
+            events.getArray()[4].getObject().at("name").getString());
+}
@@ -0,0 +1,63 @@
+#include "json_document.h"
+
+#include <algorithm>
+
+namespace jp {
+
+const size_t JsonDocument::kDefaultMaxRetained;
+const size_t JsonDocument::kRecentParses;
+
+const JsonValue& JsonDocument::Parse(const char* p, const char* end) {
+  Recycle(false);
+  parser_.Reset(p, end);
+  return Build();
+}
+
+ParseError JsonDocument::TryParse(const char* p, const char* end) {
+  Recycle(false);
+  parser_.Reset(p, end);
+  const ParseError error = parser_.TryParse(builder_);
+  if (!error) {
+    root_ = builder_.TakeRoot();
+  }
+  return error;
+}
+
+const JsonValue& JsonDocument::ParseZeroCopy(const char* p, const char* end) {
+  Recycle(true);
+  parser_.Reset(p, end, JsonParser::StringMode::ZERO_COPY);
+  return Build();
+}
+
+const JsonValue& JsonDocument::ParseInsitu(char* p, char* end) {
+  Recycle(true);
+  parser_.ResetInsitu(p, end);
+  return Build();
+}
+
+void JsonDocument::Recycle(bool borrow_strings) {
+  root_ = JsonValue();
+  builder_.Reset(borrow_strings);
+
+  peak_used_ = std::max(peak_used_, arena_.used());
+  if (++num_parses_ % kRecentParses == 0) {
+    previous_peak_used_ = peak_used_;
+    peak_used_ = 0;
+  }
+  arena_.Rewind(
+      std::min(std::max(peak_used_, previous_peak_used_), max_retained_));
+  if (arena_.capacity() > max_retained_) {
+    // Rewind keeps a chunk up to twice as large as it's asked for
+    arena_.Reset();
+    arena_.Rewind(max_retained_);
+  }
+  parser_.Trim(max_retained_);
+  builder_.Trim(max_retained_);
+}
+
+const JsonValue& JsonDocument::Build() {
+  parser_.Parse(builder_);
+  root_ = builder_.TakeRoot();
+  return root_;
+}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+
+#include "arena.h"
+#include "dom_builder.h"
+#include "json_parser.h"
+#include "json_value.h"
+#include "parse_error.h"
+
+namespace jp {
+
+// A JsonDocument owns a parsed JSON value, and all of its memory. Every node,
+// string and container of the value is allocated from the document's Arena,
+// so parsing doesn't call malloc for each of them, and destroying the
+// document only frees a few large chunks.
+//
+// Values of the document must not be used after the document is destroyed,
+// but they can be copied, which makes a copy on the heap.
+//
+// A document can be reused to parse many inputs, one after another, e.g. one
+// per request of a server, and it keeps its memory from one to the next: the
+// arena, as a single chunk the size of the largest of the recent documents,
+// and the buffers of its parser. Nothing larger than max_retained bytes is
+// kept, other than a chunk of the size the document was made with, and
+// memory kept for an unusually large document is given back after at most
+// 2 * kRecentParses more parses.
+class JsonDocument {
+ public:
+  // How much memory is kept for the next parse by default, for the arena, and
+  // for each of the parser's buffers
+  static const size_t kDefaultMaxRetained = Arena::kMaxChunkSize;
+
+  // How many parses are recent, for sizing what's kept
+  static const size_t kRecentParses = 16;
+
+  JsonDocument() = default;
+  explicit JsonDocument(size_t chunk_size) : arena_(chunk_size) {}
+
+  JsonDocument(const JsonDocument&) = delete;
+  JsonDocument& operator=(const JsonDocument&) = delete;
+
+  // Parses json into the document, and returns its root. The previous
+  // content of the document is freed.
+  const JsonValue& Parse(const char* p, const char* end);
+
+  const JsonValue& Parse(const std::string& json) {
+    return Parse(&json[0], &json[0] + json.size());
+  }
+
+  // Parses like Parse, but returns the error if json is invalid, rather than
+  // throwing, in which case the root is null
+  ParseError TryParse(const char* p, const char* end);
+
+  ParseError TryParse(const std::string& json) {
+    return TryParse(&json[0], &json[0] + json.size());
+  }
+
+  // Parses json without copying the strings which don't have escaped chars,
+  // they point into json instead. json must outlive the document.
+  const JsonValue& ParseZeroCopy(const char* p, const char* end);
+
+  const JsonValue& ParseZeroCopy(const std::string& json) {
+    return ParseZeroCopy(&json[0], &json[0] + json.size());
+  }
+
+  // Parses json in place: no string is copied, and escaped strings are
+  // decoded inside json, overwriting it. json must outlive the document.
+  const JsonValue& ParseInsitu(char* p, char* end);
+
+  const JsonValue& ParseInsitu(std::string& json) {
+    return ParseInsitu(&json[0], &json[0] + json.size());
+  }
+
+  // 0 frees all the memory of the previous document before each parse
+  void set_max_retained(size_t max_retained) { max_retained_ = max_retained; }
+
+  const JsonValue& root() const { return root_; }
+  const Arena& arena() const { return arena_; }
+
+ private:
+  // Frees the previous document, keeping memory for the next one, which is
+  // built with or without borrowing strings from the input
+  void Recycle(bool borrow_strings);
+
+  // Parses the input the parser was reset to
+  const JsonValue& Build();
+
+  Arena arena_;
+  JsonValue root_;
+
+  JsonParser parser_{&arena_};
+  DomBuilder builder_{&arena_, false};
+
+  size_t max_retained_ = kDefaultMaxRetained;
+
+  // The most arena memory used by a document since the last kRecentParses
+  // parses started, and in the kRecentParses before
+  size_t peak_used_ = 0;
+  size_t previous_peak_used_ = 0;
+  size_t num_parses_ = 0;
+};
+}
@@ -0,0 +1,215 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "arena.h"
+#include "json_document.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+TEST(Arena, Allocate) {
+  Arena arena{64};
+  char* a = static_cast<char*>(arena.Allocate(10, 1));
+  char* b = static_cast<char*>(arena.Allocate(10, 1));
+  EXPECT_EQ(a + 10, b);
+  EXPECT_EQ(1, arena.num_chunks());
+
+  // doesn't fit in the current chunk
+  void* big = arena.Allocate(1000, 8);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(big) % 8);
+  EXPECT_EQ(2, arena.num_chunks());
+
+  arena.Reset();
+  EXPECT_EQ(0, arena.num_chunks());
+  EXPECT_EQ(0, arena.capacity());
+}
+
+TEST(Arena, Rewind) {
+  Arena arena{64};
+  for (int i = 0; i < 10; ++i) {
+    arena.Allocate(100, 8);
+  }
+  arena.Rewind(500);
+  EXPECT_EQ(1, arena.num_chunks());
+  const size_t capacity = arena.capacity();
+  EXPECT_EQ(500, capacity);
+
+  // the kept chunk is reused
+  void* p = arena.Allocate(400, 8);
+  arena.Rewind(500);
+  EXPECT_EQ(p, arena.Allocate(400, 8));
+  EXPECT_EQ(capacity, arena.capacity());
+
+  // and replaced if it's much larger than needed
+  arena.Rewind(100);
+  EXPECT_EQ(1, arena.num_chunks());
+  EXPECT_LT(arena.capacity(), capacity);
+
+  arena.Rewind(0);
+  EXPECT_EQ(0, arena.num_chunks());
+}
+
+TEST(JsonDocument, Parse) {
+  string e =
+      "{\"name\":\"Carl\",\"esc\":\"a\\nb\",\"food\":[\"spaghetti\",1,true,"
+      "null],\"sub\":{\"fake\":-10.94}}";
+  JsonDocument doc;
+  const auto& obj = doc.Parse(e).getObject();
+  EXPECT_EQ(4, obj.size());
+  EXPECT_EQ("Carl", obj.at("name").getString());
+  EXPECT_EQ("a\nb", obj.at("esc").getString());
+  const auto& food = obj.at("food").getArray();
+  ASSERT_EQ(4, food.size());
+  EXPECT_EQ("spaghetti", food[0].getString());
+  EXPECT_EQ(1, food[1].getNumber());
+  EXPECT_TRUE(food[2].getBool());
+  EXPECT_TRUE(food[3].is<JsonValue::NULL_VALUE>());
+  EXPECT_EQ(-10.94, obj.at("sub").getObject().at("fake").getNumber());
+  EXPECT_GT(doc.arena().capacity(), 0);
+}
+
+TEST(JsonDocument, CopyOutlivesDocument) {
+  JsonValue copy;
+  {
+    JsonDocument doc;
+    copy = doc.Parse("{\"a\":[\"x\",{\"b\":\"y\"}]}").getObject().at("a");
+  }
+  ASSERT_TRUE(copy.is<JsonValue::ARRAY>());
+  EXPECT_EQ("x", copy.getArray()[0].getString());
+  EXPECT_EQ("y", copy.getArray()[1].getObject().at("b").getString());
+}
+
+TEST(JsonDocument, Reparse) {
+  JsonDocument doc;
+  doc.Parse("[1,2,3]");
+  EXPECT_THROW(doc.Parse("{\"a\": }"), std::runtime_error);
+  EXPECT_EQ("b", doc.Parse("{\"a\":\"b\"}").getObject().at("a").getString());
+}
+
+TEST(JsonDocument, ParseZeroCopy) {
+  const string e = "{\"name\":\"Carl\",\"esc\":\"a\\tb\",\"arr\":[\"x\"]}";
+  JsonDocument doc;
+  const auto& obj = doc.ParseZeroCopy(e).getObject();
+
+  const auto name = obj.at("name").getString();
+  EXPECT_EQ("Carl", name);
+  EXPECT_EQ(&e[9], name.data());
+  EXPECT_EQ(&e[2], obj.find("name")->first.data());
+  EXPECT_EQ(e.data() + e.find('x'), obj.at("arr").getArray()[0].getString().data());
+
+  // escaped strings are copied
+  EXPECT_EQ("a\tb", obj.at("esc").getString());
+}
+
+TEST(JsonDocument, ParseInsitu) {
+  string e = "{\"k\\\"ey\":\"a\\nb\\\\c\", \"plain\": \"d\"}";
+  const char* const begin = e.data();
+  const char* const end = e.data() + e.size();
+
+  JsonDocument doc;
+  const auto& obj = doc.ParseInsitu(e).getObject();
+  for (const auto& member : obj) {
+    EXPECT_TRUE(member.first.data() >= begin && member.first.end() <= end);
+    const auto str = member.second.getString();
+    EXPECT_TRUE(str.data() >= begin && str.end() <= end);
+  }
+  EXPECT_EQ("a\nb\\c", obj.at("k\"ey").getString());
+  EXPECT_EQ("d", obj.at("plain").getString());
+}
+
+TEST(JsonDocument, Objects) {
+  string e = "[";
+  for (int i = 0; i < 100; ++i) {
+    e += "{\"id\":" + std::to_string(i) + ",\"na\\tme\":\"x\",\"id\":0},";
+  }
+  e += "{}]";
+  JsonDocument doc;
+  const auto& arr = doc.Parse(e).getArray();
+  ASSERT_EQ(101, arr.size());
+  for (int i = 0; i < 100; ++i) {
+    const auto& obj = arr[i].getObject();
+    ASSERT_EQ(2, obj.size());
+    EXPECT_EQ("id", obj.begin()->first);
+    EXPECT_EQ(i, obj.at("id").getInt64());
+    EXPECT_EQ("x", obj.at("na\tme").getString());
+
+    // keys are interned
+    EXPECT_EQ(arr[0].getObject().begin()->first.data(),
+              obj.begin()->first.data());
+  }
+  EXPECT_TRUE(arr[100].getObject().empty());
+}
+
+TEST(JsonDocument, Reuse) {
+  string small = "[";
+  for (int i = 0; i < 100; ++i) {
+    small += "{\"id\":" + std::to_string(i) + ",\"name\":\"x\"},";
+  }
+  small += "{}]";
+  string large = "[";
+  for (int i = 0; i < 100; ++i) {
+    large += small + ",";
+  }
+  large += "[]]";
+
+  JsonDocument doc{1024};
+  doc.Parse(small);
+  doc.Parse(small);
+  const size_t capacity = doc.arena().capacity();
+  EXPECT_EQ(1, doc.arena().num_chunks());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(101, doc.Parse(small).getArray().size());
+    EXPECT_EQ(capacity, doc.arena().capacity());
+  }
+
+  // memory kept for a large document is given back after a while
+  EXPECT_EQ(101, doc.ParseZeroCopy(large).getArray().size());
+  EXPECT_GT(doc.Parse(small).getArray().size(), 0);
+  EXPECT_GT(doc.arena().capacity(), 10 * capacity);
+  for (size_t i = 0; i < 2 * JsonDocument::kRecentParses; ++i) {
+    doc.Parse(small);
+  }
+  EXPECT_LE(doc.arena().capacity(), 2 * capacity);
+
+  // unless it's too much
+  doc.set_max_retained(capacity * 2);
+  doc.ParseInsitu(large);
+  EXPECT_EQ(101, doc.Parse(small).getArray().size());
+  EXPECT_LE(doc.arena().capacity(), 2 * capacity);
+
+  // even a chunk which is only a little too large isn't kept
+  doc.set_max_retained(JsonDocument::kDefaultMaxRetained);
+  doc.Parse(large);
+  doc.Parse("[]");
+  const size_t kept = doc.arena().capacity();
+  doc.set_max_retained(kept - 1);
+  doc.Parse("[]");
+  EXPECT_LE(doc.arena().capacity(), kept - 1);
+
+  doc.set_max_retained(0);
+  doc.Parse(large);
+  EXPECT_TRUE(doc.Parse("[]").getArray().empty());
+}
+
+TEST(JsonParser, Reset) {
+  const string inputs[] = {"[1, \"a\\nb\"]", "{\"a\": [}", "{\"a\": 1}"};
+  JsonParser parser;
+  parser.Reset(inputs[0].data(), inputs[0].data() + inputs[0].size());
+  EXPECT_EQ("a\nb", parser.Parse().getArray()[1].getString());
+  parser.Reset(inputs[1].data(), inputs[1].data() + inputs[1].size());
+  EXPECT_THROW(parser.Parse(), std::runtime_error);
+  parser.Trim(0);
+  parser.Reset(inputs[2].data(), inputs[2].data() + inputs[2].size());
+  EXPECT_EQ(1, parser.Parse().getObject().at("a").getInt64());
+
+  EXPECT_THROW(parser.Reset(inputs[0].data(), inputs[0].data(),
+                            JsonParser::StringMode::ZERO_COPY),
+               std::invalid_argument);
+}
+
+TEST(JsonParser, ZeroCopyRequiresArena) {
+  EXPECT_THROW(JsonParser("[]", nullptr, JsonParser::StringMode::ZERO_COPY),
+               std::invalid_argument);
+}
@@ -1,13 +1,19 @@
 #include "json_parser.h"
 
 #include <assert.h>
+#include <algorithm>
 #include <cctype>
-#include <unordered_set>
+#include <cmath>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <limits>
 
+#include "dom_builder.h"
 #include "helpers.h"
-#include "token_error.h"
+#include "mapped_file.h"
+#include "number_parser.h"
+#include "structural_index.h"
+#include "utf8.h"
 
 namespace jp {
 
@@ -26,31 +32,50 @@ const char kDot = '.';
 const char kExponent = 'e';
 const char kCapitalExponent = 'E';
 
-const std::string kTrue = "true";
-const std::string kFalse = "false";
-const std::string kNull = "null";
+// Constant initialized, like everything the parser uses, so that it can be
+// called during static initialization
+constexpr char kTrue[] = "true";
+constexpr char kFalse[] = "false";
+constexpr char kNull[] = "null";
 
-// TODO handle too deep JSONs
-// TODO implement UTF8 handling
+// Returns what c stands for after a backslash in a string, or -1 if it can't
+// follow one
+inline int Unescape(const char c) {
+  switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+      return c;
+    case 'b':
+      return '\b';
+    case 'f':
+      return '\f';
+    case 'n':
+      return '\n';
+    case 'r':
+      return '\r';
+    case 't':
+      return '\t';
+    default:
+      return -1;
+  }
+}
 
-// Chars that can follow a backslash in a string
-const std::unordered_set<char> following_escape{'"', '\\', '/', 'b',
-                                                'f', 'n',  'r', 't'};
+inline bool IsDigit(const char c) { return c >= '0' && c <= '9'; }
 
-const std::unordered_map<char, char> escaped_map{{'"', '"'},
-                                                 {'\\', '\\'},
-                                                 {'/', '/'},
-                                                 {'b', '\b'},
-                                                 {'f', '\f'},
-                                                 {'n', '\n'},
-                                                 {'r', '\r'},
-                                                 {'t', '\t'}};
+// Returns the value of a hex digit, or -1 if c isn't one
+inline int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
 
-// GetNextControlToken always leaves p_ pointing to the parsed ControlToken,
-// which is always a single char.
-JsonParser::ControlToken JsonParser::GetNextControlToken() {
-  SkipSpace();
-  const auto c = GetChar();
+JsonParser::ControlToken JsonParser::ClassifyToken(const char c) {
   switch (c) {
     case kObjectOpen:
       return ControlToken::OBJECT_OPEN;
@@ -72,260 +97,472 @@ JsonParser::ControlToken JsonParser::GetNextControlToken() {
     case 'n':
       return ControlToken::NULL_VALUE;
     default:
-      if (std::isdigit(c) || c == kMinusSign) {
+      if (IsDigit(c) || c == kMinusSign) {
         return ControlToken::NUMBER;
       }
       return ControlToken::INVALID;
   }
 }
 
-JsonValue JsonParser::Parse() {
-  auto obj = ParseValue();
-  SkipSpace();
-  if (Capacity()) {
-    throw std::runtime_error("unexpected string at the end of input");
-  }
-  return obj;
-}
-
-JsonValue JsonParser::ParseValue(const ControlToken ct) {
-  switch (ct) {
-    case ControlToken::OBJECT_OPEN:
-      return JsonValue{ParseObject()};
-    case ControlToken::ARRAY_OPEN:
-      return JsonValue{ParseArray()};
-    case ControlToken::STRING:
-      return JsonValue{ParseString()};
-    case ControlToken::BOOL:
-      return JsonValue{ParseBool()};
-    case ControlToken::NUMBER:
-      return JsonValue{ParseNumber()};
-    case ControlToken::NULL_VALUE:
-      return ParseNull();
-    default:
-      throw std::runtime_error(GetSurroundings() +
-                               "expected a JSON value, but got token: " +
-                               ErrorMessageName(ct));
+// GetNextControlToken always leaves p_ pointing to the parsed ControlToken,
+// which is always a single char.
+JsonParser::ControlToken JsonParser::GetNextControlToken() {
+  if (indexed_) {
+    NextStructural();
+  } else {
+    SkipSpace();
   }
+  const ControlToken ct = ClassifyToken(GetChar());
+  JP_STATS(++stats_.tokens[static_cast<size_t>(ct)]);
+  return ct;
 }
 
-JsonValue::ObjectType JsonParser::ParseObject() {
-  assert(GetChar() == kObjectOpen);
-  AdvanceChar();
-
-  JsonValue::ObjectType obj;
+void JsonParser::Reset(const char* p, const char* end, StringMode mode) {
+  if (mode == StringMode::ZERO_COPY && !arena_) {
+    JP_THROW(std::invalid_argument("zero-copy parsing requires an arena"));
+  }
+  p_ = start_ = p;
+  end_ = end;
+  error_ = ParseError();
+  mode_ = mode;
+  insitu_ = nullptr;
+  indexed_ = false;
+  stack_.clear();
+}
 
-  ControlToken ct = GetNextControlToken();
-  if (ct != ControlToken::OBJECT_CLOSE) {
-    JsonValue::StringType key;
+void JsonParser::ResetInsitu(char* p, char* end) {
+  Reset(p, end, StringMode::ZERO_COPY);
+  insitu_ = p;
+}
 
-    while (true) {
-      Expect(ControlToken::STRING, ct);
-      key = ParseString();
+void JsonParser::Trim(size_t max_bytes) {
+  if (scratch_.capacity() > max_bytes) {
+    std::string().swap(scratch_);
+  }
+  index_.Trim(max_bytes);
+  if (stack_.capacity() * sizeof(Level) > max_bytes) {
+    std::vector<Level>().swap(stack_);
+  }
+}
 
-      ct = GetNextControlToken();
-      Expect(ControlToken::COLON, ct);
-      AdvanceChar();
+JsonValue JsonParser::Parse() {
+  JsonValue val;
+  if (TryParse(&val)) {
+    ThrowError();
+  }
+  return val;
+}
 
-      obj.emplace(std::make_pair(key, ParseValue()));
-      ct = GetNextControlToken();
-      if (ct != ControlToken::COMMA) {
-        Expect(ControlToken::OBJECT_CLOSE, ct);
-        break;
-      }
-      AdvanceChar();
-      ct = GetNextControlToken();
-    }
+ParseError JsonParser::TryParse(JsonValue* out) {
+  DomBuilder builder{arena_, mode_ == StringMode::ZERO_COPY};
+  if (!TryParse(builder)) {
+    *out = builder.TakeRoot();
   }
+  return error_;
+}
 
-  assert(GetChar() == kObjectClose);
-  AdvanceChar();
-  return obj;
+JsonValue JsonParser::ParseFile(const std::string& path) {
+  MappedFile file{path};
+  return JsonParser{file.begin(), file.end()}.Parse();
 }
 
-JsonValue::ArrayType JsonParser::ParseArray() {
-  assert(GetChar() == kArrayOpen);
-  AdvanceChar();
+void JsonParser::BuildIndex() {
+  if (Capacity() <= StructuralIndex::kMaxInputSize) {
+    index_.Build(p_, end_, utf8_mode_ == Utf8Mode::STRICT);
+    invalid_utf8_ = p_ + index_.invalid_utf8();
+    next_structural_ = 0;
+    indexed_ = true;
+  }
+}
 
-  JsonValue::ArrayType arr;
+void JsonParser::ExpectEnd() {
+  if (indexed_) {
+    NextStructural();
+  } else {
+    SkipSpace();
+  }
+  if (Capacity()) {
+    Fail(ParseErrorCode::TRAILING_CONTENT);
+  }
+}
 
-  ControlToken ct = GetNextControlToken();
-  if (ct != ControlToken::ARRAY_CLOSE) {
-    while (true) {
-      arr.push_back(ParseValue(ct));
-      ct = GetNextControlToken();
-      if (ct != ControlToken::COMMA) {
-        Expect(ControlToken::ARRAY_CLOSE, ct);
-        break;
-      }
-      AdvanceChar();
-      ct = GetNextControlToken();
+const char* JsonParser::ScanString(const char* p) {
+  if (utf8_mode_ != Utf8Mode::STRICT) {
+    return FindStringSpecialChar(p, end_);
+  }
+  if (indexed_) {
+    // the input was validated along with indexing it
+    p = FindStringSpecialChar(p, end_);
+    if (p > invalid_utf8_) {
+      p_ = invalid_utf8_;
+      Fail(ParseErrorCode::INVALID_UTF8);
+      return end_;
+    }
+    return p;
+  }
+  while (true) {
+    p = FindStringSpecialChar(p, end_, true);
+    if (p == end_ || static_cast<unsigned char>(*p) < 0x80) {
+      return p;
     }
+    p = ValidateUtf8Run(p);
   }
+}
 
-  assert(GetChar() == kArrayClose);
-  AdvanceChar();
-  return arr;
+// Validates the non-ASCII chars at p, and the rest of the string up to the
+// next special char, at once, as text which isn't ASCII rarely has just a
+// char or two of it. Only inputs which aren't indexed are validated a string
+// at a time.
+const char* JsonParser::ValidateUtf8Run(const char* p) {
+  const char* const run_end = FindStringSpecialChar(p, end_);
+  const char* const invalid = ValidateUtf8(p, run_end);
+  if (invalid != run_end) {
+    p_ = invalid;
+    Fail(ParseErrorCode::INVALID_UTF8);
+    return end_;
+  }
+  return run_end;
 }
 
-JsonValue::StringType JsonParser::ParseString() {
+// Strings without escaped chars are returned as a view of the input, so they
+// are scanned only once, and copied only once, by the caller.
+StringRef JsonParser::ParseString() {
+  JP_STATS(CycleTimer timer{&stats_.string_cycles});
   assert(GetChar() == kStringOpen);
   AdvanceChar();
 
   const char* const start = p_;
-  char c;
 
-  int num_escaped_chars = 0;
-  while ((c = GetChar()) != kStringClose) {
-    // only literal whitespace char allowed inside a string is a space,
-    // everything else must be escaped
-    if (c != ' ' && std::isspace(c)) {
-      throw std::runtime_error(
-          GetSurroundings() +
-          "literal whitespace chars are not allowed inside JSON string");
+  while (true) {
+    p_ = ScanString(p_);
+    const char c = GetChar();
+    if (c == kStringClose) {
+      break;
     }
     if (c == kEscapeChar) {
-      c = GetNextChar();
-      if (following_escape.count(c) == 0) {
-        throw std::runtime_error(GetSurroundings() + "invalid escape char");
-      }
-      ++num_escaped_chars;
+      return insitu_ ? ParseEscapedStringInsitu(start)
+                     : ParseEscapedString(start);
+    }
+    char decoded[4];
+    DecodeSpecialChar(decoded);
+    if (failed()) {
+      return StringRef();
     }
     AdvanceChar();
   }
 
-  JsonValue::StringType str;
-  str.resize(p_ - start - num_escaped_chars);
+  StringRef str{start, static_cast<size_t>(p_ - start)};
+  JP_STATS(stats_.string_bytes += str.size());
+  AdvanceChar();
+  return str;
+}
+
+// Continues parsing a string from its first escape char, decoding it into
+// scratch_.
+StringRef JsonParser::ParseEscapedString(const char* start) {
+  scratch_.assign(start, p_);
 
-  int i = 0;
-  for (const char* c = start; c != p_; ++c) {
-    if (*c == kEscapeChar) {
-      ++c;
-      str[i] = escaped_map.at(*c);
-    } else {
-      str[i] = *c;
+  while (true) {
+    const char* const run = p_;
+    p_ = ScanString(p_);
+    if (failed()) {
+      return StringRef();
     }
-    ++i;
+    scratch_.append(run, p_);
+    if (GetChar() == kStringClose) {
+      break;
+    }
+    char decoded[4];
+    scratch_.append(decoded, DecodeSpecialChar(decoded));
+    if (failed()) {
+      return StringRef();
+    }
+    AdvanceChar();
   }
 
-  assert(i == str.size());
-  assert(GetChar() == kStringClose);
+  JP_STATS(stats_.string_bytes += p_ - start);
+  AdvanceChar();
+  return StringRef{scratch_};
+}
+
+// Same as ParseEscapedString, but the string is decoded in the input buffer.
+// The decoded string is never longer than the escaped one, not even \u
+// escapes, so the write position never overtakes p_.
+StringRef JsonParser::ParseEscapedStringInsitu(const char* start) {
+  char* const begin = insitu_ + (start - start_);
+  char* out = insitu_ + (p_ - start_);
+
+  while (true) {
+    const char* const run = p_;
+    p_ = ScanString(p_);
+    if (failed()) {
+      return StringRef();
+    }
+    std::memmove(out, run, p_ - run);
+    out += p_ - run;
+    if (GetChar() == kStringClose) {
+      break;
+    }
+    out += DecodeSpecialChar(out);
+    if (failed()) {
+      return StringRef();
+    }
+    AdvanceChar();
+  }
 
+  JP_STATS(stats_.string_bytes += p_ - start);
   AdvanceChar();
-  return str;
+  return StringRef{begin, static_cast<size_t>(out - begin)};
+}
+
+// Handles a backslash or a control char inside a string. p_ is left at the
+// last char of an escape sequence, or at the end of the input if it's
+// invalid.
+size_t JsonParser::DecodeSpecialChar(char* out) {
+  char c = GetChar();
+  if (c == kEscapeChar) {
+    JP_STATS(++stats_.escapes);
+    const char* const escape = p_;
+    c = GetNextChar();
+    if (c == 'u') {
+      return DecodeUnicodeEscape(escape, out);
+    }
+    const int unescaped = Unescape(c);
+    if (unescaped < 0) {
+      Fail(ParseErrorCode::INVALID_ESCAPE);
+      return 0;
+    }
+    out[0] = static_cast<char>(unescaped);
+    return 1;
+  }
+  // only literal whitespace char allowed inside a string is a space,
+  // everything else must be escaped
+  if (std::isspace(c)) {
+    Fail(ParseErrorCode::INVALID_STRING_CHAR);
+  }
+  out[0] = c;
+  return 1;
+}
+
+// Decodes the \u escape at escape, whose u p_ is at, as UTF-8. Code points
+// above U+FFFF are escaped as a surrogate pair, two escapes of which the first
+// is a high surrogate, and the second a low one.
+size_t JsonParser::DecodeUnicodeEscape(const char* escape, char* out) {
+  uint32_t code_point;
+  if (!ParseHexDigits(&code_point)) {
+    return 0;
+  }
+  if (IsHighSurrogate(code_point) && Capacity() >= 3 &&
+      p_[1] == kEscapeChar && p_[2] == 'u') {
+    const char* const high_end = p_;
+    p_ += 2;
+    uint32_t low;
+    if (!ParseHexDigits(&low)) {
+      return 0;
+    }
+    if (IsLowSurrogate(low)) {
+      code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+      return EncodeUtf8(code_point, out);
+    }
+    // the next escape is decoded on its own
+    p_ = high_end;
+  }
+  if (IsHighSurrogate(code_point) || IsLowSurrogate(code_point)) {
+    if (utf8_mode_ == Utf8Mode::STRICT) {
+      p_ = escape;
+      Fail(ParseErrorCode::LONE_SURROGATE);
+      return 0;
+    }
+    code_point = kReplacementChar;
+  }
+  return EncodeUtf8(code_point, out);
+}
+
+// Parses the 4 hex digits after p_, leaving p_ at the last one
+bool JsonParser::ParseHexDigits(uint32_t* out) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    const int digit = HexValue(GetNextChar());
+    if (digit < 0) {
+      Fail(ParseErrorCode::INVALID_ESCAPE);
+      return false;
+    }
+    value = value << 4 | digit;
+  }
+  *out = value;
+  return true;
 }
 
-// Reads the next sequence of digits, starting from the current position,
-// and returns the corresponding number. It stops at the first non-digit character.
-//
-// e.g. for "13432.454", it would return the number 13432
-//
-// Only call this method if it is expected that we can parse a number with at
-// least 1 digit
-double JsonParser::ParseSimpleNumber() {
-  if (!std::isdigit(GetChar())) {
-    throw std::runtime_error(GetSurroundings() + "expected a number");
+// Scans with a local pointer, as this is the hottest loop of number parsing
+void JsonParser::ParseDigits(uint64_t* w) {
+  const char* p = p_;
+  uint64_t value = *w;
+  while (p != end_ && IsDigit(*p)) {
+    value = value * 10 + (*p - '0');
+    ++p;
   }
-  int num = 0;
+  p_ = p;
+  *w = value;
+}
+
+// Exponents are capped, far beyond the range of doubles, so they can't
+// overflow
+int64_t JsonParser::ParseExponent() {
+  if (!IsDigit(GetChar())) {
+    Fail(ParseErrorCode::INVALID_NUMBER);
+    return 0;
+  }
+  const int64_t kMaxExponent = 1000000;
+  int64_t exponent = 0;
   char c;
-  // no valid JSON ends with a digit, so it's fine if we just use GetChar, which
-  // throws when we reached the end of input
-  while (std::isdigit((c = GetChar()))) {
-    num *= 10;
-    num += c - '0';
+  while (IsDigit((c = PeekChar()))) {
+    exponent = std::min(exponent * 10 + (c - '0'), kMaxExponent);
     AdvanceChar();
   }
-  return num;
+  return exponent;
 }
 
-JsonValue::NumberType JsonParser::ParseNumber() {
-  bool negative = false;
+// Integers without a fraction or an exponent are kept as such, if they fit in
+// 64 bits, everything else is a double
+JsonParser::ParsedNumber JsonParser::ParseNumber() {
+  JP_STATS(CycleTimer timer{&stats_.number_cycles});
+  NumberParts parts;
+  parts.begin = p_;
+  parts.negative = false;
+  parts.exponent = 0;
   char c = GetChar();
 
   // parse minus sign, if there is one
   if (c == kMinusSign) {
-    negative = true;
+    parts.negative = true;
     c = GetNextChar();
   }
 
-  if (!std::isdigit(c)) {
-    throw std::runtime_error("expected number");
+  if (!IsDigit(c)) {
+    Fail(ParseErrorCode::INVALID_NUMBER);
+    return ParsedNumber();
   }
 
-  JsonValue::NumberType num = 0;
-  if (GetChar() == '0') {
-    if (std::isdigit(GetNextChar())) {
-      throw std::runtime_error("0 cannot be followed by digits");
+  // The digits, without the dot, which overflows if there are more than 19
+  uint64_t w = 0;
+  parts.int_begin = p_;
+  if (c == '0') {
+    AdvanceChar();
+    if (IsDigit(PeekChar())) {
+      Fail(ParseErrorCode::INVALID_NUMBER);
+      return ParsedNumber();
     }
   } else {
-    num = ParseSimpleNumber();
+    ParseDigits(&w);
   }
-  c = GetChar();
+  parts.int_end = p_;
+  parts.frac_begin = parts.frac_end = p_;
+  c = PeekChar();
 
   // Parse fraction, if present
+  bool integer = true;
   if (c == kDot) {
     c = GetNextChar();
-    if (!std::isdigit(c)) {
-      throw std::runtime_error(GetSurroundings() +
-                               ". must be followed by number");
-    }
-    int power_of_ten = 0;
-    int fraction = 0;
-    while (std::isdigit(c)) {
-      fraction *= 10;
-      fraction += c - '0';
-      ++power_of_ten;
-      c = GetNextChar();
+    if (!IsDigit(c)) {
+      Fail(ParseErrorCode::INVALID_NUMBER);
+      return ParsedNumber();
     }
-    num += static_cast<double>(fraction) / pow(10, power_of_ten);
+    parts.frac_begin = p_;
+    ParseDigits(&w);
+    parts.frac_end = p_;
+    c = PeekChar();
+    integer = false;
   }
 
   // Parse exponential notation
   if (c == kExponent || c == kCapitalExponent) {
     c = GetNextChar();
     bool negative_exponential = false;
-    if (!std::isdigit(c)) {
+    if (!IsDigit(c)) {
       if (c == kMinusSign) {
         negative_exponential = true;
-      } else {
-        Expect(kPlusSign);
+      } else if (c != kPlusSign) {
+        Fail(ParseErrorCode::INVALID_NUMBER);
+        return ParsedNumber();
       }
       c = GetNextChar();
     }
-
-    int power = ParseSimpleNumber();
+    parts.exponent = ParseExponent();
+    if (failed()) {
+      return ParsedNumber();
+    }
     if (negative_exponential) {
-      power *= -1;
+      parts.exponent *= -1;
     }
-    num *= pow(10, power);
+    integer = false;
   }
-
-  assert(!std::isdigit(GetChar()));
-  return negative ? num * -1 : num;
+  parts.end = p_;
+  assert(!IsDigit(PeekChar()));
+
+  const long num_digits = (parts.int_end - parts.int_begin) +
+                          (parts.frac_end - parts.frac_begin);
+  const int kMaxExactDigits = 19;
+
+  ParsedNumber num;
+  if (integer) {
+    uint64_t value = w;
+    bool overflow = false;
+    if (num_digits > kMaxExactDigits) {
+      value = 0;
+      for (const char* p = parts.int_begin; p != parts.int_end; ++p) {
+        overflow |= __builtin_mul_overflow(value, 10, &value);
+        overflow |= __builtin_add_overflow(value, *p - '0', &value);
+      }
+    }
+    const uint64_t kMaxInt64 = std::numeric_limits<int64_t>::max();
+    if (!overflow && !parts.negative) {
+      if (value <= kMaxInt64) {
+        num.kind = ParsedNumber::INT64;
+        num.i = static_cast<int64_t>(value);
+      } else {
+        num.kind = ParsedNumber::UINT64;
+        num.u = value;
+      }
+      return num;
+    }
+    // -0 is a double, as there's no negative zero integer
+    if (!overflow && value != 0 && value <= kMaxInt64 + 1) {
+      num.kind = ParsedNumber::INT64;
+      num.i = -static_cast<int64_t>(value - 1) - 1;
+      return num;
+    }
+  }
+  num.kind = ParsedNumber::DOUBLE;
+  num.d = num_digits <= kMaxExactDigits
+              ? ToDouble(w, parts.exponent - (parts.frac_end - parts.frac_begin),
+                         parts.negative)
+              : ToDouble(parts);
+  return num;
 }
 
 JsonValue::BoolType JsonParser::ParseBool() {
-  if (Match(kTrue)) {
+  if (Match(kTrue, sizeof(kTrue) - 1)) {
     return true;
   }
-  if (Match(kFalse)) {
+  if (Match(kFalse, sizeof(kFalse) - 1)) {
     return false;
   }
-  throw std::runtime_error("invalid bool value");
+  Fail(ParseErrorCode::INVALID_LITERAL);
+  return false;
 }
 
-JsonValue JsonParser::ParseNull() {
-  if (Match(kNull)) {
-    return JsonValue();
+void JsonParser::ParseNull() {
+  if (Match(kNull, sizeof(kNull) - 1)) {
+    return;
   }
-  throw std::runtime_error("invalid null value");
+  Fail(ParseErrorCode::INVALID_LITERAL);
 }
 
-bool JsonParser::Match(const std::string& val) {
-  if (val.size() > Capacity()) {
+bool JsonParser::Match(const char* val, size_t size) {
+  if (size > Capacity()) {
     return false;
   }
-  for (int i = 0; i < val.size(); ++i) {
+  for (size_t i = 0; i < size; ++i) {
     if (p_ + i == end_) {
       return false;
     }
@@ -333,87 +570,68 @@ bool JsonParser::Match(const std::string& val) {
       return false;
     }
   }
-  p_ += val.size();
+  p_ += size;
   return true;
 }
 
 void JsonParser::SkipSpace() {
-  while (p_ != end_ && std::isspace(GetChar())) {
+  JP_STATS(CycleTimer timer{&stats_.space_cycles});
+  while (p_ != end_ && IsSpace(*p_)) {
     AdvanceChar();
   }
 }
 
-// TODO move this logic somewhere else
-std::string JsonParser::GetSurroundings() const {
-  const long max_extension_length = 10;
-  auto prefix_length =
-      std::min(max_extension_length, std::distance(start_, p_));
-  const char* current = p_ - prefix_length;
-
-  std::string out;
-  for (; current != p_; ++current) {
-    out += *current;
+// Every token is in the index, so if p_ is at whitespace, everything up to the
+// next indexed token is whitespace as well. If p_ is at something else, which
+// is not a token, it's left there to be reported by the caller.
+void JsonParser::NextStructural() {
+  JP_STATS(CycleTimer timer{&stats_.space_cycles});
+  const uint32_t offset = p_ - start_;
+  while (next_structural_ < index_.size() &&
+         index_[next_structural_] < offset) {
+    ++next_structural_;
   }
-  if (p_ != end_) {
-    out += *current;
-    ++current;
-    for (int i = 0; i < max_extension_length && current != end_;
-         ++i, ++current) {
-      out += *current;
-    }
+  if (next_structural_ < index_.size() && index_[next_structural_] == offset) {
+    ++next_structural_;
+    return;
   }
-  out += '\n';
-  for (int i = 0; i < prefix_length; ++i) {
-    out += ' ';
-  }
-  out += '^';
-  out += '\n';
-  return out;
-}
-
-std::string JsonParser::ErrorMessageName(const ControlToken ct) const {
-  switch (ct) {
-    case ControlToken::OBJECT_OPEN:
-      return quote('{');
-    case ControlToken::OBJECT_CLOSE:
-      return quote('}');
-    case ControlToken::ARRAY_OPEN:
-      return quote('[');
-    case ControlToken::ARRAY_CLOSE:
-      return quote(']');
-    case ControlToken::STRING:
-      return "a string";
-    case ControlToken::NUMBER:
-      return "a number";
-    case ControlToken::BOOL:
-      return "true or false";
-    case ControlToken::NULL_VALUE:
-      return "null";
-    case ControlToken::COLON:
-      return quote(':');
-    case ControlToken::COMMA:
-      return quote(',');
-    case ControlToken::INVALID:
-      return quote(*p_);
-  }
-}
-
-void JsonParser::Expect(ControlToken expected, ControlToken actual) const {
-  if (actual != expected) {
-    throw jp::TokenError{GetSurroundings(), ErrorMessageName(expected),
-                         ErrorMessageName(actual)};
-  }
-}
-
-void JsonParser::Expect(const char c) const {
-  if (p_ == end_) {
-    std::stringstream error_msg;
-    error_msg << GetSurroundings() << std::endl << "expected " << quote(c)
-              << ", but reached end of input";
-    throw std::runtime_error(error_msg.str());
-  }
-  if (GetChar() != c) {
-    throw jp::TokenError{GetSurroundings(), quote(c), quote(*p_)};
+  if (p_ != end_ && !IsSpace(*p_)) {
+    return;
   }
+  p_ = next_structural_ < index_.size() ? start_ + index_[next_structural_++]
+                                        : end_;
+}
+
+void JsonParser::Fail(ParseErrorCode code) {
+  if (!failed()) {
+    error_.code = code;
+    error_.offset = p_ - start_;
+  }
+  p_ = end_;
+  next_structural_ = index_.size();
+}
+
+#if JP_PARSE_STATS
+void JsonParser::BeginStats() {
+  static_assert(static_cast<size_t>(ControlToken::INVALID) ==
+                    ParseStats::INVALID,
+                "ParseStats::Token doesn't match ControlToken");
+  stats_ = ParseStats();
+  stats_chunks_ = arena_ ? arena_->num_chunks() : 0;
+  stats_scratch_capacity_ = scratch_.capacity();
+  stats_stack_capacity_ = stack_.capacity();
+}
+
+void JsonParser::EndStats() {
+  stats_.allocations = (arena_ ? arena_->num_chunks() : 0) - stats_chunks_ +
+                       (scratch_.capacity() != stats_scratch_capacity_) +
+                       (stack_.capacity() != stats_stack_capacity_);
+  ThreadParseStats() += stats_;
+}
+#endif
+
+void JsonParser::ThrowError() const {
+  JP_THROW(ParseException(error_, StringRef{start_, static_cast<size_t>(
+                                                         end_ - start_)}));
 }
 }
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <assert.h>
+#include <algorithm>
 #include <cinttypes>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "arena.h"
 #include "json_value.h"
+#include "parse_error.h"
+#include "parse_stats.h"
+#include "string_ref.h"
+#include "structural_index.h"
 
 namespace jp {
 
@@ -12,16 +21,129 @@ namespace jp {
 //
 class JsonParser {
  public:
-  JsonParser(const char* p, const char* end) : p_(p), start_(p), end_(end) {}
+  enum class StringMode : int8_t {
+    COPY,       // strings are copied into the parsed value
+    ZERO_COPY,  // strings without escaped chars point into the input
+  };
+
+  // How strings which aren't valid UTF-8 are parsed
+  enum class Utf8Mode : int8_t {
+    STRICT,      // they're rejected, as are \u escapes of lone surrogates
+    PERMISSIVE,  // they're kept as they are, and lone surrogates become U+FFFD
+  };
+
+  // If arena is given, every node of the parsed value is allocated from it,
+  // otherwise they are on the heap, owned by the returned value.
+  //
+  // ZERO_COPY requires an arena, and the input must outlive the parsed value.
+  // A parser without an input, which has to be given one with Reset
+  explicit JsonParser(Arena* arena = nullptr)
+      : p_(nullptr), start_(nullptr), end_(nullptr), arena_(arena),
+        mode_(StringMode::COPY) {}
+
+  JsonParser(const char* p, const char* end, Arena* arena = nullptr,
+             StringMode mode = StringMode::COPY)
+      : arena_(arena) {
+    Reset(p, end, mode);
+  }
+
+  JsonParser(const std::string& json, Arena* arena = nullptr,
+             StringMode mode = StringMode::COPY)
+      : JsonParser(&json[0], &json[0] + json.size(), arena, mode) {}
 
-  JsonParser(const std::string& json)
-      : JsonParser(&json[0], &json[0] + json.size()) {}
+  // Parses the mutable input in place: every string points into the input,
+  // and escaped strings are decoded in place, overwriting the input.
+  JsonParser(char* p, char* end, Arena* arena) : arena_(arena) {
+    ResetInsitu(p, end);
+  }
+
+  // Makes the parser start over with another input, to parse many inputs
+  // with one parser. Its buffers are kept, so they're only allocated as long
+  // as the inputs grow. Values already parsed aren't affected.
+  void Reset(const char* p, const char* end,
+             StringMode mode = StringMode::COPY);
+  void ResetInsitu(char* p, char* end);
+
+  // Frees the buffers of the parser which are larger than max_bytes, e.g.
+  // after an unusually large input
+  void Trim(size_t max_bytes);
+
+  // How deeply arrays and objects may be nested by default
+  static const size_t kDefaultMaxDepth = 1024;
+
+  // Inputs with arrays and objects nested more deeply than max_depth are
+  // rejected. Parsing doesn't recurse, but destroying, copying and writing
+  // values does, so very deep values can still exhaust the stack.
+  void set_max_depth(size_t max_depth) { max_depth_ = max_depth; }
+
+  // STRICT by default. Validating strings costs close to nothing for ASCII.
+  void set_utf8_mode(Utf8Mode mode) { utf8_mode_ = mode; }
 
   // Currently, the outermost value doesn't have to be an object, not as per the
   // specification
+  //
+  // Invalid inputs are reported by throwing a ParseException.
   JsonValue Parse();
 
+  // Parses like Parse(), but returns the error if the input is invalid,
+  // rather than throwing, in which case out isn't modified. Rejecting an
+  // input only costs a ParseError, its message is built on demand.
+  ParseError TryParse(JsonValue* out);
+
+  // Parses the file at path straight from a memory mapping of it, see
+  // MappedFile. Throws std::system_error if the file can't be read.
+  static JsonValue ParseFile(const std::string& path);
+
+  // Parses the input, and reports what it finds to handler, without building
+  // any JsonValue. Handler has to have the following methods, which are
+  // called in document order, and can throw to stop parsing:
+  //
+  //   void StartObject();
+  //   void Key(StringRef key, bool copy);
+  //   void EndObject(size_t num_members);
+  //   void StartArray();
+  //   void EndArray(size_t num_elements);
+  //   void String(StringRef str, bool copy);
+  //   void Int64(int64_t num);
+  //   void Uint64(uint64_t num);
+  //   void Number(double num);
+  //   void Bool(bool val);
+  //   void Null();
+  //
+  // If copy is true, str is only valid until the method returns, otherwise it
+  // points into the input.
+  //
+  // Integers without a fraction or an exponent are reported with Int64, or
+  // with Uint64 if they only fit into that, everything else with Number.
+  //
+  // Handler is a template parameter, so calls to it can be inlined.
+  template <typename Handler>
+  void Parse(Handler& handler);
+
+  // Parses like Parse(handler), but returns the error if the input is
+  // invalid, rather than throwing. The handler isn't called after the error.
+  template <typename Handler>
+  ParseError TryParse(Handler& handler);
+
+  // The error of the last parse, if the input is invalid
+  const ParseError& error() const { return error_; }
+
+#if JP_PARSE_STATS
+  // What the last parse did, which is also added to ThreadParseStats()
+  const ParseStats& stats() const { return stats_; }
+#endif
+
+  // Parses the single scalar value (string, number, bool or null) at the start
+  // of the input, reports it to handler, and returns the position right after
+  // it. Anything may follow the value, e.g. the rest of a buffer.
+  template <typename Handler>
+  const char* ParseScalar(Handler& handler);
+
  private:
+  friend class ParallelParser;
+  friend ParseError TryMinify(const char* p, const char* end, char* out,
+                              size_t* size);
+
   // A ControlToken controls the behaviour of the parser.
   //
   // E.g. on receiving an OBJECT_OPEN, it will start parsing
@@ -40,25 +162,95 @@ class JsonParser {
     INVALID
   };
 
-  JsonValue ParseValue(const ControlToken tk);
-  JsonValue ParseValue() { return ParseValue(GetNextControlToken()); }
+  // Parses the value which starts with ct, including every value nested in
+  // it, which is inside of depth arrays or objects. Open arrays and objects
+  // are kept on stack_, rather than on the call stack, so deep inputs can't
+  // overflow it.
+  template <typename Handler>
+  void ParseValue(ControlToken ct, Handler& handler, size_t depth = 0);
+
+  template <typename Handler>
+  void ParseScalarValue(const ControlToken ct, Handler& handler);
+
+  // Parses the key starting with ct, and the colon after it, and returns the
+  // token of the value, or INVALID if the key is invalid
+  template <typename Handler>
+  ControlToken ParseKey(const ControlToken ct, Handler& handler);
+
+  // An array or object which is being parsed
+  struct Level {
+    bool object;
+    size_t num_values;
+  };
 
-  JsonValue::ObjectType ParseObject();
-  JsonValue::ArrayType ParseArray();
-  JsonValue::StringType ParseString();
-  JsonValue::NumberType ParseNumber();
+  // Saves level, the innermost container, if there's one, to open another one
+  // inside of it. Fails, and returns false, if that would be nested too
+  // deeply.
+  inline bool PushLevel(const Level& level, size_t outer_depth, size_t& depth);
+
+  // Parses a slice of the comma separated elements of an array, or members
+  // of an object, which spans the whole input. Every slice but the last one
+  // ends right after a comma, the last one ends with the closing bracket,
+  // and optional whitespace. The handler isn't told about the container.
+  template <typename Handler>
+  size_t ParseSlice(Handler& handler, bool members, bool last);
+
+  // Builds the structural index of the input, if it's not too large
+  void BuildIndex();
+
+  // Makes sure nothing but whitespace follows the parsed value
+  void ExpectEnd();
+
+  // Returns the parsed string, which is only valid until the next call
+  StringRef ParseString();
+  StringRef ParseEscapedString(const char* start);
+  StringRef ParseEscapedStringInsitu(const char* start);
+
+  // Returns the first quote, backslash or control char from p, validating the
+  // UTF-8 before it in strict mode. Fails, and returns end_, if it's invalid.
+  inline const char* ScanString(const char* p);
+  const char* ValidateUtf8Run(const char* p);
+
+  // Writes the chars which the escape sequence or control char at p_ stands
+  // for to out, which has room for 4, and returns how many there are
+  size_t DecodeSpecialChar(char* out);
+  size_t DecodeUnicodeEscape(const char* escape, char* out);
+  bool ParseHexDigits(uint32_t* out);
+
+  // Whether a string returned by ParseString points into the input, rather
+  // than into scratch_
+  inline bool InInput(StringRef str) const {
+    return str.data() != scratch_.data();
+  }
+
+  // A number, as it's reported to handlers
+  struct ParsedNumber {
+    enum Kind : int8_t { DOUBLE, INT64, UINT64 } kind;
+    union {
+      double d;
+      int64_t i;
+      uint64_t u;
+    };
+  };
+
+  ParsedNumber ParseNumber();
   JsonValue::BoolType ParseBool();
-  JsonValue ParseNull();
+  void ParseNull();
 
-  inline double ParseSimpleNumber();
+  inline void ParseDigits(uint64_t* w);
+  int64_t ParseExponent();
 
   ControlToken GetNextControlToken();
+  static inline ControlToken ClassifyToken(char c);
 
   inline void SkipSpace();
 
-  // Tries to match the given string, starting from p_.
+  // Moves p_ to the next token using the structural index
+  inline void NextStructural();
+
+  // Tries to match the size chars of val, starting from p_.
   // If successful, returns true, and sets p_ past the matched string.
-  inline bool Match(const std::string& val);
+  inline bool Match(const char* val, size_t size);
 
   inline void AdvanceChar() { ++p_; }
 
@@ -66,27 +258,342 @@ class JsonParser {
   // character pointed to by p_
   inline size_t Capacity() const { return end_ - p_; }
 
-  inline char GetChar() const {
+  // Returns the current char, or fails, and returns '\0', at the end of the
+  // input
+  inline char GetChar() {
     if (p_ == end_) {
-      throw std::runtime_error("unexpected end of input");
+      Fail(ParseErrorCode::UNEXPECTED_END);
+      return '\0';
     }
     return *p_;
   }
 
+  // Returns the current char, or '\0' at the end of the input, where a number
+  // may end
+  inline char PeekChar() const { return p_ == end_ ? '\0' : *p_; }
+
   inline char GetNextChar() {
     AdvanceChar();
     return GetChar();
   }
 
-  inline void Expect(const char c) const;
-  inline void Expect(const ControlToken expected,
-                     const ControlToken actual) const;
+  // Records the error at p_, unless there already is one, and moves to the
+  // end of the input. Whatever is parsed after that is thrown away, and
+  // parsing stops at the next token, which is never the one it expects.
+  void Fail(ParseErrorCode code);
+
+  inline bool failed() const { return error_.code != ParseErrorCode::OK; }
+
+  [[noreturn]] void ThrowError() const;
 
-  std::string GetSurroundings() const;
-  std::string ErrorMessageName(const ControlToken ct) const;
+#if JP_PARSE_STATS
+  // Start counting a parse, and add what it counted to the thread's stats
+  void BeginStats();
+  void EndStats();
+
+  ParseStats stats_;
+
+  // Arena chunks and buffer capacities when the parse began
+  size_t stats_chunks_ = 0;
+  size_t stats_scratch_capacity_ = 0;
+  size_t stats_stack_capacity_ = 0;
+#endif
 
   const char* p_;
-  const char* const start_;
-  const char* const end_;
+  const char* start_;
+  const char* end_;
+
+  ParseError error_;
+
+  Arena* const arena_;
+  StringMode mode_;
+
+  // Writable alias of start_, when parsing in place
+  char* insitu_ = nullptr;
+
+  // Strings with escaped chars are decoded here
+  std::string scratch_;
+
+  // Offsets of the tokens of the input, and the next one to visit. Inputs
+  // which are too large to be indexed are parsed without it.
+  StructuralIndex index_;
+  size_t next_structural_ = 0;
+  bool indexed_ = false;
+
+  // The first byte of an indexed input which isn't valid UTF-8, or end_
+  const char* invalid_utf8_ = nullptr;
+
+  // How many levels are allocated at once, when the first one is saved
+  static const size_t kReservedDepth = 32;
+
+  std::vector<Level> stack_;
+  size_t max_depth_ = kDefaultMaxDepth;
+  Utf8Mode utf8_mode_ = Utf8Mode::STRICT;
 };
+
+template <typename Handler>
+void JsonParser::Parse(Handler& handler) {
+  if (TryParse(handler)) {
+    ThrowError();
+  }
+}
+
+template <typename Handler>
+ParseError JsonParser::TryParse(Handler& handler) {
+  JP_STATS(BeginStats());
+  BuildIndex();
+  ParseValue(GetNextControlToken(), handler);
+  ExpectEnd();
+  JP_STATS(EndStats());
+  return error_;
+}
+
+template <typename Handler>
+const char* JsonParser::ParseScalar(Handler& handler) {
+  const ControlToken ct = GetNextControlToken();
+  assert(ct != ControlToken::OBJECT_OPEN && ct != ControlToken::ARRAY_OPEN);
+  ParseScalarValue(ct, handler);
+  if (failed()) {
+    ThrowError();
+  }
+  return p_;
+}
+
+// This is a state machine, where each label is a state, so that whether the
+// innermost container is an object or an array is mostly known from where the
+// parser is, as it would be in a recursive parser.
+template <typename Handler>
+void JsonParser::ParseValue(ControlToken ct, Handler& handler, size_t depth) {
+  // The innermost container is kept in locals, and the ones around it on
+  // stack_
+  const size_t outer_depth = depth;
+  Level level{false, 0};
+
+  // ct starts a value
+  switch (ct) {
+    case ControlToken::OBJECT_OPEN:
+      goto object_begin;
+    case ControlToken::ARRAY_OPEN:
+      goto array_begin;
+    default:
+      ParseScalarValue(ct, handler);
+      return;
+  }
+
+object_begin:
+  if (!PushLevel(level, outer_depth, depth)) {
+    return;
+  }
+  level = Level{true, 0};
+  AdvanceChar();
+  handler.StartObject();
+  ct = GetNextControlToken();
+  if (ct == ControlToken::OBJECT_CLOSE) {
+    goto object_end;
+  }
+
+object_member:
+  ct = ParseKey(ct, handler);
+  switch (ct) {
+    case ControlToken::OBJECT_OPEN:
+      goto object_begin;
+    case ControlToken::ARRAY_OPEN:
+      goto array_begin;
+    default:
+      ParseScalarValue(ct, handler);
+  }
+
+object_next:
+  ++level.num_values;
+  ct = GetNextControlToken();
+  if (ct == ControlToken::COMMA) {
+    AdvanceChar();
+    ct = GetNextControlToken();
+    goto object_member;
+  }
+  if (ct != ControlToken::OBJECT_CLOSE) {
+    Fail(ParseErrorCode::EXPECTED_OBJECT_END);
+    return;
+  }
+
+object_end:
+  AdvanceChar();
+  handler.EndObject(level.num_values);
+  goto container_end;
+
+array_begin:
+  if (!PushLevel(level, outer_depth, depth)) {
+    return;
+  }
+  level = Level{false, 0};
+  AdvanceChar();
+  handler.StartArray();
+  ct = GetNextControlToken();
+  if (ct == ControlToken::ARRAY_CLOSE) {
+    goto array_end;
+  }
+
+array_element:
+  switch (ct) {
+    case ControlToken::OBJECT_OPEN:
+      goto object_begin;
+    case ControlToken::ARRAY_OPEN:
+      goto array_begin;
+    default:
+      ParseScalarValue(ct, handler);
+  }
+
+array_next:
+  ++level.num_values;
+  ct = GetNextControlToken();
+  if (ct == ControlToken::COMMA) {
+    AdvanceChar();
+    ct = GetNextControlToken();
+    goto array_element;
+  }
+  if (ct != ControlToken::ARRAY_CLOSE) {
+    Fail(ParseErrorCode::EXPECTED_ARRAY_END);
+    return;
+  }
+
+array_end:
+  AdvanceChar();
+  handler.EndArray(level.num_values);
+
+container_end:
+  if (--depth == outer_depth) {
+    return;
+  }
+  level = stack_.back();
+  stack_.pop_back();
+  if (level.object) {
+    goto object_next;
+  }
+  goto array_next;
+}
+
+template <typename Handler>
+void JsonParser::ParseScalarValue(const ControlToken ct, Handler& handler) {
+  switch (ct) {
+    case ControlToken::STRING: {
+      const StringRef str = ParseString();
+      if (!failed()) {
+        handler.String(str, !InInput(str));
+      }
+      break;
+    }
+    case ControlToken::BOOL: {
+      const bool val = ParseBool();
+      if (!failed()) {
+        handler.Bool(val);
+      }
+      break;
+    }
+    case ControlToken::NUMBER: {
+      const ParsedNumber num = ParseNumber();
+      if (failed()) {
+        break;
+      }
+      switch (num.kind) {
+        case ParsedNumber::INT64:
+          handler.Int64(num.i);
+          break;
+        case ParsedNumber::UINT64:
+          handler.Uint64(num.u);
+          break;
+        case ParsedNumber::DOUBLE:
+          handler.Number(num.d);
+          break;
+      }
+      break;
+    }
+    case ControlToken::NULL_VALUE:
+      ParseNull();
+      if (!failed()) {
+        handler.Null();
+      }
+      break;
+    default:
+      Fail(ParseErrorCode::EXPECTED_VALUE);
+  }
+}
+
+template <typename Handler>
+JsonParser::ControlToken JsonParser::ParseKey(const ControlToken ct,
+                                              Handler& handler) {
+  if (ct != ControlToken::STRING) {
+    Fail(ParseErrorCode::EXPECTED_KEY);
+    return ControlToken::INVALID;
+  }
+  const StringRef key = ParseString();
+  if (failed()) {
+    return ControlToken::INVALID;
+  }
+  handler.Key(key, !InInput(key));
+
+  if (GetNextControlToken() != ControlToken::COLON) {
+    Fail(ParseErrorCode::EXPECTED_COLON);
+    return ControlToken::INVALID;
+  }
+  AdvanceChar();
+  return GetNextControlToken();
+}
+
+bool JsonParser::PushLevel(const Level& level, size_t outer_depth,
+                           size_t& depth) {
+  if (depth >= max_depth_) {
+    Fail(ParseErrorCode::TOO_DEEP);
+    return false;
+  }
+  if (depth++ > outer_depth) {
+    if (stack_.capacity() == 0) {
+      stack_.reserve(kReservedDepth);
+    }
+    stack_.push_back(level);
+  }
+  JP_STATS(stats_.max_depth = std::max(stats_.max_depth, depth));
+  return true;
+}
+
+template <typename Handler>
+size_t JsonParser::ParseSlice(Handler& handler, bool members, bool last) {
+  JP_STATS(BeginStats());
+  BuildIndex();
+  const ControlToken close =
+      members ? ControlToken::OBJECT_CLOSE : ControlToken::ARRAY_CLOSE;
+
+  size_t num_values = 0;
+  ControlToken ct = GetNextControlToken();
+  while (true) {
+    if (members) {
+      ct = ParseKey(ct, handler);
+    }
+    ParseValue(ct, handler, 1);
+    ++num_values;
+
+    ct = GetNextControlToken();
+    if (ct != ControlToken::COMMA) {
+      break;
+    }
+    AdvanceChar();
+    if (!last && p_ == end_) {
+      JP_STATS(EndStats());
+      return num_values;
+    }
+    ct = GetNextControlToken();
+  }
+
+  if (ct != (last ? close : ControlToken::COMMA)) {
+    Fail(members ? ParseErrorCode::EXPECTED_OBJECT_END
+                 : ParseErrorCode::EXPECTED_ARRAY_END);
+  } else {
+    AdvanceChar();
+    ExpectEnd();
+  }
+  JP_STATS(EndStats());
+  if (failed()) {
+    ThrowError();
+  }
+  return num_values;
+}
 }
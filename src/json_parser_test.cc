@@ -1,17 +1,35 @@
+#include <cmath>
+#include <cstdlib>
 #include <fstream>
+#include <limits>
 #include <string>
 #include <iostream>
 #include <boost/filesystem.hpp>
 
 #include <gtest/gtest.h>
 
+#include "json_cursor.h"
 #include "json_parser.h"
-#include "token_error.h"
+#include "parse_error.h"
 
 using namespace ::testing;
 using namespace jp;
 using std::string;
 
+// Parsed during static initialization, which may come before that of the
+// parser's own translation unit
+static const JsonValue static_value =
+    JsonParser{"{\"a\": [true, false, null, \"x\\ny\"]}"}.Parse();
+
+TEST(JsonParser, StaticInitialization) {
+  const auto& a = static_value.getObject().at("a").getArray();
+  ASSERT_EQ(4, a.size());
+  EXPECT_TRUE(a[0].getBool());
+  EXPECT_FALSE(a[1].getBool());
+  EXPECT_EQ(JsonValue::NULL_VALUE, a[2].type());
+  EXPECT_EQ("x\ny", a[3].getString());
+}
+
 TEST(JsonParser, EmptyJson) {
   string e = "{}";
   auto obj = JsonParser{e}.Parse().getObject();
@@ -48,6 +66,73 @@ TEST(JsonParser, NumberParsing) {
     std::string json = "{\"num\": " + pair.first + "}";
     auto obj = JsonParser{json}.Parse().getObject();
     EXPECT_EQ(obj.at("num").getNumber(), pair.second);
+
+    // numbers may end at the end of the input
+    EXPECT_EQ(pair.second, JsonParser{pair.first}.Parse().getNumber());
+  }
+}
+
+TEST(JsonParser, IntegerParsing) {
+  const JsonValue val =
+      JsonParser{
+          "[9223372036854775807, -9223372036854775808, 18446744073709551615, "
+          "18446744073709551616, -9223372036854775809, 12, -0, 1.0, 1e2]"}
+          .Parse();
+  const auto& arr = val.getArray();
+  EXPECT_TRUE(arr[0].isInt64());
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), arr[0].getInt64());
+  EXPECT_TRUE(arr[1].isInt64());
+  EXPECT_EQ(std::numeric_limits<int64_t>::min(), arr[1].getInt64());
+  EXPECT_TRUE(arr[2].isUint64());
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), arr[2].getUint64());
+  EXPECT_THROW(arr[2].getInt64(), std::out_of_range);
+
+  // too large integers are doubles
+  EXPECT_FALSE(arr[3].isUint64());
+  EXPECT_EQ(18446744073709551616.0, arr[3].getNumber());
+  EXPECT_FALSE(arr[4].isInt64());
+  EXPECT_EQ(-9223372036854775808.0, arr[4].getNumber());
+
+  EXPECT_EQ(12, arr[5].getUint64());
+  EXPECT_EQ(12.0, arr[5].getNumber());
+  EXPECT_FALSE(arr[6].isInt64());
+  EXPECT_TRUE(std::signbit(arr[6].getNumber()));
+
+  // numbers with a fraction or an exponent are doubles, but may be read as
+  // integers if they are whole
+  EXPECT_FALSE(arr[7].isInt64());
+  EXPECT_EQ(1, arr[7].getInt64());
+  EXPECT_EQ(100, arr[8].getUint64());
+  EXPECT_THROW(JsonParser{"1.5"}.Parse().getInt64(), std::out_of_range);
+  EXPECT_THROW(JsonParser{"-1"}.Parse().getUint64(), std::out_of_range);
+
+  // copies keep the representation
+  const JsonValue copy{arr[2]};
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), copy.getUint64());
+}
+
+// Doubles are correctly rounded, like strtod
+TEST(JsonParser, DoubleRounding) {
+  const std::vector<string> tests{
+      "0.1",
+      "3.141592653589793",
+      "1.7976931348623157e308",
+      "2.2250738585072011e-308",
+      "4.9406564584124654e-324",
+      "2.4703282292062328e-324",
+      "9007199254740993",
+      "9007199254740993.0",
+      "1e23",
+      "7.038531e-26",
+      "123456789012345678901234567890e-20",
+      "2.22507385850720113605740979670913197593481954635164564e-308",
+      "1e400",
+      "1e-400",
+      "0.000000000000000000000000000000000000000001e42"};
+  for (const auto& test : tests) {
+    EXPECT_EQ(std::strtod(test.c_str(), nullptr),
+              JsonParser{test}.Parse().getNumber())
+        << test;
   }
 }
 
@@ -87,7 +172,8 @@ TEST(JsonParser, InvalidJson) {
 }
 
 TEST(JsonParser, InvalidNumber) {
-  std::vector<std::string> jsons = {"{\"a\": 1", "{\"a\": 1.", "{\"a\": 1.}"};
+  std::vector<std::string> jsons = {"{\"a\": 1", "{\"a\": 1.", "{\"a\": 1.}",
+                                    "1.",       "1e",        "-"};
 
   for (const auto& json : jsons) {
     try {
@@ -98,6 +184,56 @@ TEST(JsonParser, InvalidNumber) {
   }
 }
 
+TEST(JsonParser, ErrorCodes) {
+  const std::vector<std::pair<string, ParseErrorCode>> jsons{
+      {"[1, 2", ParseErrorCode::UNEXPECTED_END},
+      {"\"abc", ParseErrorCode::UNEXPECTED_END},
+      {"[1, ]", ParseErrorCode::EXPECTED_VALUE},
+      {"{1: 2}", ParseErrorCode::EXPECTED_KEY},
+      {"{\"a\" 2}", ParseErrorCode::EXPECTED_COLON},
+      {"{\"a\": 1 \"b\": 2}", ParseErrorCode::EXPECTED_OBJECT_END},
+      {"[1 2]", ParseErrorCode::EXPECTED_ARRAY_END},
+      {"\"a\\x\"", ParseErrorCode::INVALID_ESCAPE},
+      {"\"a\tb\"", ParseErrorCode::INVALID_STRING_CHAR},
+      {"\"a\xff\"", ParseErrorCode::INVALID_UTF8},
+      {"\"\\ud800\"", ParseErrorCode::LONE_SURROGATE},
+      {"[01]", ParseErrorCode::INVALID_NUMBER},
+      {"1.e5", ParseErrorCode::INVALID_NUMBER},
+      {"[nul]", ParseErrorCode::INVALID_LITERAL},
+      {"[[[]]]", ParseErrorCode::TOO_DEEP},
+      {"{} {}", ParseErrorCode::TRAILING_CONTENT}};
+  for (const auto& json : jsons) {
+    JsonParser parser{json.first};
+    parser.set_max_depth(2);
+    JsonValue val{true};
+    const ParseError error = parser.TryParse(&val);
+    EXPECT_EQ(json.second, error.code) << json.first;
+    EXPECT_TRUE(val.getBool());
+
+    // the exception has the same error
+    try {
+      JsonParser parser{json.first};
+      parser.set_max_depth(2);
+      parser.Parse();
+      ADD_FAILURE() << json.first;
+    } catch (const ParseException& e) {
+      EXPECT_EQ(json.second, e.error().code);
+      EXPECT_EQ(error.offset, e.error().offset);
+      EXPECT_EQ(error.Message(json.first), e.what());
+    }
+  }
+
+  const string json = "{\"key\": [1, 2}";
+  JsonValue val;
+  const ParseError error = JsonParser{json}.TryParse(&val);
+  EXPECT_EQ(json.find('}'), error.offset);
+  EXPECT_EQ("ey\": [1, 2}\n          ^\nexpected ',' or ']', got '}'",
+            error.Message(json));
+
+  EXPECT_FALSE(JsonParser{json.substr(0, 8) + "[]}"}.TryParse(&val));
+  EXPECT_EQ(1, val.getObject().size());
+}
+
 TEST(JsonParser, ComplexJson) {
   string e =
       "{\"name\":\"Carl\",\"age\":-0.010,\"food\":[\"spaghetti\",\"ice-"
@@ -119,6 +255,70 @@ TEST(JsonParser, StringEscape) {
   }
 }
 
+TEST(JsonParser, UnicodeEscape) {
+  const std::vector<std::pair<string, string>> test_cases{
+      {"\\u0041\\u00e9", "A\xc3\xa9"},
+      {"\\u20AC!", "\xe2\x82\xac!"},
+      {"\\u0000", string(1, '\0')},
+      {"\\ud83d\\ude00", "\xf0\x9f\x98\x80"},
+      {"\\uDBFF\\uDFFF", "\xf4\x8f\xbf\xbf"},
+      {"a\\u00e9\\n\\ud83d\\ude00b", "a\xc3\xa9\n\xf0\x9f\x98\x80" "b"}};
+  for (const auto& t : test_cases) {
+    const string json = "{\"" + t.first + "\": \"" + t.first + "\"}";
+    const JsonValue val = JsonParser{json}.Parse();
+    const auto& member = *val.getObject().begin();
+    EXPECT_EQ(t.second, member.first) << t.first;
+    EXPECT_EQ(t.second, member.second.getString()) << t.first;
+  }
+
+  for (const string json : {"\"\\u12\"", "\"\\u12g4\"", "\"\\U1234\"",
+                            "\"\\ud800\\u12\"", "\"\\u00e"}) {
+    EXPECT_THROW(JsonParser{json}.Parse(), ParseException) << json;
+  }
+}
+
+TEST(JsonParser, Utf8Modes) {
+  // a high surrogate without a low one, a low one on its own, and one
+  // followed by an escape which isn't a surrogate
+  const std::vector<std::pair<string, string>> surrogates{
+      {"\"a\\ud800b\"", "a\xef\xbf\xbd" "b"},
+      {"\"\\ude00\"", "\xef\xbf\xbd"},
+      {"\"\\ud800\\u0041\"", "\xef\xbf\xbd" "A"},
+      {"\"\\ud800\\ud800\\udc00\"", "\xef\xbf\xbd\xf0\x90\x80\x80"}};
+  for (const auto& t : surrogates) {
+    JsonValue val;
+    const ParseError error = JsonParser{t.first}.TryParse(&val);
+    EXPECT_EQ(ParseErrorCode::LONE_SURROGATE, error.code) << t.first;
+    EXPECT_EQ(t.first.find('\\'), error.offset) << t.first;
+
+    JsonParser parser{t.first};
+    parser.set_utf8_mode(JsonParser::Utf8Mode::PERMISSIVE);
+    EXPECT_EQ(t.second, parser.Parse().getString()) << t.first;
+  }
+
+  // overlong, a surrogate, too large, a stray continuation, and cut short
+  for (const string str : {"\xc0\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80",
+                           "\x80", "\xe2\x82", "\xff"}) {
+    const string json = "[\"ab\xc3\xa9\", \"x\\n" + str + "\"]";
+    JsonValue val;
+    const ParseError error = JsonParser{json}.TryParse(&val);
+    EXPECT_EQ(ParseErrorCode::INVALID_UTF8, error.code);
+    EXPECT_EQ(json.find(str), error.offset);
+    // strings parsed on their own, without indexing the input, are
+    // validated one at a time
+    EXPECT_THROW(JsonCursor{json}[1].getString(), ParseException);
+
+    JsonParser parser{json};
+    parser.set_utf8_mode(JsonParser::Utf8Mode::PERMISSIVE);
+    EXPECT_EQ("x\n" + str, parser.Parse().getArray()[1].getString());
+  }
+
+  const string valid = "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80 \xe6\x97\xa5\xe6\x9c\xac\"";
+  EXPECT_EQ(valid.substr(1, valid.size() - 2),
+            JsonParser{valid}.Parse().getString());
+  EXPECT_EQ(valid.substr(1, valid.size() - 2), JsonCursor{valid}.getString());
+}
+
 TEST(JsonParser, SkipWhiteSpace) {
   string e = " { \" na me \"   :  \" A da m \"    , \"age   \":  10  }";
   auto obj = JsonParser{e}.Parse().getObject();
@@ -126,6 +326,185 @@ TEST(JsonParser, SkipWhiteSpace) {
   EXPECT_EQ(10, obj.at("age   ").getNumber());
 }
 
+TEST(JsonValue, Compact) { EXPECT_EQ(16, sizeof(JsonValue)); }
+
+TEST(JsonValue, TryGet) {
+  const JsonValue val =
+      JsonParser{"[{}, [], \"s\", -1, 1.5, 18446744073709551615, true]"}
+          .Parse();
+  const auto& arr = val.getArray();
+
+  const JsonValue::ObjectType* obj = nullptr;
+  const JsonValue::ArrayType* array = nullptr;
+  EXPECT_TRUE(arr[0].tryGet(&obj));
+  EXPECT_EQ(&arr[0].getObject(), obj);
+  EXPECT_FALSE(arr[0].tryGet(&array));
+  EXPECT_TRUE(val.tryGet(&array));
+  EXPECT_EQ(7, array->size());
+
+  StringRef str;
+  EXPECT_TRUE(arr[2].tryGet(&str));
+  EXPECT_EQ("s", str);
+  EXPECT_FALSE(arr[3].tryGet(&str));
+
+  int64_t i = 0;
+  uint64_t u = 0;
+  double d = 0;
+  EXPECT_TRUE(arr[3].tryGet(&i));
+  EXPECT_EQ(-1, i);
+  EXPECT_FALSE(arr[3].tryGet(&u));
+  EXPECT_FALSE(arr[4].tryGet(&i));
+  EXPECT_TRUE(arr[4].tryGet(&d));
+  EXPECT_EQ(1.5, d);
+  EXPECT_FALSE(arr[5].tryGet(&i));
+  EXPECT_TRUE(arr[5].tryGet(&u));
+  EXPECT_EQ(UINT64_MAX, u);
+  EXPECT_EQ(-1, i);
+
+  bool b = false;
+  EXPECT_FALSE(arr[2].tryGet(&b));
+  EXPECT_TRUE(arr[6].tryGet(&b));
+  EXPECT_TRUE(b);
+  EXPECT_FALSE(arr[6].tryGet(&d));
+}
+
+TEST(JsonValue, MoveAssignment) {
+  string e = "{\"arr\":[1,\"two\",{\"three\":3}]}";
+  auto val = JsonParser{e}.Parse();
+  JsonValue arr = val.getObject().at("arr");
+  EXPECT_TRUE(arr.is<JsonValue::ARRAY>());
+
+  JsonValue other{1.0};
+  other = std::move(arr);
+  EXPECT_TRUE(arr.is<JsonValue::NULL_VALUE>());
+  ASSERT_TRUE(other.is<JsonValue::ARRAY>());
+  EXPECT_EQ(3, other.getArray().size());
+  EXPECT_EQ("two", other.getArray()[1].getString());
+  EXPECT_EQ(3, other.getArray()[2].getObject().at("three").getNumber());
+
+  // the copy is independent of the original
+  EXPECT_EQ(3, val.getObject().at("arr").getArray().size());
+}
+
+// Records the events of the parser as a string
+struct RecordingHandler {
+  void StartObject() { events += "{"; }
+  void Key(StringRef key, bool) { events += key.str() + ":"; }
+  void EndObject(size_t n) { events += "}" + std::to_string(n) + " "; }
+  void StartArray() { events += "["; }
+  void EndArray(size_t n) { events += "]" + std::to_string(n) + " "; }
+  void String(StringRef str, bool copy) {
+    events += "'" + str.str() + (copy ? "'c " : "' ");
+  }
+  void Int64(int64_t num) { events += std::to_string(num) + " "; }
+  void Uint64(uint64_t num) { events += std::to_string(num) + " "; }
+  void Number(double num) { events += std::to_string(int(num)) + " "; }
+  void Bool(bool val) { events += val ? "true " : "false "; }
+  void Null() { events += "null "; }
+
+  string events;
+};
+
+TEST(JsonParser, Handler) {
+  string e = "{\"a\": [1, \"x\\ty\", {}], \"b\": {\"c\": null, \"d\": true}}";
+  RecordingHandler handler;
+  JsonParser{e}.Parse(handler);
+  EXPECT_EQ("{a:[1 'x\ty'c {}0 ]3 b:{c:null d:true }2 }2 ", handler.events);
+}
+
+TEST(JsonParser, HandlerInvalidJson) {
+  RecordingHandler handler;
+  EXPECT_THROW(JsonParser{"[1, }"}.Parse(handler), std::exception);
+  EXPECT_EQ("[1 ", handler.events);
+
+  // nor after an invalid scalar
+  RecordingHandler scalars;
+  EXPECT_TRUE(JsonParser{"[1, tru, 2]"}.TryParse(scalars));
+  EXPECT_EQ("[1 ", scalars.events);
+}
+
+TEST(JsonParser, DuplicateKeys) {
+  string e = "{\"a\": {\"b\": 1, \"b\": [2]}, \"a\": 3}";
+  auto obj = JsonParser{e}.Parse().getObject();
+  EXPECT_EQ(1, obj.size());
+  EXPECT_EQ(1, obj.at("a").getObject().at("b").getNumber());
+}
+
+TEST(JsonParser, ObjectOrder) {
+  string e = "{\"z\": 1, \"a\": 2, \"m\": 3}";
+  auto obj = JsonParser{e}.Parse().getObject();
+  string keys;
+  for (const auto& member : obj) {
+    keys += member.first.str();
+  }
+  EXPECT_EQ("zam", keys);
+}
+
+TEST(JsonParser, LargeObject) {
+  string e = "{";
+  for (int i = 0; i < 1000; ++i) {
+    e += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+  }
+  e += ",\"k7\": -1}";
+  auto obj = JsonParser{e}.Parse().getObject();
+  ASSERT_EQ(1000, obj.size());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i, obj.at("k" + std::to_string(i)).getInt64());
+  }
+  EXPECT_EQ(obj.end(), obj.find("k1000"));
+  EXPECT_EQ("k999", (obj.end() - 1)->first);
+
+  JsonValue::ObjectType copy{obj};
+  EXPECT_EQ(999, copy.at("k999").getInt64());
+  EXPECT_FALSE(copy.emplace("k5", JsonValue{}).second);
+  EXPECT_TRUE(copy.emplace("k1000", JsonValue{}).second);
+  EXPECT_TRUE(copy.at("k1000").is<JsonValue::NULL_VALUE>());
+}
+
+TEST(JsonParser, MaxDepth) {
+  const string deep = string(10, '[') + string(10, ']');
+  EXPECT_NO_THROW(JsonParser{deep}.Parse());
+
+  JsonParser parser{deep};
+  parser.set_max_depth(9);
+  EXPECT_THROW(parser.Parse(), std::runtime_error);
+
+  const string members = "{\"a\":{\"b\":[{}]}}";
+  JsonParser exact{members};
+  exact.set_max_depth(4);
+  EXPECT_NO_THROW(exact.Parse());
+  JsonParser too_deep{members};
+  too_deep.set_max_depth(3);
+  EXPECT_THROW(too_deep.Parse(), std::runtime_error);
+
+  // the default limit is enforced
+  const size_t n = JsonParser::kDefaultMaxDepth;
+  EXPECT_NO_THROW(JsonParser{string(n, '[') + string(n, ']')}.Parse());
+  EXPECT_THROW(JsonParser{string(n + 1, '[') + string(n + 1, ']')}.Parse(),
+               std::runtime_error);
+}
+
+TEST(JsonParser, DeepInput) {
+  // far deeper than the call stack would allow a recursive parser to go
+  const size_t n = 1000000;
+  string e;
+  for (size_t i = 0; i < n; ++i) {
+    e += i % 2 ? "[1," : "{\"a\":";
+  }
+  e += "0";
+  for (size_t i = n; i-- > 0;) {
+    e += i % 2 ? "]" : "}";
+  }
+
+  RecordingHandler handler;
+  JsonParser parser{e};
+  parser.set_max_depth(n);
+  parser.Parse(handler);
+  const string& events = handler.events;
+  EXPECT_EQ("{a:[1 {a:[1 {a:", events.substr(0, 15));
+  EXPECT_EQ("}1 ]2 }1 ]2 }1 ", events.substr(events.size() - 15));
+}
+
 TEST(JsonParser, JsonOrgTests) {
   boost::filesystem::path test_dir("test_data/json.org");
   assert(boost::filesystem::is_directory(test_dir));
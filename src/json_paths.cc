@@ -0,0 +1,221 @@
+#include "json_paths.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "json_scan.h"
+
+namespace jp {
+
+namespace {
+
+const size_t kNotAnIndex = SIZE_MAX;
+
+// The most keys or indexes looked for in a single value, which are tracked
+// with the bits of a uint64_t
+const size_t kMaxChildren = 64;
+
+// Decodes the ~0 and ~1 escapes of a component of path
+std::string Unescape(const std::string& component, const std::string& path) {
+  std::string out;
+  for (size_t i = 0; i < component.size(); ++i) {
+    if (component[i] != '~') {
+      out += component[i];
+      continue;
+    }
+    if (i + 1 == component.size() ||
+        (component[i + 1] != '0' && component[i + 1] != '1')) {
+      throw std::invalid_argument("invalid escape in JSON Pointer: " + path);
+    }
+    out += component[++i] == '0' ? '~' : '/';
+  }
+  return out;
+}
+
+// The array index key stands for, which has no leading zeros, or kNotAnIndex
+size_t ArrayIndex(const std::string& key) {
+  if (key.empty() || key.size() > 18 || (key[0] == '0' && key.size() > 1)) {
+    return kNotAnIndex;
+  }
+  size_t index = 0;
+  for (const char c : key) {
+    if (c < '0' || c > '9') {
+      return kNotAnIndex;
+    }
+    index = index * 10 + (c - '0');
+  }
+  return index;
+}
+}
+
+JsonPaths::JsonPaths(const std::vector<std::string>& paths)
+    : nodes_(1), num_paths_(paths.size()) {
+  for (size_t i = 0; i < paths.size(); ++i) {
+    const std::string& path = paths[i];
+    if (!path.empty() && path[0] != '/') {
+      throw std::invalid_argument("not a JSON Pointer: " + path);
+    }
+    size_t node = 0;
+    for (size_t pos = 0; pos != path.size();) {
+      const size_t next = std::min(path.find('/', pos + 1), path.size());
+      const std::string component = path.substr(pos + 1, next - pos - 1);
+      pos = next;
+
+      if (component == "*") {
+        if (!nodes_[node].wildcard) {
+          nodes_[node].wildcard = nodes_.size();
+          nodes_.emplace_back();
+        }
+        node = nodes_[node].wildcard;
+        continue;
+      }
+      const std::string key = Unescape(component, path);
+      auto& children = nodes_[node].children;
+      const auto it =
+          std::find_if(children.begin(), children.end(),
+                       [&](const Node::Child& c) { return c.key == key; });
+      if (it != children.end()) {
+        node = it->node;
+        continue;
+      }
+      if (children.size() == kMaxChildren) {
+        throw std::invalid_argument("too many keys looked for in a value: " +
+                                    path);
+      }
+      children.push_back(Node::Child{key, ArrayIndex(key), nodes_.size()});
+      node = nodes_.size();
+      nodes_.emplace_back();
+    }
+    nodes_[node].paths.push_back(i);
+  }
+}
+
+void JsonPaths::Extract(const char* p, const char* end,
+                        const Callback& callback) const {
+  Visit(nodes_[0], SkipSpace(p, end), end, false, callback);
+}
+
+const char* JsonPaths::Visit(const Node& node, const char* p, const char* end,
+                             bool need_end, const Callback& callback) const {
+  if (p == end) {
+    ThrowEndOfInput();
+  }
+  for (const size_t path : node.paths) {
+    callback(path, JsonCursor{p, end});
+  }
+  if (!node.children.empty() || node.wildcard) {
+    switch (*p) {
+      case '{':
+        return VisitObject(node, p, end, need_end, callback);
+      case '[':
+        return VisitArray(node, p, end, need_end, callback);
+    }
+  }
+  return need_end ? SkipValue(p, end) : nullptr;
+}
+
+const char* JsonPaths::VisitObject(const Node& node, const char* p,
+                                   const char* end, bool need_end,
+                                   const Callback& callback) const {
+  const uint64_t all = node.children.size() == kMaxChildren
+                           ? ~uint64_t{0}
+                           : (uint64_t{1} << node.children.size()) - 1;
+  uint64_t found = 0;
+
+  p = Consume(p, end, '{');
+  if (p != end && *p == '}') {
+    return p + 1;
+  }
+  while (true) {
+    if (p == end || *p != '"') {
+      throw std::runtime_error("expected a key");
+    }
+    const char* key_end = SkipString(p, end);
+    const Node::Child* child = nullptr;
+    for (size_t i = 0; i < node.children.size(); ++i) {
+      if (!(found >> i & 1) &&
+          KeyEquals(p, key_end, node.children[i].key)) {
+        child = &node.children[i];
+        found |= uint64_t{1} << i;
+        break;
+      }
+    }
+    p = Consume(SkipSpace(key_end, end), end, ':');
+
+    // whether nothing more is looked for in this object after this member
+    const bool last = !node.wildcard && found == all;
+    const char* value_end = nullptr;
+    if (child) {
+      value_end = Visit(nodes_[child->node], p, end,
+                        need_end || !last, callback);
+    }
+    if (node.wildcard) {
+      value_end = Visit(nodes_[node.wildcard], p, end, true, callback);
+    } else if (!child) {
+      value_end = SkipValue(p, end);
+    }
+    if (last) {
+      return need_end ? SkipToClose(value_end, end, 1) : nullptr;
+    }
+
+    p = SkipSpace(value_end, end);
+    if (p != end && *p == '}') {
+      return p + 1;
+    }
+    p = Consume(p, end, ',');
+  }
+}
+
+const char* JsonPaths::VisitArray(const Node& node, const char* p,
+                                  const char* end, bool need_end,
+                                  const Callback& callback) const {
+  // the last index looked for, if there's one
+  size_t last_index = 0;
+  bool has_index = false;
+  for (const auto& child : node.children) {
+    if (child.index != kNotAnIndex) {
+      last_index = has_index ? std::max(last_index, child.index) : child.index;
+      has_index = true;
+    }
+  }
+  if (!has_index && !node.wildcard) {
+    return need_end ? SkipValue(p, end) : nullptr;
+  }
+
+  p = Consume(p, end, '[');
+  if (p != end && *p == ']') {
+    return p + 1;
+  }
+  for (size_t i = 0;; ++i) {
+    const Node::Child* child = nullptr;
+    for (const auto& c : node.children) {
+      if (c.index == i) {
+        child = &c;
+        break;
+      }
+    }
+
+    const bool last = !node.wildcard && i == last_index;
+    const char* value_end = nullptr;
+    if (child) {
+      value_end = Visit(nodes_[child->node], p, end,
+                        need_end || !last, callback);
+    }
+    if (node.wildcard) {
+      value_end = Visit(nodes_[node.wildcard], p, end, true, callback);
+    } else if (!child) {
+      value_end = SkipValue(p, end);
+    }
+    if (last) {
+      return need_end ? SkipToClose(value_end, end, 1) : nullptr;
+    }
+
+    p = SkipSpace(value_end, end);
+    if (p != end && *p == ']') {
+      return p + 1;
+    }
+    p = Consume(p, end, ',');
+  }
+}
+}
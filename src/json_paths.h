@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "json_cursor.h"
+
+namespace jp {
+
+// A set of JSON Pointers (RFC 6901), compiled once, which extracts the values
+// they point to from many inputs, in a single pass over each:
+//
+//   JsonPaths paths{{"/events/*/id", "/meta/version"}};
+//   paths.Extract(json, [](size_t path, const JsonCursor& value) { ... });
+//
+// A "*" component matches every member of an object, and every element of
+// an array; other components match the member with that key, or the element
+// with that index. Values which no path goes into are skipped by matching
+// brackets, like JsonCursor does, without parsing them, and an object isn't
+// scanned any further once every key the paths look for in it is found. Only
+// the parts of the input which are visited are validated.
+class JsonPaths {
+ public:
+  // Throws std::invalid_argument if a path isn't a JSON Pointer, or if more
+  // than 64 keys or indexes are looked for in a single value
+  explicit JsonPaths(const std::vector<std::string>& paths);
+
+  // Called with the index of the path, and the value it points to
+  using Callback = std::function<void(size_t path, const JsonCursor& value)>;
+
+  // Calls callback for every value a path points to, in the order of the
+  // input. Paths which match nothing aren't reported, and neither are
+  // duplicate keys after the first one. The values point into the input,
+  // which must outlive them.
+  void Extract(const char* p, const char* end, const Callback& callback) const;
+  void Extract(const std::string& json, const Callback& callback) const {
+    Extract(json.data(), json.data() + json.size(), callback);
+  }
+
+  size_t size() const { return num_paths_; }
+
+ private:
+  // Paths share the nodes of their common prefix, as in a trie
+  struct Node {
+    // The paths which end at this value
+    std::vector<size_t> paths;
+
+    // The keys looked for in this value, with their nodes
+    struct Child {
+      std::string key;
+      size_t index;  // what key is as an array index, or SIZE_MAX if it isn't
+      size_t node;
+    };
+    std::vector<Child> children;
+
+    // The node of "*", or 0 if there's none, since the root isn't a child
+    size_t wildcard = 0;
+  };
+
+  // Reports the value at p, which node is at, and the values in it which
+  // paths go into. Returns the position after the value, or nullptr if
+  // need_end is false, and the scan stopped before its end.
+  const char* Visit(const Node& node, const char* p, const char* end,
+                    bool need_end, const Callback& callback) const;
+  const char* VisitObject(const Node& node, const char* p, const char* end,
+                          bool need_end, const Callback& callback) const;
+  const char* VisitArray(const Node& node, const char* p, const char* end,
+                         bool need_end, const Callback& callback) const;
+
+  std::vector<Node> nodes_;
+  size_t num_paths_;
+};
+}
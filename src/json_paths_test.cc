@@ -0,0 +1,96 @@
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "json_paths.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+const string kJson =
+    " {\"skipped\": {\"a\": [1, {\"id\": \"}]\\\"\"}], \"c\": \"x\"},"
+    " \"events\": [{\"id\": 1, \"name\": \"first\"}, [], \"[{\","
+    "   {\"name\": \"second\", \"id\": 2}],"
+    " \"meta\": {\"version\": 3, \"a/b\": 4, \"m~n\": 5, \"0\": 6},"
+    " \"esc\\u0061ped\": true, \"dup\": 1, \"dup\": 2} ";
+
+// The paths and raw values extracted from json
+std::vector<std::pair<size_t, string>> Extract(const JsonPaths& paths,
+                                               const string& json) {
+  std::vector<std::pair<size_t, string>> out;
+  paths.Extract(json, [&](size_t path, const JsonCursor& value) {
+    out.emplace_back(path, value.raw().str());
+  });
+  return out;
+}
+
+using Matches = std::vector<std::pair<size_t, string>>;
+}
+
+TEST(JsonPaths, Keys) {
+  const JsonPaths paths{{"/meta/version", "/events/0/name", "/escaped",
+                         "/dup", "/meta/a~1b", "/meta/m~0n", "/missing",
+                         "/events/9", "/meta/version/x"}};
+  EXPECT_EQ(9, paths.size());
+  EXPECT_EQ((Matches{{1, "\"first\""}, {0, "3"}, {4, "4"}, {5, "5"},
+                     {2, "true"}, {3, "1"}}),
+            Extract(paths, kJson));
+}
+
+TEST(JsonPaths, Wildcards) {
+  EXPECT_EQ((Matches{{0, "1"}, {0, "2"}}),
+            Extract(JsonPaths{{"/events/*/id"}}, kJson));
+  // an index is a key of an object too
+  EXPECT_EQ((Matches{{0, "{\"id\": 1, \"name\": \"first\"}"}, {0, "6"}}),
+            Extract(JsonPaths{{"/*/0"}}, kJson));
+  EXPECT_EQ((Matches{{1, "{\"id\": 1, \"name\": \"first\"}"},
+                     {0, "1"},
+                     {1, "[]"},
+                     {1, "\"[{\""},
+                     {1, "{\"name\": \"second\", \"id\": 2}"},
+                     {0, "2"}}),
+            Extract(JsonPaths{{"/events/*/id", "/events/*"}}, kJson));
+  EXPECT_EQ((Matches{{0, "\"first\""}, {1, "\"first\""}}),
+            Extract(JsonPaths{{"/events/0/name", "/*/0/name"}}, kJson));
+}
+
+TEST(JsonPaths, Root) {
+  const JsonPaths paths{{"", "/"}};
+  EXPECT_EQ((Matches{{0, "[1]"}}), Extract(paths, "  [1] "));
+  EXPECT_EQ((Matches{{0, "{\"\": 2}"}, {1, "2"}}),
+            Extract(paths, "{\"\": 2}"));
+}
+
+TEST(JsonPaths, StopsEarly) {
+  // nothing is scanned after the last value looked for, even if it's invalid
+  EXPECT_EQ((Matches{{0, "1"}}), Extract(JsonPaths{{"/a"}}, "{\"a\": 1, ]"));
+  EXPECT_EQ((Matches{{0, "1"}, {1, "2"}}),
+            Extract(JsonPaths{{"/a/0", "/b"}}, "{\"a\": [1, 2], \"b\": 2 ]"));
+  EXPECT_THROW(Extract(JsonPaths{{"/a/*"}}, "{\"a\": [1, 2 }"),
+               std::runtime_error);
+}
+
+TEST(JsonPaths, Errors) {
+  EXPECT_THROW(JsonPaths{{"a"}}, std::invalid_argument);
+  EXPECT_THROW(JsonPaths{{"/a~2"}}, std::invalid_argument);
+  EXPECT_THROW(JsonPaths{{"/a~"}}, std::invalid_argument);
+  std::vector<string> many;
+  for (int i = 0; i < 65; ++i) {
+    many.push_back("/" + std::to_string(i));
+  }
+  EXPECT_THROW(JsonPaths{many}, std::invalid_argument);
+  many.pop_back();
+  EXPECT_NO_THROW(JsonPaths{many});
+
+  const JsonPaths paths{{"/a/b"}};
+  EXPECT_THROW(Extract(paths, "  "), std::runtime_error);
+  EXPECT_THROW(Extract(paths, "{\"a\": {1: 2}}"), std::runtime_error);
+  EXPECT_THROW(Extract(paths, "{\"a\" 1}"), std::runtime_error);
+  EXPECT_THROW(Extract(paths, "{\"a\": {\"b\": "), std::runtime_error);
+}
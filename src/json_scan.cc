@@ -0,0 +1,133 @@
+#include "json_scan.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "dom_builder.h"
+#include "json_parser.h"
+#include "structural_index.h"
+
+namespace jp {
+
+namespace {
+
+struct BracketOrQuoteTable {
+  BracketOrQuoteTable() {
+    for (const char c : {'"', '{', '}', '[', ']'}) {
+      values[static_cast<uint8_t>(c)] = true;
+    }
+  }
+  bool operator[](uint8_t c) const { return values[c]; }
+
+  bool values[256] = {};
+};
+
+const BracketOrQuoteTable kBracketOrQuote;
+}
+
+void ThrowEndOfInput() {
+  throw std::runtime_error("unexpected end of input");
+}
+
+const char* Consume(const char* p, const char* end, char c) {
+  if (p == end) {
+    ThrowEndOfInput();
+  }
+  if (*p != c) {
+    throw std::runtime_error(std::string("expected '") + c + "', got '" + *p +
+                             "'");
+  }
+  return SkipSpace(p + 1, end);
+}
+
+const char* SkipString(const char* p, const char* end) {
+  ++p;
+  while (true) {
+    p = FindStringSpecialChar(p, end);
+    if (p == end) {
+      ThrowEndOfInput();
+    }
+    if (*p == '"') {
+      return p + 1;
+    }
+    // skip the escaped char, control chars are only reported when the string
+    // is parsed
+    p += *p == '\\' ? 2 : 1;
+    if (p > end) {
+      ThrowEndOfInput();
+    }
+  }
+}
+
+const char* SkipToClose(const char* p, const char* end, size_t depth) {
+  while (p != end) {
+    // most chars are neither quotes nor brackets
+    while (!kBracketOrQuote[static_cast<uint8_t>(*p)]) {
+      if (++p == end) {
+        ThrowEndOfInput();
+      }
+    }
+    switch (*p) {
+      case '"':
+        p = SkipString(p, end);
+        continue;
+      case '{':
+      case '[':
+        ++depth;
+        break;
+      case '}':
+      case ']':
+        if (--depth == 0) {
+          return p + 1;
+        }
+        break;
+    }
+    ++p;
+  }
+  ThrowEndOfInput();
+}
+
+const char* SkipValue(const char* p, const char* end) {
+  if (p == end) {
+    ThrowEndOfInput();
+  }
+  switch (*p) {
+    case '"':
+      return SkipString(p, end);
+    case '{':
+    case '[':
+      return SkipToClose(p + 1, end, 1);
+    default:
+      while (p != end && !IsSpace(*p) && *p != ',' && *p != '}' &&
+             *p != ']') {
+        ++p;
+      }
+      return p;
+  }
+}
+
+const char* NextInContainer(const char* p, const char* end, char close) {
+  p = SkipSpace(p, end);
+  if (p != end && *p == close) {
+    return nullptr;
+  }
+  return Consume(p, end, ',');
+}
+
+const char* FirstInContainer(const char* p, const char* end, char open,
+                             char close) {
+  p = Consume(p, end, open);
+  return p != end && *p == close ? nullptr : p;
+}
+
+bool KeyEquals(const char* p, const char* key_end, StringRef key) {
+  StringRef raw{p + 1, static_cast<size_t>(key_end - p - 2)};
+  if (!std::memchr(raw.data(), '\\', raw.size())) {
+    return raw == key;
+  }
+  DomBuilder builder{nullptr, false};
+  JsonParser{p, key_end}.ParseScalar(builder);
+  return builder.TakeRoot().getString() == key;
+}
+}
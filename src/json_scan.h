@@ -0,0 +1,46 @@
+#pragma once
+
+#include "helpers.h"
+#include "string_ref.h"
+
+namespace jp {
+
+// Scanning of JSON text without parsing it, for JsonCursor and JsonPaths.
+// Values are skipped by matching brackets and quotes, and nothing else about
+// them is looked at, so only what is parsed afterwards is validated. Input
+// which can't be scanned throws std::runtime_error.
+
+inline const char* SkipSpace(const char* p, const char* end) {
+  while (p != end && IsSpace(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+[[noreturn]] void ThrowEndOfInput();
+
+// Expects c at p, and returns the next non-whitespace position after it
+const char* Consume(const char* p, const char* end, char c);
+
+// p is at the opening quote, returns the position after the closing one
+const char* SkipString(const char* p, const char* end);
+
+// Returns the position after the value at p
+const char* SkipValue(const char* p, const char* end);
+
+// p is inside of depth nested arrays or objects, returns the position after
+// the bracket which closes the outermost one
+const char* SkipToClose(const char* p, const char* end, size_t depth);
+
+// After a value of a container, returns the start of the next value, or
+// nullptr at the end of the container
+const char* NextInContainer(const char* p, const char* end, char close);
+
+// Returns the first value, or member, of the container at p, or nullptr if
+// it's empty
+const char* FirstInContainer(const char* p, const char* end, char open,
+                             char close);
+
+// Returns whether the key at p, which spans until key_end, is key
+bool KeyEquals(const char* p, const char* key_end, StringRef key);
+}
@@ -0,0 +1,216 @@
+#include "json_tape.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace jp {
+
+namespace {
+
+const char kTapeMagic[4] = {'J', 'P', 'T', 'P'};
+
+// Lays a JsonValue out as nodes, and the chars of its strings
+class TapeBuilder {
+ public:
+  explicit TapeBuilder(const JsonValue& val) : nodes_(1) { Fill(0, val); }
+
+  // Appends the tape to out
+  void Write(std::string* out) {
+    strings_.resize((strings_.size() + 7) & ~size_t{7});
+
+    // Offsets of strings were relative to the start of the chars, and they
+    // are relative to their nodes in the tape
+    const uint64_t nodes_size = nodes_.size() * sizeof(TapeNode);
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      if (nodes_[i].type == JsonValue::STRING) {
+        nodes_[i].payload += nodes_size - i * sizeof(TapeNode);
+      }
+    }
+
+    TapeHeader header;
+    std::memcpy(header.magic, kTapeMagic, sizeof(kTapeMagic));
+    header.version = kTapeVersion;
+    header.byte_order = kTapeByteOrder;
+    header.reserved = 0;
+    header.num_nodes = nodes_.size();
+    header.strings_size = strings_.size();
+
+    // The nodes and the chars are copied into words, for the checksum
+    std::vector<uint64_t> body((nodes_size + strings_.size()) / 8);
+    char* p = reinterpret_cast<char*>(body.data());
+    std::memcpy(p, nodes_.data(), nodes_size);
+    std::memcpy(p + nodes_size, strings_.data(), strings_.size());
+    header.checksum = TapeChecksum(p, body.size() * 8);
+
+    out->append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out->append(p, body.size() * 8);
+  }
+
+ private:
+  // Lays out val as the node at i, and its contents after the current nodes
+  void Fill(size_t i, const JsonValue& val) {
+    TapeNode node{};
+    node.type = val.type();
+    switch (val.type()) {
+      case JsonValue::OBJECT: {
+        const auto& obj = val.getObject();
+        size_t member = AddNodes(i, obj.size() * 2, &node);
+        node.size = static_cast<uint32_t>(obj.size());
+        for (const auto& m : obj) {
+          FillString(member++, m.first, true);
+          Fill(member++, m.second);
+        }
+        break;
+      }
+      case JsonValue::ARRAY: {
+        const auto& arr = val.getArray();
+        size_t element = AddNodes(i, arr.size(), &node);
+        node.size = static_cast<uint32_t>(arr.size());
+        for (const JsonValue& e : arr) {
+          Fill(element++, e);
+        }
+        break;
+      }
+      case JsonValue::STRING:
+        FillString(i, val.getString(), false);
+        return;
+      case JsonValue::NUMBER:
+        if (val.isInt64()) {
+          node.payload = static_cast<uint64_t>(val.getInt64());
+          node.flags = kTapeInt64;
+        } else if (val.isUint64()) {
+          node.payload = val.getUint64();
+          node.flags = kTapeUint64;
+        } else {
+          const double num = val.getNumber();
+          std::memcpy(&node.payload, &num, sizeof(num));
+        }
+        break;
+      case JsonValue::BOOL:
+        node.payload = val.getBool();
+        break;
+      case JsonValue::NULL_VALUE:
+        break;
+    }
+    nodes_[i] = node;
+  }
+
+  // Adds n nodes for the contents of the container at i, and returns the
+  // first one
+  size_t AddNodes(size_t i, size_t n, TapeNode* node) {
+    const size_t first = nodes_.size();
+    nodes_.resize(first + n);
+    node->payload = first - i;
+    return first;
+  }
+
+  void FillString(size_t i, StringRef str, bool key) {
+    TapeNode node{};
+    node.type = JsonValue::STRING;
+    node.size = static_cast<uint32_t>(str.size());
+    if (key) {
+      auto it = keys_.find(str);
+      if (it == keys_.end()) {
+        it = keys_.emplace(str, AddString(str)).first;
+      }
+      node.payload = it->second;
+    } else {
+      node.payload = AddString(str);
+    }
+    nodes_[i] = node;
+  }
+
+  uint64_t AddString(StringRef str) {
+    const uint64_t offset = strings_.size();
+    strings_.append(str.data(), str.size());
+    return offset;
+  }
+
+  std::vector<TapeNode> nodes_;
+  std::string strings_;
+
+  // Offsets of the keys added so far, which point into the value
+  std::unordered_map<StringRef, uint64_t, StringRefHash> keys_;
+};
+}
+
+uint64_t TapeChecksum(const char* data, size_t size) {
+  // Four independent lanes of multiply and xorshift, so they overlap
+  const uint64_t kMul = 0x9e3779b97f4a7c15ULL;
+  uint64_t lanes[4] = {1, 2, 3, 4};
+  const uint64_t* words = reinterpret_cast<const uint64_t*>(data);
+  const size_t n = size / 8;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (size_t j = 0; j < 4; ++j) {
+      lanes[j] = (lanes[j] ^ words[i + j]) * kMul;
+      lanes[j] ^= lanes[j] >> 29;
+    }
+  }
+  for (; i < n; ++i) {
+    lanes[0] = (lanes[0] ^ words[i]) * kMul;
+    lanes[0] ^= lanes[0] >> 29;
+  }
+  uint64_t hash = size;
+  for (const uint64_t lane : lanes) {
+    hash = (hash ^ lane) * kMul;
+    hash ^= hash >> 29;
+  }
+  return hash;
+}
+
+void WriteTape(const JsonValue& val, std::string* out) {
+  TapeBuilder{val}.Write(out);
+}
+
+void WriteTapeFile(const JsonValue& val, const std::string& path) {
+  std::string tape;
+  WriteTape(val, &tape);
+  FILE* file = std::fopen(path.c_str(), "wb");
+  if (!file) {
+    throw std::system_error(errno, std::generic_category(),
+                            "cannot open " + path);
+  }
+  const bool written = std::fwrite(tape.data(), 1, tape.size(), file) ==
+                       tape.size();
+  if (std::fclose(file) != 0 || !written) {
+    throw std::system_error(errno, std::generic_category(),
+                            "cannot write " + path);
+  }
+}
+
+Tape::Tape(const char* data, size_t size, bool verify_checksum) {
+  if (reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+    throw std::runtime_error("tape isn't aligned to 8 bytes");
+  }
+  TapeHeader header;
+  if (size < sizeof(header)) {
+    throw std::runtime_error("not a tape");
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kTapeMagic, sizeof(kTapeMagic)) != 0) {
+    throw std::runtime_error("not a tape");
+  }
+  if (header.byte_order != kTapeByteOrder) {
+    throw std::runtime_error("tape was written with another byte order");
+  }
+  if (header.version != kTapeVersion) {
+    throw std::runtime_error("unsupported tape version " +
+                             std::to_string(header.version));
+  }
+  const size_t body_size = size - sizeof(header);
+  if (header.num_nodes == 0 || header.strings_size % 8 != 0 ||
+      header.num_nodes > body_size / sizeof(TapeNode) ||
+      header.num_nodes * sizeof(TapeNode) + header.strings_size != body_size) {
+    throw std::runtime_error("tape is truncated or corrupt");
+  }
+  const char* body = data + sizeof(header);
+  if (verify_checksum && TapeChecksum(body, body_size) != header.checksum) {
+    throw std::runtime_error("tape checksum mismatch");
+  }
+  nodes_ = reinterpret_cast<const TapeNode*>(body);
+}
+}
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "json_value.h"
+#include "mapped_file.h"
+#include "string_ref.h"
+
+namespace jp {
+
+// A tape is a parsed JSON value, serialized such that it can be used straight
+// from the bytes it was loaded, or mapped, from, without parsing it again.
+//
+// It's laid out like JsonValues are, with offsets instead of pointers: a
+// header, then the nodes, then the chars of the strings. Each node is 16
+// bytes, and the root is the first one. The elements of an array are
+// consecutive nodes, and so are the members of an object, as key and value
+// pairs, so containers can be indexed in constant time. Containers and
+// strings refer to their contents by their distance from the node, so a node
+// is all it takes to read a value.
+//
+// Tapes are written in the byte order of the machine, and only load on
+// machines with the same. The checksum catches corrupted or truncated tapes,
+// but tapes have to be trusted, as nodes aren't checked when loaded.
+
+struct TapeHeader {
+  char magic[4];  // "JPTP"
+  uint32_t version;
+  uint32_t byte_order;  // kTapeByteOrder, as written by the writer
+  uint32_t reserved;
+  uint64_t num_nodes;
+  uint64_t strings_size;  // padded to a multiple of 8
+  uint64_t checksum;      // of everything after the header, see TapeChecksum
+};
+
+struct TapeNode {
+  // Numbers as their bits, bools, or for containers and strings how far
+  // their contents are from the node, in nodes and in bytes respectively
+  uint64_t payload;
+  uint32_t size;  // number of elements or members, or of chars
+  JsonValue::Type type;
+  uint8_t flags;  // kTapeInt64 or kTapeUint64, for integers
+  uint16_t reserved;
+};
+
+static_assert(sizeof(TapeHeader) == 40, "tape header layout");
+static_assert(sizeof(TapeNode) == 16, "tape node layout");
+
+const uint32_t kTapeVersion = 1;
+const uint32_t kTapeByteOrder = 0x01020304;
+const uint8_t kTapeInt64 = 1;
+const uint8_t kTapeUint64 = 2;
+
+// Checksum of size bytes at data, which has to be 8 byte aligned, and size a
+// multiple of 8
+uint64_t TapeChecksum(const char* data, size_t size);
+
+// Appends val to out as a tape. Keys are only stored once, however many
+// objects have them.
+void WriteTape(const JsonValue& val, std::string* out);
+
+// Writes val to the file at path as a tape. Throws std::system_error if the
+// file can't be written.
+void WriteTapeFile(const JsonValue& val, const std::string& path);
+
+class TapeObject;
+class TapeArray;
+
+// A read-only value of a tape, with the accessors of JsonValue. It's a
+// pointer to a node, so it's cheap to copy, and only valid as long as the
+// tape is.
+class TapeValue {
+ public:
+  explicit TapeValue(const TapeNode* node) : node_(node) {}
+
+  template <int Type>
+  inline bool is() const {
+    return node_->type == Type;
+  }
+
+  JsonValue::Type type() const { return node_->type; }
+
+  TapeObject getObject() const;
+  TapeArray getArray() const;
+
+  StringRef getString() const {
+    if (node_->type != JsonValue::STRING) {
+      throw std::runtime_error("not a string");
+    }
+    return StringRef{reinterpret_cast<const char*>(node_) + node_->payload,
+                     node_->size};
+  }
+
+  double getNumber() const { return ToJsonValue().getNumber(); }
+  bool isInt64() const { return ToJsonValue().isInt64(); }
+  bool isUint64() const { return ToJsonValue().isUint64(); }
+  int64_t getInt64() const { return ToJsonValue().getInt64(); }
+  uint64_t getUint64() const { return ToJsonValue().getUint64(); }
+
+  bool getBool() const {
+    if (node_->type != JsonValue::BOOL) {
+      throw std::runtime_error("not a bool");
+    }
+    return node_->payload != 0;
+  }
+
+  operator TapeObject() const;
+  operator TapeArray() const;
+  operator StringRef() const { return getString(); }
+  operator std::string() const { return getString().str(); }
+  operator double() const { return getNumber(); }
+  operator bool() const { return getBool(); }
+
+  // Reports the value to handler, with the methods of a JsonParser handler,
+  // e.g. to write it with a JsonWriter, or to copy it with a DomBuilder
+  template <typename Handler>
+  void Replay(Handler& handler) const;
+
+ private:
+  friend class TapeObject;
+  friend class TapeArray;
+
+  // Returns the scalar as a JsonValue, which is null for containers and
+  // strings, so it can be read like one
+  JsonValue ToJsonValue() const;
+
+  const TapeNode* node_;
+};
+
+// The members of an object of a tape, with the lookups of JsonObject. Keys
+// are searched linearly.
+class TapeObject {
+ public:
+  using value_type = std::pair<StringRef, TapeValue>;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = TapeObject::value_type;
+    using difference_type = ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    explicit const_iterator(const TapeNode* node) : node_(node) {}
+
+    value_type operator*() const {
+      return value_type{TapeValue{node_}.getString(), TapeValue{node_ + 1}};
+    }
+    const_iterator& operator++() {
+      node_ += 2;
+      return *this;
+    }
+    bool operator==(const_iterator other) const { return node_ == other.node_; }
+    bool operator!=(const_iterator other) const { return node_ != other.node_; }
+
+   private:
+    const TapeNode* node_;
+  };
+  using iterator = const_iterator;
+
+  TapeObject(const TapeNode* members, size_t size)
+      : members_(members), size_(size) {}
+
+  TapeValue at(StringRef key) const {
+    const const_iterator it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("no such key: " + key.str());
+    }
+    return (*it).second;
+  }
+
+  const_iterator find(StringRef key) const {
+    for (const TapeNode* node = members_; node != members_ + 2 * size_;
+         node += 2) {
+      if (TapeValue{node}.getString() == key) {
+        return const_iterator{node};
+      }
+    }
+    return end();
+  }
+
+  size_t count(StringRef key) const { return find(key) != end(); }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const_iterator begin() const { return const_iterator{members_}; }
+  const_iterator end() const { return const_iterator{members_ + 2 * size_}; }
+
+ private:
+  const TapeNode* members_;
+  size_t size_;
+};
+
+// The elements of an array of a tape
+class TapeArray {
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = TapeValue;
+    using difference_type = ptrdiff_t;
+    using pointer = void;
+    using reference = TapeValue;
+
+    explicit const_iterator(const TapeNode* node) : node_(node) {}
+
+    TapeValue operator*() const { return TapeValue{node_}; }
+    const_iterator& operator++() {
+      ++node_;
+      return *this;
+    }
+    bool operator==(const_iterator other) const { return node_ == other.node_; }
+    bool operator!=(const_iterator other) const { return node_ != other.node_; }
+
+   private:
+    const TapeNode* node_;
+  };
+  using iterator = const_iterator;
+
+  TapeArray(const TapeNode* elements, size_t size)
+      : elements_(elements), size_(size) {}
+
+  TapeValue operator[](size_t i) const { return TapeValue{elements_ + i}; }
+
+  TapeValue at(size_t i) const {
+    if (i >= size_) {
+      throw std::out_of_range("no such element: " + std::to_string(i));
+    }
+    return TapeValue{elements_ + i};
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const_iterator begin() const { return const_iterator{elements_}; }
+  const_iterator end() const { return const_iterator{elements_ + size_}; }
+
+ private:
+  const TapeNode* elements_;
+  size_t size_;
+};
+
+// A tape in memory, which has to be aligned to 8 bytes, and outlive it.
+// Throws std::runtime_error if it isn't a complete tape of this version, or
+// if its checksum doesn't match, unless verify_checksum is false. Checking it
+// reads the whole tape, which is the only work loading does.
+class Tape {
+ public:
+  Tape(const char* data, size_t size, bool verify_checksum = true);
+
+  TapeValue root() const { return TapeValue{nodes_}; }
+
+ private:
+  const TapeNode* nodes_;
+};
+
+// A tape file loaded by mapping it, so only the pages which are read, or
+// checksummed, are read from disk.
+class MappedTape {
+ public:
+  explicit MappedTape(const std::string& path, bool verify_checksum = true)
+      : file_(path), tape_(file_.begin(), file_.size(), verify_checksum) {}
+
+  TapeValue root() const { return tape_.root(); }
+  const MappedFile& file() const { return file_; }
+
+ private:
+  MappedFile file_;
+  Tape tape_;
+};
+
+inline TapeObject TapeValue::getObject() const {
+  if (node_->type != JsonValue::OBJECT) {
+    throw std::runtime_error("not an object");
+  }
+  return TapeObject{node_ + node_->payload, node_->size};
+}
+
+inline TapeArray TapeValue::getArray() const {
+  if (node_->type != JsonValue::ARRAY) {
+    throw std::runtime_error("not an array");
+  }
+  return TapeArray{node_ + node_->payload, node_->size};
+}
+
+inline TapeValue::operator TapeObject() const { return getObject(); }
+inline TapeValue::operator TapeArray() const { return getArray(); }
+
+inline JsonValue TapeValue::ToJsonValue() const {
+  switch (node_->type) {
+    case JsonValue::NUMBER:
+      if (node_->flags & kTapeInt64) {
+        return JsonValue{static_cast<int64_t>(node_->payload)};
+      }
+      if (node_->flags & kTapeUint64) {
+        return JsonValue{node_->payload};
+      }
+      double num;
+      std::memcpy(&num, &node_->payload, sizeof(num));
+      return JsonValue{num};
+    case JsonValue::BOOL:
+      return JsonValue{node_->payload != 0};
+    default:
+      return JsonValue{};
+  }
+}
+
+template <typename Handler>
+void TapeValue::Replay(Handler& handler) const {
+  switch (node_->type) {
+    case JsonValue::OBJECT: {
+      handler.StartObject();
+      const TapeObject obj = getObject();
+      for (const auto& member : obj) {
+        handler.Key(member.first, false);
+        member.second.Replay(handler);
+      }
+      handler.EndObject(obj.size());
+      break;
+    }
+    case JsonValue::ARRAY: {
+      handler.StartArray();
+      const TapeArray arr = getArray();
+      for (const TapeValue element : arr) {
+        element.Replay(handler);
+      }
+      handler.EndArray(arr.size());
+      break;
+    }
+    case JsonValue::STRING:
+      handler.String(getString(), false);
+      break;
+    case JsonValue::NUMBER:
+      if (node_->flags & kTapeInt64) {
+        handler.Int64(static_cast<int64_t>(node_->payload));
+      } else if (node_->flags & kTapeUint64) {
+        handler.Uint64(node_->payload);
+      } else {
+        handler.Number(getNumber());
+      }
+      break;
+    case JsonValue::BOOL:
+      handler.Bool(getBool());
+      break;
+    case JsonValue::NULL_VALUE:
+      handler.Null();
+      break;
+  }
+}
+}
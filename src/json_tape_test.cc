@@ -0,0 +1,130 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include <gtest/gtest.h>
+
+#include "dom_builder.h"
+#include "json_parser.h"
+#include "json_tape.h"
+#include "json_writer.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+const string kJson =
+    "{\"name\":\"a\\\"b\\n\",\"ints\":[0,-1,9223372036854775807,"
+    "18446744073709551615],\"doubles\":[0.5,-1e300,1e-300],\"t\":true,"
+    "\"f\":false,\"n\":null,\"empty\":{\"a\":[],\"o\":{}},"
+    "\"objects\":[{\"id\":1,\"tag\":\"x\"},{\"id\":2,\"tag\":\"y\"}]}";
+
+// The tape of json, in 8 byte aligned memory
+std::vector<uint64_t> MakeTape(const string& json) {
+  string tape;
+  WriteTape(JsonParser{json}.Parse(), &tape);
+  std::vector<uint64_t> words(tape.size() / 8);
+  std::memcpy(words.data(), tape.data(), tape.size());
+  return words;
+}
+
+Tape Load(const std::vector<uint64_t>& words) {
+  return Tape{reinterpret_cast<const char*>(words.data()), words.size() * 8};
+}
+
+string Replay(TapeValue val) {
+  string out;
+  JsonWriter writer{&out};
+  val.Replay(writer);
+  return out;
+}
+}
+
+TEST(JsonTape, RoundTrip) {
+  const auto words = MakeTape(kJson);
+  EXPECT_EQ(kJson, Replay(Load(words).root()));
+
+  for (const string json : {"1", "-2.5", "\"\"", "true", "null", "[]", "{}"}) {
+    EXPECT_EQ(json, Replay(Load(MakeTape(json)).root()));
+  }
+
+  // replaying into a DomBuilder copies the value
+  DomBuilder builder{nullptr, false};
+  Load(words).root().Replay(builder);
+  EXPECT_EQ(kJson, ToJson(builder.TakeRoot()));
+}
+
+TEST(JsonTape, Accessors) {
+  const auto words = MakeTape(kJson);
+  const Tape tape = Load(words);
+  const TapeObject root = tape.root().getObject();
+
+  EXPECT_EQ(8, root.size());
+  EXPECT_EQ("a\"b\n", root.at("name").getString());
+  EXPECT_EQ("name", (*root.begin()).first);
+  EXPECT_TRUE(root.at("t").getBool());
+  EXPECT_TRUE(root.at("n").is<JsonValue::NULL_VALUE>());
+  EXPECT_EQ(1, root.count("f"));
+  EXPECT_EQ(root.end(), root.find("missing"));
+  EXPECT_THROW(root.at("missing"), std::out_of_range);
+  EXPECT_THROW(root.at("name").getNumber(), std::runtime_error);
+
+  const TapeArray ints = root.at("ints").getArray();
+  ASSERT_EQ(4, ints.size());
+  EXPECT_EQ(-1, ints[1].getInt64());
+  EXPECT_EQ(INT64_MAX, ints[2].getInt64());
+  EXPECT_EQ(UINT64_MAX, ints[3].getUint64());
+  EXPECT_TRUE(ints[3].isUint64());
+  EXPECT_THROW(ints[3].getInt64(), std::out_of_range);
+  EXPECT_THROW(ints.at(4), std::out_of_range);
+  EXPECT_EQ(1e-300, root.at("doubles").getArray()[2].getNumber());
+  EXPECT_TRUE(root.at("empty").getObject().at("a").getArray().empty());
+
+  // keys are stored once
+  const TapeArray objects = root.at("objects").getArray();
+  EXPECT_EQ(2, objects[1].getObject().at("id").getInt64());
+  EXPECT_EQ((*objects[0].getObject().begin()).first.data(),
+            (*objects[1].getObject().begin()).first.data());
+}
+
+TEST(JsonTape, Invalid) {
+  auto words = MakeTape(kJson);
+  const char* data = reinterpret_cast<const char*>(words.data());
+  EXPECT_THROW(Tape(data, 0), std::runtime_error);
+  EXPECT_THROW(Tape(data, words.size() * 8 - 8), std::runtime_error);
+  EXPECT_THROW(Tape(data + 8, words.size() * 8 - 8), std::runtime_error);
+
+  // corrupt the last string
+  words.back() ^= 1;
+  EXPECT_THROW(Tape(data, words.size() * 8), std::runtime_error);
+  EXPECT_NO_THROW(Tape(data, words.size() * 8, false));
+  words.back() ^= 1;
+
+  TapeHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  ++header.version;
+  std::memcpy(words.data(), &header, sizeof(header));
+  EXPECT_THROW(Tape(data, words.size() * 8), std::runtime_error);
+}
+
+TEST(JsonTape, MappedTape) {
+  const string path = (boost::filesystem::temp_directory_path() /
+                       boost::filesystem::unique_path())
+                          .string();
+  WriteTapeFile(JsonParser{kJson}.Parse(), path);
+  {
+    MappedTape tape{path};
+    EXPECT_EQ(kJson, Replay(tape.root()));
+  }
+  boost::filesystem::remove(path);
+
+  EXPECT_THROW(MappedTape{path}, std::system_error);
+  EXPECT_THROW(WriteTapeFile(JsonValue{}, "/nonexistent/dir/tape"),
+               std::system_error);
+}
@@ -1,123 +1,590 @@
 #pragma once
 
 #include <assert.h>
+#include <algorithm>
 #include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <iostream>
 
+#include "arena.h"
+#include "helpers.h"
+#include "string_ref.h"
+
 namespace jp {
 
+class DomBuilder;
+class JsonObject;
+
+// A JsonValue is a tagged union: a one byte tag, plus an 8 byte payload which
+// either holds a scalar inline (number, bool), or points to a container
+// (object, array) or to the chars of a string. The whole node is 16 bytes, so
+// arrays of JsonValues are dense.
+//
+// The payload is either owned by the value, and lives on the heap, or it lives
+// in the Arena of a JsonDocument, in which case it's freed with the document.
 class JsonValue {
  public:
   enum Type : int8_t { OBJECT, ARRAY, STRING, NUMBER, BOOL, NULL_VALUE };
 
-  using ObjectType = std::unordered_map<std::string, JsonValue>;
-  using ArrayType = std::vector<JsonValue>;
-  using StringType = std::string;
+  using ObjectType = JsonObject;
+  using ArrayType = std::vector<JsonValue, ArenaAllocator<JsonValue>>;
+  using StringType = StringRef;
   using NumberType = double;
   using BoolType = bool;
 
-  explicit JsonValue(ObjectType obj) : type_(OBJECT), obj_(std::move(obj)) {}
-  explicit JsonValue(ArrayType arr) : type_(ARRAY), arr_(std::move(arr)) {}
-  explicit JsonValue(StringType str) : type_(STRING), str_(std::move(str)) {}
-  explicit JsonValue(NumberType num) : type_(NUMBER), num_(num) {}
-  explicit JsonValue(BoolType val) : type_(BOOL), bool_(val) {}
-  explicit JsonValue() : type_(NULL_VALUE) {}
+  explicit JsonValue(ObjectType obj);
+  explicit JsonValue(ArrayType arr)
+      : arr_(new ArrayType(std::move(arr))), type_(ARRAY), flags_(kOwned) {}
+  explicit JsonValue(StringType str) { InitString(str, nullptr); }
+  explicit JsonValue(NumberType num) : num_(num), type_(NUMBER) {}
+  explicit JsonValue(int64_t num) : int_(num), type_(NUMBER), flags_(kInt64) {}
+  explicit JsonValue(uint64_t num)
+      : uint_(num), type_(NUMBER), flags_(kUint64) {}
+  explicit JsonValue(BoolType val) : bool_(val), type_(BOOL) {}
+  explicit JsonValue() : obj_(nullptr), type_(NULL_VALUE) {}
+
+  // Copying makes a deep copy of the whole subtree on the heap
+  JsonValue(const JsonValue& other);
+
+  // Moving steals the payload, and leaves other as null
+  JsonValue(JsonValue&& other) noexcept { Steal(other); }
+
+  JsonValue& operator=(const JsonValue& other) {
+    if (this != &other) {
+      *this = JsonValue{other};
+    }
+    return *this;
+  }
+
+  JsonValue& operator=(JsonValue&& other) noexcept {
+    if (this != &other) {
+      Release();
+      Steal(other);
+    }
+    return *this;
+  }
+
+  ~JsonValue() { Release(); }
 
   template <int Type>
   inline bool is() const {
     return type_ == Type;
   }
 
+  Type type() const { return type_; }
+
   const ObjectType& getObject() const {
     if (type_ != OBJECT) {
-      throw std::runtime_error("not an object");
+      JP_THROW(std::runtime_error("not an object"));
     }
-    return obj_;
+    return *obj_;
   }
 
   const ArrayType& getArray() const {
     if (type_ != ARRAY) {
-      throw std::runtime_error("not an array");
+      JP_THROW(std::runtime_error("not an array"));
     }
-    return arr_;
+    return *arr_;
   }
 
-  const StringType& getString() const {
+  StringType getString() const {
     if (type_ != STRING) {
-      throw std::runtime_error("not a string");
+      JP_THROW(std::runtime_error("not a string"));
     }
-    return str_;
+    return StringType{str_, size_};
   }
 
+  // Numbers which were integers in the input, without a fraction or an
+  // exponent, are stored as such, so they don't lose precision. Every
+  // number can be read as a double, but integers only if they fit.
   NumberType getNumber() const {
-    if (type_ != NUMBER) {
-      throw std::runtime_error("not a number");
+    NumberType num;
+    if (!tryGet(&num)) {
+      JP_THROW(std::runtime_error("not a number"));
     }
-    return num_;
+    return num;
   }
 
+  bool isInt64() const { return type_ == NUMBER && (flags_ & kInt64); }
+  bool isUint64() const { return type_ == NUMBER && (flags_ & kUint64); }
+
+  int64_t getInt64() const;
+  uint64_t getUint64() const;
+
   BoolType getBool() const {
     if (type_ != BOOL) {
-      throw std::runtime_error("not a bool");
+      JP_THROW(std::runtime_error("not a bool"));
     }
     return bool_;
   }
 
+  // The getters which don't throw: if the value has the type of out, and
+  // fits into it, they store the value into out and return true, otherwise
+  // they return false, and leave out alone. Containers are returned as
+  // pointers, e.g.
+  //
+  //   const JsonValue::ObjectType* obj;
+  //   if (val.tryGet(&obj)) ...
+  bool tryGet(const ObjectType** out) const {
+    if (type_ != OBJECT) {
+      return false;
+    }
+    *out = obj_;
+    return true;
+  }
+  bool tryGet(const ArrayType** out) const {
+    if (type_ != ARRAY) {
+      return false;
+    }
+    *out = arr_;
+    return true;
+  }
+  bool tryGet(StringType* out) const {
+    if (type_ != STRING) {
+      return false;
+    }
+    *out = StringType{str_, size_};
+    return true;
+  }
+  bool tryGet(NumberType* out) const;
+  bool tryGet(int64_t* out) const;
+  bool tryGet(uint64_t* out) const;
+  bool tryGet(BoolType* out) const {
+    if (type_ != BOOL) {
+      return false;
+    }
+    *out = bool_;
+    return true;
+  }
+
   operator const ObjectType&() const { return getObject(); }
   operator const ArrayType&() const { return getArray(); }
-  operator const StringType&() const { return getString(); }
+  operator StringType() const { return getString(); }
+  operator std::string() const { return getString().str(); }
   operator NumberType() const { return getNumber(); }
   operator BoolType() const { return getBool(); }
 
   // Should only be used for debugging
-  std::string to_string() const {
-    std::string out;
-    switch (type_) {
-      case OBJECT:
-        out += "{";
-        for (const auto& e : obj_) {
-          out += e.first;
-          out += ": ";
-          out += e.second.to_string();
-          out += ",";
-        }
-        out += "}";
-        break;
-      case ARRAY:
-        out += "[";
-        for (const auto& e : arr_) {
-          out += e.to_string();
-          out += ",";
-        }
-        out += "]";
-        break;
-      case STRING:
-        out += "\"" + str_ + "\"";
-        break;
-      case NUMBER:
-        out += std::to_string(num_);
-        break;
-      case BOOL:
-        out += bool_ ? "true" : "false";
-        break;
-      case NULL_VALUE:
-        out += "null";
+  std::string to_string() const;
+
+ private:
+  friend class DomBuilder;
+
+  // Set if the payload was allocated on the heap, and has to be freed
+  static const uint8_t kOwned = 1;
+
+  // Set if a number is stored in int_ or uint_, rather than in num_
+  static const uint8_t kInt64 = 2;
+  static const uint8_t kUint64 = 4;
+
+  // Copies str, into arena if it's not null, or onto the heap otherwise
+  void InitString(StringType str, Arena* arena) {
+    if (str.size() > std::numeric_limits<uint32_t>::max()) {
+      JP_THROW(std::length_error("string is too long"));
+    }
+    type_ = STRING;
+    size_ = static_cast<uint32_t>(str.size());
+    if (arena) {
+      str_ = arena->CopyString(str.data(), str.size());
+      flags_ = 0;
+    } else {
+      char* copy = new char[str.size()];
+      std::memcpy(copy, str.data(), str.size());
+      str_ = copy;
+      flags_ = kOwned;
     }
-    return out;
   }
 
+  // Wraps containers that are not owned by the value, e.g. the ones allocated
+  // from an arena
+  static JsonValue Borrowed(ObjectType* obj) {
+    JsonValue val;
+    val.obj_ = obj;
+    val.type_ = OBJECT;
+    return val;
+  }
+
+  static JsonValue Borrowed(ArrayType* arr) {
+    JsonValue val;
+    val.arr_ = arr;
+    val.type_ = ARRAY;
+    return val;
+  }
+
+  // Refers to str without copying it, str has to outlive the value
+  static JsonValue Borrowed(StringType str) {
+    JsonValue val;
+    val.str_ = str.data();
+    val.size_ = static_cast<uint32_t>(str.size());
+    val.type_ = STRING;
+    return val;
+  }
+
+  static JsonValue String(StringType str, Arena* arena) {
+    JsonValue val;
+    val.InitString(str, arena);
+    return val;
+  }
+
+  void Steal(JsonValue& other) {
+    std::memcpy(static_cast<void*>(this), &other, sizeof(JsonValue));
+    other.type_ = NULL_VALUE;
+    other.flags_ = 0;
+  }
+
+  // Frees the payload, if it's owned by the value
+  void Release();
+
+  union {
+    ObjectType* obj_;
+    ArrayType* arr_;
+    const char* str_;
+    NumberType num_;
+    int64_t int_;
+    uint64_t uint_;
+    BoolType bool_;
+  };
+  uint32_t size_ = 0;  // length of str_
+  Type type_;
+  uint8_t flags_ = 0;
+};
+
+static_assert(sizeof(JsonValue) <= 16, "JsonValue should fit in 16 bytes");
+
+// A JsonObject maps the keys of a JSON object to its values. Members are
+// stored in a flat vector, in insertion order, so iterating over an object
+// visits its members in the order they had in the input.
+//
+// Small objects are searched linearly, which is faster than hashing their
+// keys. Objects with more than kIndexThreshold members also get a hash index,
+// an open addressing table of member positions, which is maintained as they
+// grow.
+//
+// Keys are copied with the allocator of the object, so they are in the same
+// arena as the values, or on the heap.
+class JsonObject {
+ public:
+  using value_type = std::pair<StringRef, JsonValue>;
+
  private:
-  const Type type_;
-
-  // TODO make this more efficient
-  ObjectType obj_;
-  ArrayType arr_;
-  StringType str_;
-  NumberType num_;
-  BoolType bool_;
+  using MemberVector = std::vector<value_type, ArenaAllocator<value_type>>;
+
+ public:
+  using allocator_type = ArenaAllocator<char>;
+  using const_iterator = MemberVector::const_iterator;
+  using iterator = const_iterator;
+
+  static const size_t kIndexThreshold = 8;
+
+  explicit JsonObject(allocator_type alloc = allocator_type())
+      : alloc_(alloc), members_(alloc), index_(alloc) {}
+
+  // Makes a deep copy of other on the heap
+  JsonObject(const JsonObject& other) : JsonObject() {
+    members_.reserve(other.size());
+    for (const auto& e : other) {
+      emplace(e.first, JsonValue{e.second});
+    }
+  }
+
+  JsonObject(JsonObject&& other) noexcept
+      : alloc_(other.alloc_),
+        members_(std::move(other.members_)),
+        index_(std::move(other.index_)) {}
+
+  JsonObject& operator=(const JsonObject& other) = delete;
+  JsonObject& operator=(JsonObject&& other) = delete;
+
+  ~JsonObject() {
+    for (const auto& e : members_) {
+      alloc_.deallocate(const_cast<char*>(e.first.data()), e.first.size());
+    }
+  }
+
+  // Inserts a copy of key, unless the object already contains it
+  std::pair<const_iterator, bool> emplace(StringRef key, JsonValue value) {
+    const size_t i = Find(key);
+    if (i != kNotFound) {
+      return {members_.begin() + i, false};
+    }
+    members_.emplace_back(CopyKey(key), std::move(value));
+    AddToIndex();
+    return {members_.end() - 1, true};
+  }
+
+  const JsonValue& at(StringRef key) const {
+    const size_t i = Find(key);
+    if (i == kNotFound) {
+      JP_THROW(std::out_of_range("no such key: " + key.str()));
+    }
+    return members_[i].second;
+  }
+
+  const_iterator find(StringRef key) const {
+    const size_t i = Find(key);
+    return i == kNotFound ? members_.end() : members_.begin() + i;
+  }
+
+  size_t count(StringRef key) const { return Find(key) != kNotFound; }
+  size_t size() const { return members_.size(); }
+  bool empty() const { return members_.empty(); }
+  void reserve(size_t n) { members_.reserve(n); }
+
+  const_iterator begin() const { return members_.begin(); }
+  const_iterator end() const { return members_.end(); }
+
+ private:
+  friend class DomBuilder;
+
+  static const size_t kNotFound = static_cast<size_t>(-1);
+
+  // Inserts key with a null value, and returns the slot of the value, or
+  // nullptr if the key is already present. The slot is valid until the next
+  // insertion. If copy_key is false, the object refers to key without copying
+  // it, which is only allowed in an arena.
+  JsonValue* Insert(StringRef key, bool copy_key = true) {
+    if (Find(key) != kNotFound) {
+      return nullptr;
+    }
+    assert(copy_key || alloc_.arena());
+    members_.emplace_back(copy_key ? CopyKey(key) : key, JsonValue());
+    AddToIndex();
+    return &members_.back().second;
+  }
+
+  // Returns the position of key, or kNotFound
+  size_t Find(StringRef key) const {
+    if (index_.empty()) {
+      for (size_t i = 0; i < members_.size(); ++i) {
+        if (members_[i].first == key) {
+          return i;
+        }
+      }
+      return kNotFound;
+    }
+    const size_t mask = index_.size() - 1;
+    for (size_t h = StringRefHash()(key) & mask;; h = (h + 1) & mask) {
+      const uint32_t slot = index_[h];
+      if (slot == 0) {
+        return kNotFound;
+      }
+      if (members_[slot - 1].first == key) {
+        return slot - 1;
+      }
+    }
+  }
+
+  // Adds the last member to the index, building or growing it if needed,
+  // such that it's at most half full
+  void AddToIndex() {
+    const size_t n = members_.size();
+    if (n <= kIndexThreshold) {
+      return;
+    }
+    if (index_.empty() || 2 * n > index_.size()) {
+      index_.assign(std::max<size_t>(64, 4 * index_.size()), 0);
+      for (size_t i = 0; i < n; ++i) {
+        IndexMember(i);
+      }
+    } else {
+      IndexMember(n - 1);
+    }
+  }
+
+  void IndexMember(size_t i) {
+    const size_t mask = index_.size() - 1;
+    size_t h = StringRefHash()(members_[i].first) & mask;
+    while (index_[h] != 0) {
+      h = (h + 1) & mask;
+    }
+    index_[h] = static_cast<uint32_t>(i + 1);
+  }
+
+  StringRef CopyKey(StringRef key) {
+    char* copy = alloc_.allocate(key.size());
+    std::memcpy(copy, key.data(), key.size());
+    return StringRef{copy, key.size()};
+  }
+
+  allocator_type alloc_;
+  MemberVector members_;
+
+  // Positions of the members plus one, 0 for empty slots, indexed by the hash
+  // of their keys. Empty for small objects.
+  std::vector<uint32_t, ArenaAllocator<uint32_t>> index_;
 };
+
+inline JsonValue::JsonValue(ObjectType obj)
+    : obj_(new ObjectType(std::move(obj))), type_(OBJECT), flags_(kOwned) {}
+
+inline JsonValue::JsonValue(const JsonValue& other)
+    : obj_(nullptr), type_(other.type_), flags_(0) {
+  switch (type_) {
+    case OBJECT:
+      obj_ = new ObjectType(*other.obj_);
+      flags_ = kOwned;
+      break;
+    case ARRAY:
+      arr_ = new ArrayType(*other.arr_);
+      flags_ = kOwned;
+      break;
+    case STRING:
+      InitString(other.getString(), nullptr);
+      break;
+    case NUMBER:
+      num_ = other.num_;
+      flags_ = other.flags_;
+      break;
+    case BOOL:
+      bool_ = other.bool_;
+      break;
+    case NULL_VALUE:
+      break;
+  }
+}
+
+inline bool JsonValue::tryGet(NumberType* out) const {
+  if (type_ != NUMBER) {
+    return false;
+  }
+  if (flags_ & kInt64) {
+    *out = static_cast<NumberType>(int_);
+  } else if (flags_ & kUint64) {
+    *out = static_cast<NumberType>(uint_);
+  } else {
+    *out = num_;
+  }
+  return true;
+}
+
+inline bool JsonValue::tryGet(int64_t* out) const {
+  if (type_ != NUMBER || (flags_ & kUint64)) {
+    return false;
+  }
+  if (flags_ & kInt64) {
+    *out = int_;
+    return true;
+  }
+  // 2^63 is an exact double, so the range check is exact too
+  const NumberType kTwoToThe63 = 9223372036854775808.0;
+  if (num_ != std::trunc(num_) || num_ < -kTwoToThe63 ||
+      num_ >= kTwoToThe63) {
+    return false;
+  }
+  *out = static_cast<int64_t>(num_);
+  return true;
+}
+
+inline bool JsonValue::tryGet(uint64_t* out) const {
+  if (type_ != NUMBER) {
+    return false;
+  }
+  if (flags_ & kUint64) {
+    *out = uint_;
+    return true;
+  }
+  if (flags_ & kInt64) {
+    if (int_ < 0) {
+      return false;
+    }
+    *out = static_cast<uint64_t>(int_);
+    return true;
+  }
+  const NumberType kTwoToThe64 = 18446744073709551616.0;
+  if (num_ != std::trunc(num_) || num_ < 0 || num_ >= kTwoToThe64) {
+    return false;
+  }
+  *out = static_cast<uint64_t>(num_);
+  return true;
+}
+
+inline int64_t JsonValue::getInt64() const {
+  int64_t num;
+  if (!tryGet(&num)) {
+    if (type_ != NUMBER) {
+      JP_THROW(std::runtime_error("not a number"));
+    }
+    JP_THROW(std::out_of_range("number doesn't fit into an int64"));
+  }
+  return num;
+}
+
+inline uint64_t JsonValue::getUint64() const {
+  uint64_t num;
+  if (!tryGet(&num)) {
+    if (type_ != NUMBER) {
+      JP_THROW(std::runtime_error("not a number"));
+    }
+    JP_THROW(std::out_of_range("number doesn't fit into a uint64"));
+  }
+  return num;
+}
+
+inline void JsonValue::Release() {
+  if (!(flags_ & kOwned)) {
+    return;
+  }
+  switch (type_) {
+    case OBJECT:
+      delete obj_;
+      break;
+    case ARRAY:
+      delete arr_;
+      break;
+    case STRING:
+      delete[] str_;
+      break;
+    default:
+      break;
+  }
+}
+
+inline std::string JsonValue::to_string() const {
+  std::string out;
+  switch (type_) {
+    case OBJECT:
+      out += "{";
+      for (const auto& e : *obj_) {
+        out.append(e.first.data(), e.first.size());
+        out += ": ";
+        out += e.second.to_string();
+        out += ",";
+      }
+      out += "}";
+      break;
+    case ARRAY:
+      out += "[";
+      for (const auto& e : *arr_) {
+        out += e.to_string();
+        out += ",";
+      }
+      out += "]";
+      break;
+    case STRING:
+      out += "\"" + getString().str() + "\"";
+      break;
+    case NUMBER:
+      if (flags_ & kInt64) {
+        out += std::to_string(int_);
+      } else if (flags_ & kUint64) {
+        out += std::to_string(uint_);
+      } else {
+        out += std::to_string(num_);
+      }
+      break;
+    case BOOL:
+      out += bool_ ? "true" : "false";
+      break;
+    case NULL_VALUE:
+      out += "null";
+  }
+  return out;
+}
 }
@@ -0,0 +1,263 @@
+#include "json_writer.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <system_error>
+
+#include "number_writer.h"
+
+namespace jp {
+
+namespace {
+
+// Escape sequences of the chars which need one, 0 for the others. Control
+// chars without a short sequence are written as \u00XX.
+struct EscapeTable {
+  EscapeTable() {
+    for (int c = 0; c < 0x20; ++c) {
+      values[c] = 'u';
+    }
+    values[static_cast<uint8_t>('"')] = '"';
+    values[static_cast<uint8_t>('\\')] = '\\';
+    values[static_cast<uint8_t>('\b')] = 'b';
+    values[static_cast<uint8_t>('\f')] = 'f';
+    values[static_cast<uint8_t>('\n')] = 'n';
+    values[static_cast<uint8_t>('\r')] = 'r';
+    values[static_cast<uint8_t>('\t')] = 't';
+  }
+  char operator[](char c) const { return values[static_cast<uint8_t>(c)]; }
+
+  char values[256] = {};
+};
+
+const EscapeTable kEscapes;
+}
+
+JsonWriter::JsonWriter(std::string* out, Options options)
+    : options_(options), out_(out) {}
+
+JsonWriter::JsonWriter(FILE* file, Options options)
+    : options_(options), out_(&buffer_), file_(file) {
+  buffer_.reserve(kBufferSize + 1024);
+}
+
+JsonWriter::JsonWriter(int fd, Options options)
+    : options_(options), out_(&buffer_), fd_(fd) {
+  buffer_.reserve(kBufferSize + 1024);
+}
+
+JsonWriter::~JsonWriter() {
+  try {
+    Flush();
+  } catch (const std::system_error&) {
+  }
+}
+
+void JsonWriter::Flush() {
+  if (out_ != &buffer_ || buffer_.empty()) {
+    return;
+  }
+  const char* p = buffer_.data();
+  size_t left = buffer_.size();
+  buffer_.clear();
+  if (file_) {
+    if (std::fwrite(p, 1, left, file_) != left) {
+      throw std::system_error(errno, std::generic_category(), "fwrite");
+    }
+    return;
+  }
+  while (left) {
+    const ssize_t written = write(fd_, p, left);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "write");
+    }
+    p += written;
+    left -= written;
+  }
+}
+
+void JsonWriter::Write(const JsonValue& val) {
+  switch (val.type()) {
+    case JsonValue::OBJECT:
+      StartObject();
+      for (const auto& member : val.getObject()) {
+        Key(member.first);
+        Write(member.second);
+      }
+      EndObject();
+      break;
+    case JsonValue::ARRAY:
+      StartArray();
+      for (const auto& element : val.getArray()) {
+        Write(element);
+      }
+      EndArray();
+      break;
+    case JsonValue::STRING:
+      String(val.getString());
+      break;
+    case JsonValue::NUMBER:
+      if (val.isInt64()) {
+        Int64(val.getInt64());
+      } else if (val.isUint64()) {
+        Uint64(val.getUint64());
+      } else {
+        Number(val.getNumber());
+      }
+      break;
+    case JsonValue::BOOL:
+      Bool(val.getBool());
+      break;
+    case JsonValue::NULL_VALUE:
+      Null();
+      break;
+  }
+}
+
+void JsonWriter::BeforeValue() {
+  if (after_key_) {
+    after_key_ = false;
+    return;
+  }
+  if (counts_.empty()) {
+    return;
+  }
+  if (counts_.back()++ > 0) {
+    Put(',');
+  }
+  if (options_.pretty) {
+    NewLine();
+  }
+}
+
+void JsonWriter::NewLine() {
+  Put('\n');
+  out_->append(counts_.size() * options_.indent, ' ');
+}
+
+void JsonWriter::StartObject() {
+  BeforeValue();
+  Put('{');
+  counts_.push_back(0);
+}
+
+void JsonWriter::Key(StringRef key, bool) {
+  BeforeValue();
+  WriteString(key);
+  if (options_.pretty) {
+    Put(": ", 2);
+  } else {
+    Put(':');
+  }
+  after_key_ = true;
+}
+
+void JsonWriter::EndObject(size_t) {
+  const bool empty = counts_.back() == 0;
+  counts_.pop_back();
+  if (options_.pretty && !empty) {
+    NewLine();
+  }
+  Put('}');
+  MaybeFlush();
+}
+
+void JsonWriter::StartArray() {
+  BeforeValue();
+  Put('[');
+  counts_.push_back(0);
+}
+
+void JsonWriter::EndArray(size_t) {
+  const bool empty = counts_.back() == 0;
+  counts_.pop_back();
+  if (options_.pretty && !empty) {
+    NewLine();
+  }
+  Put(']');
+  MaybeFlush();
+}
+
+void JsonWriter::String(StringRef str, bool) {
+  BeforeValue();
+  WriteString(str);
+  MaybeFlush();
+}
+
+// Copies the runs of chars which don't need escaping at once
+void JsonWriter::WriteString(StringRef str) {
+  Put('"');
+  const char* run = str.begin();
+  for (const char* p = str.begin(); p != str.end(); ++p) {
+    const char escape = kEscapes[*p];
+    if (!escape) {
+      continue;
+    }
+    Put(run, p - run);
+    run = p + 1;
+    if (escape == 'u') {
+      static const char kHex[] = "0123456789abcdef";
+      const char seq[] = {'\\', 'u', '0', '0', kHex[(*p >> 4) & 0xF],
+                          kHex[*p & 0xF]};
+      Put(seq, sizeof(seq));
+    } else {
+      const char seq[] = {'\\', escape};
+      Put(seq, sizeof(seq));
+    }
+  }
+  Put(run, str.end() - run);
+  Put('"');
+}
+
+void JsonWriter::Int64(int64_t num) {
+  BeforeValue();
+  char buffer[kMaxNumberLength];
+  Put(buffer, WriteInt64(num, buffer) - buffer);
+  MaybeFlush();
+}
+
+void JsonWriter::Uint64(uint64_t num) {
+  BeforeValue();
+  char buffer[kMaxNumberLength];
+  Put(buffer, WriteUint64(num, buffer) - buffer);
+  MaybeFlush();
+}
+
+void JsonWriter::Number(double num) {
+  if (!std::isfinite(num)) {
+    Null();
+    return;
+  }
+  BeforeValue();
+  char buffer[kMaxNumberLength];
+  Put(buffer, WriteDouble(num, buffer) - buffer);
+  MaybeFlush();
+}
+
+void JsonWriter::Bool(bool val) {
+  BeforeValue();
+  if (val) {
+    Put("true", 4);
+  } else {
+    Put("false", 5);
+  }
+  MaybeFlush();
+}
+
+void JsonWriter::Null() {
+  BeforeValue();
+  Put("null", 4);
+  MaybeFlush();
+}
+
+std::string ToJson(const JsonValue& val, JsonWriter::Options options) {
+  std::string out;
+  JsonWriter{&out, options}.Write(val);
+  return out;
+}
+}
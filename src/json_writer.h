@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "json_value.h"
+#include "string_ref.h"
+
+namespace jp {
+
+// Serializes JSON values to a string, a FILE or a file descriptor, compact or
+// pretty printed. Strings are escaped, and doubles are written in their
+// shortest form, which is parsed back to the same double.
+//
+// Output goes straight to the string, which can be reused between writers to
+// keep its capacity, or through a buffer to files.
+//
+// JsonWriter is also a JsonParser handler, so parsing into a writer
+// reformats the input without building a JsonValue:
+//
+//   std::string out;
+//   JsonWriter writer{&out};
+//   JsonParser{json}.Parse(writer);
+class JsonWriter {
+ public:
+  struct Options {
+    // Puts every value on its own line, indented by the given number of
+    // spaces per level
+    bool pretty = false;
+    size_t indent = 2;
+  };
+
+  // Appends to out
+  JsonWriter(std::string* out, Options options);
+  explicit JsonWriter(std::string* out) : JsonWriter(out, Options()) {}
+
+  // Writes to file, or to fd, through a buffer. Throws std::system_error
+  // when writing fails.
+  JsonWriter(FILE* file, Options options);
+  explicit JsonWriter(FILE* file) : JsonWriter(file, Options()) {}
+  JsonWriter(int fd, Options options);
+  explicit JsonWriter(int fd) : JsonWriter(fd, Options()) {}
+
+  // Flushes the buffer, without throwing
+  ~JsonWriter();
+
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  void Write(const JsonValue& val);
+
+  // Handler methods, see JsonParser::Parse(handler). Non-finite doubles are
+  // written as null, as JSON has no representation for them.
+  void StartObject();
+  void Key(StringRef key, bool copy = true);
+  void EndObject(size_t num_members = 0);
+  void StartArray();
+  void EndArray(size_t num_elements = 0);
+  void String(StringRef str, bool copy = true);
+  void Int64(int64_t num);
+  void Uint64(uint64_t num);
+  void Number(double num);
+  void Bool(bool val);
+  void Null();
+
+  // Writes out the buffer of a file or a file descriptor
+  void Flush();
+
+ private:
+  // Called before every value, writes the separator from the previous one
+  void BeforeValue();
+  void NewLine();
+  void WriteString(StringRef str);
+
+  void Put(char c) { out_->push_back(c); }
+  void Put(const char* data, size_t size) { out_->append(data, size); }
+
+  // Flushes the buffer of a file, once it's full
+  void MaybeFlush() {
+    if (out_ == &buffer_ && buffer_.size() >= kBufferSize) {
+      Flush();
+    }
+  }
+
+  static const size_t kBufferSize = 64 * 1024;
+
+  const Options options_;
+  std::string* const out_;
+  std::string buffer_;
+  FILE* const file_ = nullptr;
+  const int fd_ = -1;
+
+  // Number of values written in each open container, and whether the next
+  // value follows a key
+  std::vector<size_t> counts_;
+  bool after_key_ = false;
+};
+
+// Returns val as JSON
+std::string ToJson(const JsonValue& val,
+                   JsonWriter::Options options = JsonWriter::Options());
+}
@@ -0,0 +1,148 @@
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "json_parser.h"
+#include "json_writer.h"
+#include "number_writer.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+string Reformat(const string& json, JsonWriter::Options options) {
+  string out;
+  JsonWriter writer{&out, options};
+  JsonParser{json}.Parse(writer);
+  return out;
+}
+
+string Minify(const string& json) {
+  return Reformat(json, JsonWriter::Options());
+}
+
+string WriteDouble(double d) {
+  char buffer[kMaxNumberLength];
+  return string(buffer, jp::WriteDouble(d, buffer));
+}
+}
+
+TEST(JsonWriter, Compact) {
+  EXPECT_EQ("[1,-2,3.5,\"a\",true,false,null,[],{},[[{}]]]",
+            Minify(" [ 1 , -2, 3.5, \"a\", true, false, null, [ ], { }, "
+                   "[[{}]]] "));
+  EXPECT_EQ("{\"a\":{\"b\":[1,{\"c\":null}]}}",
+            Minify("{\"a\": {\"b\": [1, {\"c\": null}]}}"));
+  EXPECT_EQ("\"str\"", Minify("\"str\""));
+  EXPECT_EQ("18446744073709551615", Minify("18446744073709551615"));
+  EXPECT_EQ("-9223372036854775808", Minify("-9223372036854775808"));
+}
+
+TEST(JsonWriter, Pretty) {
+  JsonWriter::Options options;
+  options.pretty = true;
+  EXPECT_EQ(
+      "{\n"
+      "  \"a\": [\n"
+      "    1,\n"
+      "    {\n"
+      "      \"b\": []\n"
+      "    },\n"
+      "    {}\n"
+      "  ]\n"
+      "}",
+      Reformat("{\"a\": [1, {\"b\": []}, {}]}", options));
+
+  options.indent = 1;
+  EXPECT_EQ("[\n 1,\n 2\n]", Reformat("[1,2]", options));
+}
+
+TEST(JsonWriter, Escaping) {
+  const JsonValue str{StringRef{"a\"b\\c\nd\te\x01\x1f\b\f\r/\xc3\xa9"}};
+  EXPECT_EQ("\"a\\\"b\\\\c\\nd\\te\\u0001\\u001f\\b\\f\\r/\xc3\xa9\"",
+            ToJson(str));
+  EXPECT_EQ("{\"k\\\"\\n\":1}", Minify("{\"k\\\"\\n\": 1}"));
+}
+
+TEST(JsonWriter, Doubles) {
+  EXPECT_EQ("0.1", WriteDouble(0.1));
+  EXPECT_EQ("0.3", WriteDouble(0.3));
+  EXPECT_EQ("0.30000000000000004", WriteDouble(0.1 + 0.2));
+  EXPECT_EQ("1.0", WriteDouble(1));
+  EXPECT_EQ("-0.0", WriteDouble(-0.0));
+  EXPECT_EQ("123456.789", WriteDouble(123456.789));
+  EXPECT_EQ("1e21", WriteDouble(1e21));
+  EXPECT_EQ("100000000000000000000.0", WriteDouble(1e20));
+  EXPECT_EQ("1e-7", WriteDouble(1e-7));
+  EXPECT_EQ("0.000001", WriteDouble(1e-6));
+  EXPECT_EQ("1.7976931348623157e308",
+            WriteDouble(std::numeric_limits<double>::max()));
+  EXPECT_EQ("5e-324", WriteDouble(std::numeric_limits<double>::denorm_min()));
+
+  // doubles stay doubles, even if they are whole
+  EXPECT_EQ("[1.0,1e100]", Minify("[1.0, 1e100]"));
+  EXPECT_EQ("[null,null]",
+            ToJson(JsonValue{JsonValue::ArrayType{
+                JsonValue{std::nan("")},
+                JsonValue{std::numeric_limits<double>::infinity()}}}));
+}
+
+TEST(JsonWriter, MemberOrder) {
+  const string json = "{\"z\":1,\"y\":{\"b\":2,\"a\":3},\"x\":[]}";
+  EXPECT_EQ(json, Minify(json));
+  EXPECT_EQ(json, ToJson(JsonParser{json}.Parse()));
+}
+
+TEST(JsonWriter, DoublesRoundTrip) {
+  std::mt19937_64 rng{42};
+  for (int i = 0; i < 100000; ++i) {
+    const uint64_t bits = rng();
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    if (!std::isfinite(d)) {
+      continue;
+    }
+    const string str = WriteDouble(d);
+    EXPECT_EQ(d, std::strtod(str.c_str(), nullptr)) << str;
+    EXPECT_EQ(d, JsonParser{str}.Parse().getNumber()) << str;
+  }
+}
+
+TEST(JsonWriter, Sinks) {
+  const string json = "{\"a\":[1,2.5,\"x\"]}";
+  const JsonValue val = JsonParser{json}.Parse();
+
+  FILE* file = std::tmpfile();
+  ASSERT_TRUE(file);
+  {
+    JsonWriter writer{file};
+    for (int i = 0; i < 10000; ++i) {
+      writer.Write(val);
+    }
+  }
+  EXPECT_EQ(10000 * json.size(), std::ftell(file));
+
+  {
+    JsonWriter writer{fileno(file)};
+    writer.Write(val);
+    writer.Flush();
+  }
+  std::fflush(file);
+  EXPECT_EQ(10001 * json.size(), lseek(fileno(file), 0, SEEK_END));
+  std::fclose(file);
+
+  // the string is appended to
+  string out = "x";
+  JsonWriter{&out}.Write(val);
+  EXPECT_EQ("x" + json, out);
+}
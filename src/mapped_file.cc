@@ -0,0 +1,72 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+
+#include "helpers.h"
+
+namespace jp {
+
+namespace {
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+  JP_THROW(std::system_error(errno, std::generic_category(), what));
+}
+
+// Closes a file descriptor when it goes out of scope
+class FileDescriptor {
+ public:
+  explicit FileDescriptor(int fd) : fd_(fd) {}
+  ~FileDescriptor() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  int get() const { return fd_; }
+
+ private:
+  const int fd_;
+};
+}
+
+MappedFile::MappedFile(const std::string& path) {
+  FileDescriptor fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+  if (fd.get() < 0) {
+    ThrowSystemError("cannot open " + path);
+  }
+  struct stat st;
+  if (fstat(fd.get(), &st) != 0) {
+    ThrowSystemError("cannot stat " + path);
+  }
+  size_ = st.st_size;
+  if (size_ == 0) {
+    // empty mappings aren't allowed
+    data_ = "";
+    return;
+  }
+
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+  if (data == MAP_FAILED) {
+    ThrowSystemError("cannot map " + path);
+  }
+  data_ = static_cast<const char*>(data);
+
+  // these are only hints, so failures are ignored
+  madvise(data, size_, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  madvise(data, size_, MADV_HUGEPAGE);
+#endif
+}
+
+MappedFile::~MappedFile() {
+  if (size_ != 0) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "json_document.h"
+#include "json_value.h"
+
+namespace jp {
+
+// A read-only memory mapping of a whole file, so that it can be parsed
+// without reading it into a buffer first. Pages are read by the kernel as
+// they're first touched, and the mapping is advised to be read sequentially,
+// and to use huge pages where possible.
+//
+// Throws std::system_error if the file can't be opened or mapped.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // The content of the file. There's nothing readable past end(), it may be
+  // the end of the mapping.
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// A JSON file parsed straight from its mapping, with strings without escaped
+// chars pointing into the mapping, like JsonDocument::ParseZeroCopy. The
+// mapping lives as long as the parsed value.
+class MappedJson {
+ public:
+  explicit MappedJson(const std::string& path) : file_(path) {
+    doc_.ParseZeroCopy(file_.begin(), file_.end());
+  }
+
+  const JsonValue& root() const { return doc_.root(); }
+  const MappedFile& file() const { return file_; }
+
+ private:
+  MappedFile file_;
+  JsonDocument doc_;
+};
+}
@@ -0,0 +1,71 @@
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <boost/filesystem.hpp>
+
+#include <gtest/gtest.h>
+
+#include "json_parser.h"
+#include "mapped_file.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+// A file with the given content, which is removed at the end of the scope
+class TempFile {
+ public:
+  explicit TempFile(const string& content)
+      : path_((boost::filesystem::temp_directory_path() /
+               boost::filesystem::unique_path())
+                  .string()) {
+    std::ofstream{path_, std::ios::binary} << content;
+  }
+  ~TempFile() { boost::filesystem::remove(path_); }
+
+  const string& path() const { return path_; }
+
+ private:
+  const string path_;
+};
+}
+
+TEST(MappedFile, ParseFile) {
+  TempFile file{"{\"a\": [1, 2.5, \"b\\n\"], \"c\": null}"};
+  const JsonValue val = JsonParser::ParseFile(file.path());
+  EXPECT_EQ(2.5, val.getObject().at("a").getArray()[1].getNumber());
+  EXPECT_EQ("b\n", val.getObject().at("a").getArray()[2].getString());
+}
+
+TEST(MappedFile, ZeroCopy) {
+  TempFile file{"{\"name\": \"Carl\", \"escaped\": \"a\\tb\"}"};
+  MappedJson json{file.path()};
+  const StringRef name = json.root().getObject().at("name").getString();
+  EXPECT_EQ("Carl", name);
+  EXPECT_GE(name.data(), json.file().begin());
+  EXPECT_LT(name.data(), json.file().end());
+  EXPECT_EQ("a\tb", json.root().getObject().at("escaped").getString());
+}
+
+// The value ends right at the end of the mapping, which ends at a page
+// boundary, so reading past it would crash
+TEST(MappedFile, EndOfMapping) {
+  for (const string last : {"1", "1.25", "true", "null", "\"s\"", "[1]"}) {
+    TempFile file{string(4096 - last.size(), ' ') + last};
+    const JsonValue val = JsonParser::ParseFile(file.path());
+    EXPECT_EQ(JsonParser{last}.Parse().type(), val.type());
+  }
+  TempFile number{string(4095, ' ') + "7"};
+  EXPECT_EQ(7, JsonParser::ParseFile(number.path()).getNumber());
+}
+
+TEST(MappedFile, Errors) {
+  EXPECT_THROW(JsonParser::ParseFile("does/not/exist.json"),
+               std::system_error);
+
+  TempFile empty{""};
+  EXPECT_EQ(0, MappedFile{empty.path()}.size());
+  EXPECT_THROW(JsonParser::ParseFile(empty.path()), std::runtime_error);
+}
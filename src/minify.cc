@@ -0,0 +1,107 @@
+#include "minify.h"
+
+#include <cstring>
+
+#include "helpers.h"
+#include "json_parser.h"
+#include "structural_index.h"
+
+namespace jp {
+
+namespace {
+
+// A handler which ignores every value, so parsing only validates the input
+struct NullHandler {
+  void StartObject() {}
+  void Key(StringRef, bool) {}
+  void EndObject(size_t) {}
+  void StartArray() {}
+  void EndArray(size_t) {}
+  void String(StringRef, bool) {}
+  void Int64(int64_t) {}
+  void Uint64(uint64_t) {}
+  void Number(double) {}
+  void Bool(bool) {}
+  void Null() {}
+};
+
+// Each token of the input spans from its offset in the index up to the next
+// one, and may be followed by whitespace, which is the only whitespace
+// outside of strings. Runs of tokens without whitespace between them are
+// copied at once.
+char* MinifyIndexed(const char* p, const char* end,
+                    const StructuralIndex& index, char* out) {
+  const char* run = p + index[0];
+  for (size_t i = 0; i < index.size(); ++i) {
+    const char* next = i + 1 < index.size() ? p + index[i + 1] : end;
+    if (!IsSpace(next[-1])) {
+      continue;
+    }
+    // tokens don't end with whitespace, not even strings, which end with
+    // their closing quote
+    const char* token_end = next - 1;
+    while (IsSpace(token_end[-1])) {
+      --token_end;
+    }
+    std::memmove(out, run, token_end - run);
+    out += token_end - run;
+    run = next;
+  }
+  std::memmove(out, run, end - run);
+  return out + (end - run);
+}
+
+// For inputs which are too large to be indexed
+char* MinifyChars(const char* p, const char* end, char* out) {
+  bool in_string = false;
+  bool escaped = false;
+  for (; p != end; ++p) {
+    const char c = *p;
+    if (in_string) {
+      in_string = escaped || c != '"';
+      escaped = !escaped && c == '\\';
+    } else if (IsSpace(c)) {
+      continue;
+    } else {
+      in_string = c == '"';
+    }
+    *out++ = c;
+  }
+  return out;
+}
+}
+
+ParseError TryMinify(const char* p, const char* end, char* out, size_t* size) {
+  JsonParser parser{p, end};
+  NullHandler handler;
+  if (parser.TryParse(handler)) {
+    return parser.error();
+  }
+  // a valid input has a token, so the index isn't empty
+  char* const out_end = parser.indexed_
+                            ? MinifyIndexed(p, end, parser.index_, out)
+                            : MinifyChars(p, end, out);
+  *size = out_end - out;
+  return ParseError();
+}
+
+std::string Minify(const std::string& json) {
+  std::string out(json.size(), '\0');
+  size_t size;
+  if (const ParseError error =
+          TryMinify(json.data(), json.data() + json.size(), &out[0], &size)) {
+    JP_THROW(ParseException(error, json));
+  }
+  out.resize(size);
+  return out;
+}
+
+void MinifyInsitu(std::string* json) {
+  char* const p = &(*json)[0];
+  size_t size;
+  if (const ParseError error = TryMinify(p, p + json->size(), p, &size)) {
+    JP_THROW(ParseException(error, *json));
+  }
+  json->resize(size);
+}
+}
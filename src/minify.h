@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "parse_error.h"
+
+namespace jp {
+
+// Minifying removes the whitespace between the tokens of a JSON input, and
+// keeps everything else as it is: whitespace inside strings, escapes, and
+// the digits of numbers. The input is validated first, like JsonParser::Parse
+// does, without building a JsonValue.
+//
+// Tokens are found with the structural index of the parser, so whitespace is
+// skipped a block at a time, and the runs of chars between whitespace are
+// copied with memmove, which makes the copy run at memory speed.
+
+// Writes the minified input to out, which has to have room for end - p chars,
+// and returns the error if the input is invalid, in which case out isn't
+// written to. Otherwise *size is the size of the minified input. out may be
+// p, to minify in place.
+ParseError TryMinify(const char* p, const char* end, char* out, size_t* size);
+
+// Returns the minified json, or throws a ParseException if it's invalid
+std::string Minify(const std::string& json);
+
+// Minifies json in place, or throws a ParseException if it's invalid, in
+// which case json isn't modified
+void MinifyInsitu(std::string* json);
+}
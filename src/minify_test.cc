@@ -0,0 +1,116 @@
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "json_parser.h"
+#include "json_writer.h"
+#include "minify.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+string MinifyInPlace(string json) {
+  MinifyInsitu(&json);
+  return json;
+}
+}
+
+TEST(Minify, Whitespace) {
+  for (const auto& test : std::vector<std::pair<string, string>>{
+           {"{}", "{}"},
+           {" \n\t\r[ ] ", "[]"},
+           {"1", "1"},
+           {"  -1.5e3\n", "-1.5e3"},
+           {"\"a b\"", "\"a b\""},
+           {"{ \"a\" : [ 1 , true , null ] ,\n  \"b\" : { } }",
+            "{\"a\":[1,true,null],\"b\":{}}"},
+           {"[ \" \\\" \" , \"\\\\\" , \" , \" ]",
+            "[\" \\\" \",\"\\\\\",\" , \"]"},
+           {"[\"\\u00e9\\n\", 1e-7, 100000000000000000000]",
+            "[\"\\u00e9\\n\",1e-7,100000000000000000000]"},
+           {"[\"\xc3\xa9 \"]", "[\"\xc3\xa9 \"]"},
+       }) {
+    EXPECT_EQ(test.second, Minify(test.first)) << test.first;
+    EXPECT_EQ(test.second, MinifyInPlace(test.first)) << test.first;
+  }
+}
+
+TEST(Minify, Invalid) {
+  for (const string json :
+       {"", "  ", "[1,]", "{\"a\" 1}", "[1] 2", "\"a", "[\"\xff\"]", "tru"}) {
+    string out(json.size() + 1, 'x');
+    size_t size = 0;
+    const ParseError error =
+        TryMinify(json.data(), json.data() + json.size(), &out[0], &size);
+    ASSERT_TRUE(error) << json;
+    JsonValue val;
+    const ParseError parse_error = JsonParser{json}.TryParse(&val);
+    EXPECT_EQ(parse_error.code, error.code) << json;
+    EXPECT_EQ(parse_error.offset, error.offset) << json;
+    // nothing is written
+    EXPECT_EQ(string(json.size() + 1, 'x'), out);
+
+    string insitu = json;
+    EXPECT_THROW(MinifyInsitu(&insitu), ParseException) << json;
+    EXPECT_EQ(json, insitu);
+    EXPECT_THROW(Minify(json), ParseException) << json;
+  }
+}
+
+TEST(Minify, MatchesWriter) {
+  // without doubles, which are written in their shortest form, minifying is
+  // the same as parsing and writing the value
+  std::mt19937 gen(7);
+  const char* spaces[] = {"", " ", "\n  ", "\t", "\r\n"};
+  const char* scalars[] = {"1",       "-20",          "true", "null",
+                           "\"a b\"", "\"\\\"\\n\"", "\"\""};
+  for (int i = 0; i < 500; ++i) {
+    // a random value, with random whitespace between its tokens
+    string json;
+    auto space = [&]() { json += spaces[gen() % 5]; };
+    std::function<void(int)> value = [&](int level) {
+      space();
+      if (level > 3 || gen() % 3 == 0) {
+        json += scalars[gen() % 7];
+      } else if (gen() % 2) {
+        json += '[';
+        for (int n = gen() % 4, j = 0; j < n; ++j) {
+          if (j) {
+            space();
+            json += ',';
+          }
+          value(level + 1);
+        }
+        space();
+        json += ']';
+      } else {
+        json += '{';
+        for (int n = gen() % 4, j = 0; j < n; ++j) {
+          if (j) {
+            space();
+            json += ',';
+          }
+          space();
+          json += "\"k" + std::to_string(j) + "\"";
+          space();
+          json += ':';
+          value(level + 1);
+        }
+        space();
+        json += '}';
+      }
+      space();
+    };
+    value(0);
+    const string expected = ToJson(JsonParser{json}.Parse());
+    EXPECT_EQ(expected, Minify(json)) << json;
+    EXPECT_EQ(expected, MinifyInPlace(json)) << json;
+  }
+}
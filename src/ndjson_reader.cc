@@ -0,0 +1,202 @@
+#include "ndjson_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "arena.h"
+#include "dom_builder.h"
+#include "helpers.h"
+#include "json_parser.h"
+
+namespace jp {
+
+namespace {
+
+// A range of whole lines of the input
+struct Batch {
+  const char* begin;
+  const char* end;
+  size_t first_line;
+};
+
+// Splits [p, end) into batches of about batch_size bytes, at line boundaries
+std::vector<Batch> SplitIntoBatches(const char* p, const char* end,
+                                    size_t batch_size) {
+  std::vector<Batch> batches;
+  size_t line = 0;
+  while (p != end) {
+    Batch batch{p, nullptr, line};
+    const char* target = end - p > static_cast<ptrdiff_t>(batch_size)
+                             ? p + batch_size
+                             : end;
+    // count the lines up to the target, and finish the line it's in
+    while (p != end) {
+      const char* newline =
+          static_cast<const char*>(std::memchr(p, '\n', end - p));
+      if (!newline) {
+        p = end;
+        break;
+      }
+      p = newline + 1;
+      ++line;
+      if (p >= target) {
+        break;
+      }
+    }
+    batch.end = p;
+    batches.push_back(batch);
+  }
+  return batches;
+}
+
+// Returns true if [p, end) is only whitespace
+bool IsBlank(const char* p, const char* end) {
+  for (; p != end; ++p) {
+    if (!IsSpace(*p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Shared state of the workers of one Parse call
+class Job {
+ public:
+  Job(std::vector<Batch> batches, bool ordered,
+      const NdjsonReader::Callback& callback)
+      : batches_(std::move(batches)), ordered_(ordered), callback_(callback) {}
+
+  // Parses batches until there are none left, or something failed. The
+  // parser, builder and arena of the worker are reused for every line, and
+  // the arena keeps a chunk from one batch to the next.
+  void Work() {
+    Arena arena;
+    JsonParser parser{&arena};
+    DomBuilder builder{&arena, false};
+    std::vector<std::pair<size_t, JsonValue>> records;
+    while (!failed_) {
+      const size_t i = next_batch_++;
+      if (i >= batches_.size()) {
+        return;
+      }
+      try {
+        ParseBatch(batches_[i], &parser, &builder, &records);
+        Deliver(i, records);
+      } catch (...) {
+        Fail(std::current_exception());
+      }
+      records.clear();
+      // the keys interned in the arena are shared by the records of a batch
+      builder.Reset(false);
+      arena.Rewind(std::min(arena.used(), Arena::kMaxChunkSize));
+    }
+  }
+
+  void RethrowError() const {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  void ParseBatch(const Batch& batch, JsonParser* parser, DomBuilder* builder,
+                  std::vector<std::pair<size_t, JsonValue>>* records) {
+    size_t line = batch.first_line;
+    for (const char* p = batch.begin; p != batch.end && !failed_; ++line) {
+      const char* newline =
+          static_cast<const char*>(std::memchr(p, '\n', batch.end - p));
+      const char* line_end = newline ? newline : batch.end;
+      if (!IsBlank(p, line_end)) {
+        JsonValue value;
+        try {
+          parser->Reset(p, line_end);
+          parser->Parse(*builder);
+          value = builder->TakeRoot();
+        } catch (const std::exception& e) {
+          throw std::runtime_error("line " + std::to_string(line + 1) + ": " +
+                                   e.what());
+        }
+        if (ordered_) {
+          records->emplace_back(line, std::move(value));
+        } else {
+          callback_(line, value);
+        }
+      }
+      p = newline ? newline + 1 : batch.end;
+    }
+  }
+
+  // In ordered mode, waits for the previous batches to be delivered, then
+  // delivers the records of batch i
+  void Deliver(size_t i,
+               const std::vector<std::pair<size_t, JsonValue>>& records) {
+    if (!ordered_) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock{mutex_};
+    turn_changed_.wait(lock, [&] { return next_delivery_ == i || failed_; });
+    if (failed_) {
+      return;
+    }
+    for (const auto& record : records) {
+      callback_(record.first, record.second);
+    }
+    ++next_delivery_;
+    turn_changed_.notify_all();
+  }
+
+  void Fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (!error_) {
+      error_ = error;
+    }
+    failed_ = true;
+    turn_changed_.notify_all();
+  }
+
+  const std::vector<Batch> batches_;
+  const bool ordered_;
+  const NdjsonReader::Callback& callback_;
+
+  std::atomic<size_t> next_batch_{0};
+  std::atomic<bool> failed_{false};
+
+  std::mutex mutex_;
+  std::condition_variable turn_changed_;
+  size_t next_delivery_ = 0;  // guarded by mutex_
+  std::exception_ptr error_;  // guarded by mutex_
+};
+}
+
+void NdjsonReader::Parse(const char* p, const char* end,
+                         const Callback& callback) const {
+  std::vector<Batch> batches = SplitIntoBatches(p, end, options_.batch_size);
+
+  size_t num_threads = options_.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min(num_threads, batches.size());
+
+  Job job{std::move(batches), options_.ordered, callback};
+  if (num_threads <= 1) {
+    job.Work();
+  } else {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&job] { job.Work(); });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  job.RethrowError();
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "json_value.h"
+
+namespace jp {
+
+// Parses newline delimited JSON (NDJSON, JSON Lines), where every line of the
+// input is a separate JSON value, on a pool of threads.
+//
+// The input is split into batches of lines, and each worker thread parses a
+// batch at a time into its own arena, which is reset after the batch is
+// delivered. Empty lines are skipped.
+class NdjsonReader {
+ public:
+  struct Options {
+    // 0 means one thread per core
+    size_t num_threads = 0;
+
+    // Approximate size of a batch, in bytes
+    size_t batch_size = 256 * 1024;
+
+    // If set, records are delivered in input order, one at a time. Otherwise
+    // the callback is called concurrently from the worker threads, in no
+    // particular order.
+    bool ordered = true;
+  };
+
+  // Called with the 0-based line number of a record, and its value. The value
+  // is only valid until the callback returns.
+  using Callback = std::function<void(size_t line, const JsonValue& value)>;
+
+  NdjsonReader() = default;
+  explicit NdjsonReader(Options options) : options_(options) {}
+
+  // Parses every record of [p, end). If a record is invalid, or the callback
+  // throws, no more records are delivered, and the error is rethrown. Parse
+  // errors are prefixed with the line number of the record.
+  void Parse(const char* p, const char* end, const Callback& callback) const;
+
+  void Parse(const std::string& input, const Callback& callback) const {
+    Parse(input.data(), input.data() + input.size(), callback);
+  }
+
+ private:
+  Options options_;
+};
+}
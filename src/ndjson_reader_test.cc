@@ -0,0 +1,89 @@
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ndjson_reader.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+static string MakeRecords(size_t n) {
+  string out;
+  for (size_t i = 0; i < n; ++i) {
+    out += "{\"id\": " + std::to_string(i) + ", \"tags\": [\"a\", \"b\"]}\n";
+  }
+  return out;
+}
+
+TEST(NdjsonReader, Ordered) {
+  const string input = MakeRecords(1000);
+  NdjsonReader::Options options;
+  options.num_threads = 4;
+  options.batch_size = 100;
+
+  std::vector<size_t> ids;
+  NdjsonReader{options}.Parse(input, [&](size_t line, const JsonValue& val) {
+    EXPECT_EQ(line, val.getObject().at("id").getNumber());
+    ids.push_back(line);
+  });
+  ASSERT_EQ(1000, ids.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(i, ids[i]);
+  }
+}
+
+TEST(NdjsonReader, Unordered) {
+  const string input = MakeRecords(1000);
+  NdjsonReader::Options options;
+  options.num_threads = 4;
+  options.batch_size = 100;
+  options.ordered = false;
+
+  std::mutex mutex;
+  std::set<size_t> ids;
+  NdjsonReader{options}.Parse(input, [&](size_t line, const JsonValue& val) {
+    std::lock_guard<std::mutex> lock{mutex};
+    ids.insert(val.getObject().at("id").getNumber());
+  });
+  EXPECT_EQ(1000, ids.size());
+}
+
+TEST(NdjsonReader, BlankLines) {
+  const string input = "1\n\n  \r\n[2]\n\"three\"";
+  std::vector<size_t> lines;
+  NdjsonReader{}.Parse(input, [&](size_t line, const JsonValue&) {
+    lines.push_back(line);
+  });
+  EXPECT_EQ((std::vector<size_t>{0, 3, 4}), lines);
+}
+
+TEST(NdjsonReader, InvalidRecord) {
+  const string input = MakeRecords(500) + "{\"id\": }\n" + MakeRecords(500);
+  NdjsonReader::Options options;
+  options.num_threads = 3;
+  options.batch_size = 64;
+  try {
+    NdjsonReader{options}.Parse(input, [](size_t, const JsonValue&) {});
+    FAIL();
+  } catch (const std::runtime_error& e) {
+    EXPECT_EQ(0, string(e.what()).find("line 501: "));
+  }
+}
+
+TEST(NdjsonReader, CallbackThrows) {
+  const string input = MakeRecords(100);
+  NdjsonReader::Options options;
+  options.num_threads = 2;
+  options.batch_size = 64;
+  EXPECT_THROW(NdjsonReader{options}.Parse(input,
+                                          [](size_t line, const JsonValue&) {
+                                            if (line == 50) {
+                                              throw std::logic_error("stop");
+                                            }
+                                          }),
+               std::logic_error);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cinttypes>
+
+namespace jp {
+
+// The parts of a JSON number, as they're found by the parser. The digit
+// ranges are valid, e.g. they aren't empty, and have no leading zeros.
+struct NumberParts {
+  const char* begin;  // the whole number, including its sign
+  const char* end;
+  const char* int_begin;  // digits before the dot
+  const char* int_end;
+  const char* frac_begin;  // digits after the dot, empty if there's no dot
+  const char* frac_end;
+  int64_t exponent;  // 0 if there's no exponent
+  bool negative;
+};
+
+// Returns the double nearest to the number, correctly rounded, as strtod
+// would, but much faster.
+//
+// Numbers with up to 19 significant digits are converted exactly with the
+// Eisel-Lemire algorithm, from "Number Parsing at a Gigabyte per Second" by
+// Daniel Lemire, and "Fast Number Parsing Without Fallback" by Noble Mushtak
+// and Daniel Lemire. Longer numbers fall back to strtod, unless rounding
+// their first 19 digits up or down gives the same result.
+double ToDouble(const NumberParts& parts);
+
+// Returns w * 10^q, correctly rounded
+double ToDouble(uint64_t w, int64_t q, bool negative);
+}
@@ -0,0 +1,389 @@
+#include "number_writer.h"
+
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+
+namespace jp {
+
+namespace {
+
+const int kSignificandBits = 52;
+const uint64_t kHiddenBit = uint64_t{1} << kSignificandBits;
+const uint64_t kSignificandMask = kHiddenBit - 1;
+const int kExponentBias = 0x3FF + kSignificandBits;
+const int kMinExponent = -kExponentBias;
+
+// A floating point number f * 2^e, with a 64-bit significand
+struct DiyFp {
+  DiyFp() = default;
+  DiyFp(uint64_t f, int e) : f(f), e(e) {}
+
+  explicit DiyFp(double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    const int biased_e = static_cast<int>(bits >> kSignificandBits) & 0x7FF;
+    const uint64_t significand = bits & kSignificandMask;
+    if (biased_e != 0) {
+      f = significand + kHiddenBit;
+      e = biased_e - kExponentBias;
+    } else {
+      f = significand;
+      e = kMinExponent + 1;
+    }
+  }
+
+  DiyFp operator-(const DiyFp& rhs) const { return DiyFp(f - rhs.f, e); }
+
+  // Rounded product of the significands, exponents add up
+  DiyFp operator*(const DiyFp& rhs) const {
+    const unsigned __int128 p = static_cast<unsigned __int128>(f) * rhs.f;
+    uint64_t h = static_cast<uint64_t>(p >> 64);
+    const uint64_t l = static_cast<uint64_t>(p);
+    h += l >> 63;
+    return DiyFp(h, e + rhs.e + 64);
+  }
+
+  DiyFp Normalize() const {
+    const int s = __builtin_clzll(f);
+    return DiyFp(f << s, e - s);
+  }
+
+  DiyFp NormalizeBoundary() const {
+    DiyFp res = *this;
+    while (!(res.f & (kHiddenBit << 1))) {
+      res.f <<= 1;
+      res.e--;
+    }
+    res.f <<= 64 - kSignificandBits - 2;
+    res.e -= 64 - kSignificandBits - 2;
+    return res;
+  }
+
+  // The boundaries halfway to the neighbouring doubles, with the same
+  // exponent
+  void NormalizedBoundaries(DiyFp* minus, DiyFp* plus) const {
+    const DiyFp pl = DiyFp((f << 1) + 1, e - 1).NormalizeBoundary();
+    DiyFp mi = f == kHiddenBit ? DiyFp((f << 2) - 1, e - 2)
+                               : DiyFp((f << 1) - 1, e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *plus = pl;
+    *minus = mi;
+  }
+
+  uint64_t f;
+  int e;
+};
+
+// 10^k for k = -348, -340, ..., 340, rounded to 64 bits
+const struct {
+  uint64_t f;
+  int e;
+} kCachedPowers[] = {
+    {0xfa8fd5a0081c0288, -1220},  // 10^-348
+    {0xbaaee17fa23ebf76, -1193},  // 10^-340
+    {0x8b16fb203055ac76, -1166},  // 10^-332
+    {0xcf42894a5dce35ea, -1140},  // 10^-324
+    {0x9a6bb0aa55653b2d, -1113},  // 10^-316
+    {0xe61acf033d1a45df, -1087},  // 10^-308
+    {0xab70fe17c79ac6ca, -1060},  // 10^-300
+    {0xff77b1fcbebcdc4f, -1034},  // 10^-292
+    {0xbe5691ef416bd60c, -1007},  // 10^-284
+    {0x8dd01fad907ffc3c, -980},  // 10^-276
+    {0xd3515c2831559a83, -954},  // 10^-268
+    {0x9d71ac8fada6c9b5, -927},  // 10^-260
+    {0xea9c227723ee8bcb, -901},  // 10^-252
+    {0xaecc49914078536d, -874},  // 10^-244
+    {0x823c12795db6ce57, -847},  // 10^-236
+    {0xc21094364dfb5637, -821},  // 10^-228
+    {0x9096ea6f3848984f, -794},  // 10^-220
+    {0xd77485cb25823ac7, -768},  // 10^-212
+    {0xa086cfcd97bf97f4, -741},  // 10^-204
+    {0xef340a98172aace5, -715},  // 10^-196
+    {0xb23867fb2a35b28e, -688},  // 10^-188
+    {0x84c8d4dfd2c63f3b, -661},  // 10^-180
+    {0xc5dd44271ad3cdba, -635},  // 10^-172
+    {0x936b9fcebb25c996, -608},  // 10^-164
+    {0xdbac6c247d62a584, -582},  // 10^-156
+    {0xa3ab66580d5fdaf6, -555},  // 10^-148
+    {0xf3e2f893dec3f126, -529},  // 10^-140
+    {0xb5b5ada8aaff80b8, -502},  // 10^-132
+    {0x87625f056c7c4a8b, -475},  // 10^-124
+    {0xc9bcff6034c13053, -449},  // 10^-116
+    {0x964e858c91ba2655, -422},  // 10^-108
+    {0xdff9772470297ebd, -396},  // 10^-100
+    {0xa6dfbd9fb8e5b88f, -369},  // 10^-92
+    {0xf8a95fcf88747d94, -343},  // 10^-84
+    {0xb94470938fa89bcf, -316},  // 10^-76
+    {0x8a08f0f8bf0f156b, -289},  // 10^-68
+    {0xcdb02555653131b6, -263},  // 10^-60
+    {0x993fe2c6d07b7fac, -236},  // 10^-52
+    {0xe45c10c42a2b3b06, -210},  // 10^-44
+    {0xaa242499697392d3, -183},  // 10^-36
+    {0xfd87b5f28300ca0e, -157},  // 10^-28
+    {0xbce5086492111aeb, -130},  // 10^-20
+    {0x8cbccc096f5088cc, -103},  // 10^-12
+    {0xd1b71758e219652c, -77},  // 10^-4
+    {0x9c40000000000000, -50},  // 10^4
+    {0xe8d4a51000000000, -24},  // 10^12
+    {0xad78ebc5ac620000, 3},  // 10^20
+    {0x813f3978f8940984, 30},  // 10^28
+    {0xc097ce7bc90715b3, 56},  // 10^36
+    {0x8f7e32ce7bea5c70, 83},  // 10^44
+    {0xd5d238a4abe98068, 109},  // 10^52
+    {0x9f4f2726179a2245, 136},  // 10^60
+    {0xed63a231d4c4fb27, 162},  // 10^68
+    {0xb0de65388cc8ada8, 189},  // 10^76
+    {0x83c7088e1aab65db, 216},  // 10^84
+    {0xc45d1df942711d9a, 242},  // 10^92
+    {0x924d692ca61be758, 269},  // 10^100
+    {0xda01ee641a708dea, 295},  // 10^108
+    {0xa26da3999aef774a, 322},  // 10^116
+    {0xf209787bb47d6b85, 348},  // 10^124
+    {0xb454e4a179dd1877, 375},  // 10^132
+    {0x865b86925b9bc5c2, 402},  // 10^140
+    {0xc83553c5c8965d3d, 428},  // 10^148
+    {0x952ab45cfa97a0b3, 455},  // 10^156
+    {0xde469fbd99a05fe3, 481},  // 10^164
+    {0xa59bc234db398c25, 508},  // 10^172
+    {0xf6c69a72a3989f5c, 534},  // 10^180
+    {0xb7dcbf5354e9bece, 561},  // 10^188
+    {0x88fcf317f22241e2, 588},  // 10^196
+    {0xcc20ce9bd35c78a5, 614},  // 10^204
+    {0x98165af37b2153df, 641},  // 10^212
+    {0xe2a0b5dc971f303a, 667},  // 10^220
+    {0xa8d9d1535ce3b396, 694},  // 10^228
+    {0xfb9b7cd9a4a7443c, 720},  // 10^236
+    {0xbb764c4ca7a44410, 747},  // 10^244
+    {0x8bab8eefb6409c1a, 774},  // 10^252
+    {0xd01fef10a657842c, 800},  // 10^260
+    {0x9b10a4e5e9913129, 827},  // 10^268
+    {0xe7109bfba19c0c9d, 853},  // 10^276
+    {0xac2820d9623bf429, 880},  // 10^284
+    {0x80444b5e7aa7cf85, 907},  // 10^292
+    {0xbf21e44003acdd2d, 933},  // 10^300
+    {0x8e679c2f5e44ff8f, 960},  // 10^308
+    {0xd433179d9c8cb841, 986},  // 10^316
+    {0x9e19db92b4e31ba9, 1013},  // 10^324
+    {0xeb96bf6ebadf77d9, 1039},  // 10^332
+    {0xaf87023b9bf0ee6b, 1066},  // 10^340
+};
+
+const int kMinCachedPower = -348;
+const int kCachedPowerStep = 8;
+
+// Returns a cached power c = 10^-k, such that c * 2^e has its binary exponent
+// in a small range, which lets DigitGen work with 64-bit integers
+DiyFp GetCachedPower(int e, int* k) {
+  const double dk = (-61 - e) * 0.30102999566398114 - kMinCachedPower - 1;
+  int ik = static_cast<int>(dk);
+  if (dk - ik > 0.0) {
+    ++ik;
+  }
+  const int index = (ik >> 3) + 1;
+  *k = -(kMinCachedPower + index * kCachedPowerStep);
+  return DiyFp(kCachedPowers[index].f, kCachedPowers[index].e);
+}
+
+const uint64_t kPowersOfTen[] = {1ULL,
+                                 10ULL,
+                                 100ULL,
+                                 1000ULL,
+                                 10000ULL,
+                                 100000ULL,
+                                 1000000ULL,
+                                 10000000ULL,
+                                 100000000ULL,
+                                 1000000000ULL,
+                                 10000000000ULL,
+                                 100000000000ULL,
+                                 1000000000000ULL,
+                                 10000000000000ULL,
+                                 100000000000000ULL,
+                                 1000000000000000ULL,
+                                 10000000000000000ULL,
+                                 100000000000000000ULL,
+                                 1000000000000000000ULL,
+                                 10000000000000000000ULL};
+
+int CountDecimalDigits(uint32_t n) {
+  int digits = 1;
+  while (digits < 10 && n >= kPowersOfTen[digits]) {
+    ++digits;
+  }
+  return digits;
+}
+
+// Moves the last digit towards w, as long as it stays within the boundaries
+void GrisuRound(char* buffer, int len, uint64_t delta, uint64_t rest,
+                uint64_t ten_kappa, uint64_t wp_w) {
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    buffer[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+// Generates the shortest digits of a number within [Mp - delta, Mp], closest
+// to W
+void DigitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer,
+              int* len, int* k) {
+  const DiyFp one(uint64_t{1} << -Mp.e, Mp.e);
+  const DiyFp wp_w = Mp - W;
+  uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = CountDecimalDigits(p1);
+  *len = 0;
+
+  // the integral part
+  while (kappa > 0) {
+    const uint32_t divisor = static_cast<uint32_t>(kPowersOfTen[kappa - 1]);
+    const uint32_t d = p1 / divisor;
+    p1 %= divisor;
+    if (d || *len) {
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    }
+    kappa--;
+    const uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+    if (rest <= delta) {
+      *k += kappa;
+      GrisuRound(buffer, *len, delta, rest, kPowersOfTen[kappa] << -one.e,
+                 wp_w.f);
+      return;
+    }
+  }
+
+  // the fractional part
+  while (true) {
+    p2 *= 10;
+    delta *= 10;
+    const char d = static_cast<char>(p2 >> -one.e);
+    if (d || *len) {
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    }
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *k += kappa;
+      const int index = -kappa;
+      GrisuRound(buffer, *len, delta, p2, one.f,
+                 wp_w.f * (index < 20 ? kPowersOfTen[index] : 0));
+      return;
+    }
+  }
+}
+
+// Writes the digits of d > 0 to buffer, such that d = digits * 10^k
+void Grisu2(double d, char* buffer, int* len, int* k) {
+  const DiyFp v(d);
+  DiyFp w_m, w_p;
+  v.NormalizedBoundaries(&w_m, &w_p);
+
+  const DiyFp c_mk = GetCachedPower(w_p.e, k);
+  const DiyFp W = v.Normalize() * c_mk;
+  DiyFp Wp = w_p * c_mk;
+  DiyFp Wm = w_m * c_mk;
+  Wm.f++;
+  Wp.f--;
+  DigitGen(W, Wp, Wp.f - Wm.f, buffer, len, k);
+}
+
+char* WriteExponent(int k, char* buffer) {
+  if (k < 0) {
+    *buffer++ = '-';
+    k = -k;
+  }
+  if (k >= 100) {
+    *buffer++ = static_cast<char>('0' + k / 100);
+    k %= 100;
+    *buffer++ = static_cast<char>('0' + k / 10);
+    *buffer++ = static_cast<char>('0' + k % 10);
+  } else if (k >= 10) {
+    *buffer++ = static_cast<char>('0' + k / 10);
+    *buffer++ = static_cast<char>('0' + k % 10);
+  } else {
+    *buffer++ = static_cast<char>('0' + k);
+  }
+  return buffer;
+}
+
+// Formats the digits [buffer, buffer + len) * 10^k in place, in fixed
+// notation if it's not too long, in scientific notation otherwise
+char* Prettify(char* buffer, int len, int k) {
+  // 10^(kk - 1) <= d < 10^kk
+  const int kk = len + k;
+
+  if (0 <= k && kk <= 21) {
+    // 1234e7 -> 12340000000.0
+    std::memset(buffer + len, '0', k);
+    buffer[kk] = '.';
+    buffer[kk + 1] = '0';
+    return buffer + kk + 2;
+  }
+  if (0 < kk && kk <= 21) {
+    // 1234e-2 -> 12.34
+    std::memmove(buffer + kk + 1, buffer + kk, len - kk);
+    buffer[kk] = '.';
+    return buffer + len + 1;
+  }
+  if (-6 < kk && kk <= 0) {
+    // 1234e-6 -> 0.001234
+    const int offset = 2 - kk;
+    std::memmove(buffer + offset, buffer, len);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    std::memset(buffer + 2, '0', offset - 2);
+    return buffer + len + offset;
+  }
+  if (len == 1) {
+    // 1e30
+    buffer[1] = 'e';
+    return WriteExponent(kk - 1, buffer + 2);
+  }
+  // 1234e30 -> 1.234e33
+  std::memmove(buffer + 2, buffer + 1, len - 1);
+  buffer[1] = '.';
+  buffer[len + 1] = 'e';
+  return WriteExponent(kk - 1, buffer + len + 2);
+}
+}
+
+char* WriteDouble(double d, char* buffer) {
+  assert(std::isfinite(d));
+  if (std::signbit(d)) {
+    *buffer++ = '-';
+    d = -d;
+  }
+  if (d == 0) {
+    std::memcpy(buffer, "0.0", 3);
+    return buffer + 3;
+  }
+  int len;
+  int k;
+  Grisu2(d, buffer, &len, &k);
+  return Prettify(buffer, len, k);
+}
+
+char* WriteUint64(uint64_t n, char* buffer) {
+  char digits[20];
+  int len = 0;
+  do {
+    digits[len++] = static_cast<char>('0' + n % 10);
+    n /= 10;
+  } while (n);
+  while (len) {
+    *buffer++ = digits[--len];
+  }
+  return buffer;
+}
+
+char* WriteInt64(int64_t n, char* buffer) {
+  uint64_t u = static_cast<uint64_t>(n);
+  if (n < 0) {
+    *buffer++ = '-';
+    u = ~u + 1;
+  }
+  return WriteUint64(u, buffer);
+}
+}
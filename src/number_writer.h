@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cinttypes>
+
+namespace jp {
+
+// Longest output of the functions below, with some slack
+const int kMaxNumberLength = 32;
+
+// Writes the shortest representation of d, which is parsed back to the same
+// double, e.g. 0.1 rather than 0.10000000000000001, and returns the end of
+// the output. Doubles always have a dot or an exponent, so they are parsed
+// back as doubles, not as integers: 1.0, 1e100, 1.5e-7.
+//
+// Uses Grisu2, from "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers" by Florian Loitsch, which gives the shortest output for
+// nearly all doubles, and a correct one for all of them. d must be finite.
+char* WriteDouble(double d, char* buffer);
+
+char* WriteInt64(int64_t n, char* buffer);
+char* WriteUint64(uint64_t n, char* buffer);
+}
@@ -0,0 +1,215 @@
+#include "parallel_parser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "dom_builder.h"
+#include "helpers.h"
+#include "json_parser.h"
+
+namespace jp {
+
+namespace {
+
+// What a chunk looks like, if it starts outside of a string, or inside one
+struct Scan {
+  // Depth at the end of the chunk, relative to its start
+  long depth = 0;
+
+  // Position of the first comma at each relative depth d, at index d for
+  // d >= 0, and at -d - 1 otherwise
+  std::vector<const char*> commas_above;
+  std::vector<const char*> commas_below;
+
+  void AddComma(const char* p) {
+    auto& commas = depth >= 0 ? commas_above : commas_below;
+    const size_t i = depth >= 0 ? depth : -depth - 1;
+    if (commas.size() <= i) {
+      commas.resize(i + 1, nullptr);
+    }
+    if (!commas[i]) {
+      commas[i] = p;
+    }
+  }
+
+  const char* FirstComma(long d) const {
+    const auto& commas = d >= 0 ? commas_above : commas_below;
+    const size_t i = d >= 0 ? d : -d - 1;
+    return i < commas.size() ? commas[i] : nullptr;
+  }
+};
+
+struct Chunk {
+  const char* begin;
+  const char* end;
+
+  // [0] assumes the chunk starts outside of a string, [1] inside
+  Scan scans[2];
+
+  // Whether the chunk has an odd number of quotes, i.e. ends in the other
+  // state than it starts
+  bool flips = false;
+};
+
+// Scans a chunk for both of its possible start states in one pass. A quote
+// toggles both the same way, so they always disagree about being in a string.
+//
+// A backslash escapes the next char even outside of strings, which is invalid
+// JSON anyway. Chunks never start right after a backslash, so they never start
+// with an escaped char.
+void ScanChunk(Chunk* chunk) {
+  bool in_string = false;
+  for (const char* p = chunk->begin; p != chunk->end; ++p) {
+    switch (*p) {
+      case '\\':
+        if (++p == chunk->end) {
+          return;
+        }
+        break;
+      case '"':
+        in_string = !in_string;
+        chunk->flips = !chunk->flips;
+        break;
+      case '[':
+      case '{':
+        ++chunk->scans[in_string].depth;
+        break;
+      case ']':
+      case '}':
+        --chunk->scans[in_string].depth;
+        break;
+      case ',':
+        chunk->scans[in_string].AddComma(p);
+        break;
+    }
+  }
+}
+
+// Runs fn(i) for every i in [0, n) on num_threads threads, and rethrows the
+// first exception
+template <typename Fn>
+void ParallelFor(size_t n, size_t num_threads, const Fn& fn) {
+  std::atomic<size_t> next{0};
+  std::atomic<bool> failed{false};
+  std::mutex mutex;
+  std::exception_ptr error;
+
+  auto work = [&] {
+    for (size_t i; !failed && (i = next++) < n;) {
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(num_threads, n); ++i) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+}
+
+JsonValue ParallelParser::Parse(const char* p, const char* end) const {
+  size_t num_threads = options_.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  const char* open = p;
+  while (open != end && IsSpace(*open)) {
+    ++open;
+  }
+  const size_t min_chunk_size = std::max<size_t>(1, options_.min_chunk_size);
+  const size_t size = end - open;
+  if (num_threads == 1 || size < 2 * min_chunk_size ||
+      (*open != '[' && *open != '{')) {
+    return JsonParser{p, end}.Parse();
+  }
+  const bool members = *open == '{';
+
+  // A few chunks per thread, so that threads which are done early can help
+  // out the others
+  const size_t num_chunks =
+      std::min(4 * num_threads, std::max<size_t>(2, size / min_chunk_size));
+  std::vector<Chunk> chunks;
+  const char* begin = open + 1;
+  for (size_t i = 1; i <= num_chunks && begin != end; ++i) {
+    const char* chunk_end =
+        i == num_chunks ? end : std::max(begin, open + i * size / num_chunks);
+    while (chunk_end != end && chunk_end[-1] == '\\') {
+      ++chunk_end;
+    }
+    chunks.push_back(Chunk{begin, chunk_end});
+    begin = chunk_end;
+  }
+
+  try {
+    ParallelFor(chunks.size(), num_threads,
+                [&](size_t i) { ScanChunk(&chunks[i]); });
+
+    // The actual state at the start of each chunk is now known, so the
+    // outermost container can be split at a comma of depth 1 in each chunk
+    std::vector<const char*> slices{open + 1};
+    bool in_string = false;
+    long depth = 1;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      const Scan& scan = chunks[i].scans[in_string];
+      const char* comma = i == 0 ? nullptr : scan.FirstComma(1 - depth);
+      if (comma) {
+        slices.push_back(comma + 1);
+      }
+      depth += scan.depth;
+      in_string ^= chunks[i].flips;
+    }
+    if (slices.size() == 1) {
+      return JsonParser{p, end}.Parse();
+    }
+    slices.push_back(end);
+
+    std::vector<JsonValue> parts(slices.size() - 1);
+    ParallelFor(parts.size(), num_threads, [&](size_t i) {
+      DomBuilder builder{nullptr, false};
+      JsonParser parser{slices[i], slices[i + 1]};
+      if (members) {
+        builder.StartObject();
+        parser.ParseSlice(builder, true, i + 1 == parts.size());
+        builder.EndObject(0);
+      } else {
+        builder.StartArray();
+        parser.ParseSlice(builder, false, i + 1 == parts.size());
+        builder.EndArray(0);
+      }
+      parts[i] = builder.TakeRoot();
+    });
+
+    DomBuilder builder{nullptr, false};
+    members ? builder.StartObject() : builder.StartArray();
+    for (JsonValue& part : parts) {
+      builder.Splice(std::move(part));
+    }
+    members ? builder.EndObject(0) : builder.EndArray(0);
+    return builder.TakeRoot();
+  } catch (const std::runtime_error&) {
+  }
+  // The input is invalid, parse it again to get the same error as Parse()
+  return JsonParser{p, end}.Parse();
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "json_value.h"
+
+namespace jp {
+
+// Parses a single large document, whose outermost value is an array or an
+// object, on a pool of threads. The result is the same as that of
+// JsonParser::Parse(), including the error, if the input is invalid.
+//
+// The input is cut into chunks, which are scanned in parallel. A chunk may
+// start inside a string, which isn't known until the chunks before it are
+// scanned, so every chunk is scanned for both cases at once, and the right
+// one is picked afterwards. The outermost container is then split at the
+// first of its commas in each chunk, and the slices between them are parsed
+// in parallel, and joined.
+//
+// Nodes are allocated on the heap. Inputs which are too small, or not a
+// container, are parsed on the calling thread.
+class ParallelParser {
+ public:
+  struct Options {
+    // 0 means one thread per core
+    size_t num_threads = 0;
+
+    // Inputs are cut into chunks of at least this many bytes
+    size_t min_chunk_size = 1024 * 1024;
+  };
+
+  ParallelParser() = default;
+  explicit ParallelParser(Options options) : options_(options) {}
+
+  JsonValue Parse(const char* p, const char* end) const;
+
+  JsonValue Parse(const std::string& json) const {
+    return Parse(json.data(), json.data() + json.size());
+  }
+
+ private:
+  Options options_;
+};
+}
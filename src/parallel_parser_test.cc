@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "json_parser.h"
+#include "parallel_parser.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+// Prints val with sorted keys, so that equal values print the same
+string Dump(const JsonValue& val) {
+  switch (val.type()) {
+    case JsonValue::OBJECT: {
+      std::vector<string> members;
+      for (const auto& member : val.getObject()) {
+        members.push_back(member.first.str() + ":" + Dump(member.second));
+      }
+      std::sort(members.begin(), members.end());
+      string out = "{";
+      for (const auto& member : members) {
+        out += member + ",";
+      }
+      return out + "}";
+    }
+    case JsonValue::ARRAY: {
+      string out = "[";
+      for (const auto& element : val.getArray()) {
+        out += Dump(element) + ",";
+      }
+      return out + "]";
+    }
+    case JsonValue::STRING:
+      return "'" + val.getString().str() + "'";
+    case JsonValue::NUMBER:
+      return std::to_string(val.getNumber());
+    case JsonValue::BOOL:
+      return val.getBool() ? "true" : "false";
+    case JsonValue::NULL_VALUE:
+      return "null";
+  }
+  return "";
+}
+
+JsonValue ParseParallel(const string& json, size_t chunk_size) {
+  ParallelParser::Options options;
+  options.num_threads = 4;
+  options.min_chunk_size = chunk_size;
+  return ParallelParser{options}.Parse(json);
+}
+}
+
+TEST(ParallelParser, MatchesParser) {
+  const std::vector<string> jsons{
+      " [1, \"a,b\", {\"c\": [2, 3]}, [], \"\\\\\", \"\\\",[\", -1.5e3, null] ",
+      "{\"a\": 1, \"b,\": [\"}\", {\"x\": true}], \"c\": \"\\\\\\\"\", "
+      "\"d\": {}, \"a\": 2}",
+      "[[1, 2], [3, [4, 5]], 6, 7, 8, 9, 10]", "[1]", "[]", "{}", "\"a,b\"",
+      "12"};
+  for (const auto& json : jsons) {
+    const string expected = Dump(JsonParser{json}.Parse());
+    for (size_t chunk_size = 1; chunk_size <= json.size(); ++chunk_size) {
+      EXPECT_EQ(expected, Dump(ParseParallel(json, chunk_size)))
+          << json << " in chunks of " << chunk_size;
+    }
+  }
+}
+
+TEST(ParallelParser, LargeArray) {
+  string json = "[";
+  for (size_t i = 0; i < 10000; ++i) {
+    json += "{\"id\": " + std::to_string(i) + ", \"name\": \"n\\\"" +
+            std::to_string(i) + "\", \"tags\": [\"a,]\", \"b\"]},\n";
+  }
+  json += "null]";
+  const JsonValue val = ParseParallel(json, 1024);
+  EXPECT_EQ(Dump(JsonParser{json}.Parse()), Dump(val));
+  EXPECT_EQ(10001, val.getArray().size());
+}
+
+TEST(ParallelParser, InvalidJson) {
+  const std::vector<string> jsons{
+      "[1, 2,]", "[1, 2] [3, 4]", "{\"a\": 1, \"b\" 2}", "[1, 2, 3",
+      "[\"a, \"b\"]", "[1, 2]]", "{\"a\": 1, 2}", "[1, \\, 2]"};
+  for (const auto& json : jsons) {
+    string expected;
+    try {
+      JsonParser{json}.Parse();
+    } catch (const std::exception& e) {
+      expected = e.what();
+    }
+    ASSERT_FALSE(expected.empty()) << json;
+    for (size_t chunk_size = 1; chunk_size <= json.size(); ++chunk_size) {
+      try {
+        ParseParallel(json, chunk_size);
+        ADD_FAILURE() << json << " in chunks of " << chunk_size;
+      } catch (const std::exception& e) {
+        EXPECT_EQ(expected, e.what()) << json << " in chunks of "
+                                      << chunk_size;
+      }
+    }
+  }
+}
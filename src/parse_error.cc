@@ -0,0 +1,81 @@
+#include "parse_error.h"
+
+#include <algorithm>
+
+#include "helpers.h"
+
+namespace jp {
+
+namespace {
+
+// Shows up to 10 chars on either side of offset, with a caret below it
+std::string Surroundings(StringRef input, size_t offset) {
+  const size_t kMaxExtensionLength = 10;
+  const size_t begin = offset - std::min(kMaxExtensionLength, offset);
+  const size_t end =
+      offset == input.size()
+          ? offset
+          : std::min(input.size(), offset + 1 + kMaxExtensionLength);
+
+  std::string out{input.data() + begin, end - begin};
+  out += '\n';
+  out.append(offset - begin, ' ');
+  out += "^\n";
+  return out;
+}
+}
+
+const char* Describe(ParseErrorCode code) {
+  switch (code) {
+    case ParseErrorCode::OK:
+      return "no error";
+    case ParseErrorCode::UNEXPECTED_END:
+      return "unexpected end of input";
+    case ParseErrorCode::EXPECTED_VALUE:
+      return "expected a JSON value";
+    case ParseErrorCode::EXPECTED_KEY:
+      return "expected a string";
+    case ParseErrorCode::EXPECTED_COLON:
+      return "expected ':'";
+    case ParseErrorCode::EXPECTED_OBJECT_END:
+      return "expected ',' or '}'";
+    case ParseErrorCode::EXPECTED_ARRAY_END:
+      return "expected ',' or ']'";
+    case ParseErrorCode::INVALID_ESCAPE:
+      return "invalid escape char";
+    case ParseErrorCode::INVALID_STRING_CHAR:
+      return "literal whitespace chars are not allowed inside JSON string";
+    case ParseErrorCode::INVALID_UTF8:
+      return "invalid UTF-8";
+    case ParseErrorCode::LONE_SURROGATE:
+      return "unpaired surrogate escape";
+    case ParseErrorCode::INVALID_NUMBER:
+      return "invalid number";
+    case ParseErrorCode::INVALID_LITERAL:
+      return "expected true, false or null";
+    case ParseErrorCode::TOO_DEEP:
+      return "arrays and objects are nested too deeply";
+    case ParseErrorCode::TRAILING_CONTENT:
+      return "unexpected string at the end of input";
+  }
+  return "unknown error";
+}
+
+std::string ParseError::Message(StringRef input) const {
+  std::string out = Surroundings(input, offset);
+  out += Describe(code);
+  switch (code) {
+    case ParseErrorCode::EXPECTED_VALUE:
+    case ParseErrorCode::EXPECTED_KEY:
+    case ParseErrorCode::EXPECTED_COLON:
+    case ParseErrorCode::EXPECTED_OBJECT_END:
+    case ParseErrorCode::EXPECTED_ARRAY_END:
+      out += ", got ";
+      out += offset < input.size() ? quote(input[offset]) : "end of input";
+      break;
+    default:
+      break;
+  }
+  return out;
+}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include "helpers.h"
+#include "string_ref.h"
+
+namespace jp {
+
+// Why an input is invalid
+enum class ParseErrorCode : int8_t {
+  OK,
+  UNEXPECTED_END,       // the input ends in the middle of a value
+  EXPECTED_VALUE,       // something else than a value where one has to be
+  EXPECTED_KEY,         // something else than a string where a key has to be
+  EXPECTED_COLON,       // after a key
+  EXPECTED_OBJECT_END,  // after a member, which isn't followed by ',' or '}'
+  EXPECTED_ARRAY_END,   // after an element, which isn't followed by ',' or ']'
+  INVALID_ESCAPE,       // a backslash followed by an invalid char
+  INVALID_STRING_CHAR,  // whitespace inside a string, other than spaces
+  INVALID_UTF8,         // a string which isn't valid UTF-8
+  LONE_SURROGATE,       // a \u escape of half a surrogate pair, on its own
+  INVALID_NUMBER,
+  INVALID_LITERAL,   // anything starting like true, false or null, but isn't
+  TOO_DEEP,          // see JsonParser::set_max_depth
+  TRAILING_CONTENT,  // anything but whitespace after the value
+};
+
+// A description of code, e.g. "unexpected end of input"
+const char* Describe(ParseErrorCode code);
+
+// What's wrong with an invalid input, and where. Making one is cheap, as the
+// message, which quotes the input around the error, is only built on demand.
+struct ParseError {
+  ParseErrorCode code = ParseErrorCode::OK;
+  size_t offset = 0;  // of the first invalid char, or the size of the input
+
+  // Whether there is an error
+  explicit operator bool() const { return code != ParseErrorCode::OK; }
+
+  // The error as a message for humans, which shows where it is in input. input
+  // has to be the whole input which was parsed.
+  std::string Message(StringRef input) const;
+};
+
+// The exception thrown for invalid inputs
+class ParseException : public std::runtime_error {
+ public:
+  ParseException(const ParseError& error, StringRef input)
+      : std::runtime_error(error.Message(input)), error_(error) {}
+
+  const ParseError& error() const noexcept { return error_; }
+
+ private:
+  ParseError error_;
+};
+}
@@ -0,0 +1,60 @@
+#include "parse_stats.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace jp {
+
+namespace {
+
+const char* const kTokenNames[ParseStats::kNumTokens] = {
+    "object_open", "object_close", "array_open", "array_close",
+    "comma",       "string",       "colon",      "bool",
+    "number",      "null",         "invalid"};
+
+void AppendField(const char* name, uint64_t value, std::string* out) {
+  *out += '"';
+  *out += name;
+  *out += "\": ";
+  *out += std::to_string(value);
+}
+}
+
+ParseStats& ParseStats::operator+=(const ParseStats& other) {
+  for (size_t i = 0; i < kNumTokens; ++i) {
+    tokens[i] += other.tokens[i];
+  }
+  string_bytes += other.string_bytes;
+  escapes += other.escapes;
+  allocations += other.allocations;
+  max_depth = std::max(max_depth, other.max_depth);
+  string_cycles += other.string_cycles;
+  number_cycles += other.number_cycles;
+  space_cycles += other.space_cycles;
+  return *this;
+}
+
+std::string ParseStats::ToJson() const {
+  std::string out = "{\"tokens\": {";
+  for (size_t i = 0; i < kNumTokens; ++i) {
+    out += i ? ", " : "";
+    AppendField(kTokenNames[i], tokens[i], &out);
+  }
+  out += "}";
+  const std::pair<const char*, uint64_t> fields[] = {
+      {"string_bytes", string_bytes},   {"escapes", escapes},
+      {"allocations", allocations},     {"max_depth", max_depth},
+      {"string_cycles", string_cycles}, {"number_cycles", number_cycles},
+      {"space_cycles", space_cycles}};
+  for (const auto& field : fields) {
+    out += ", ";
+    AppendField(field.first, field.second, &out);
+  }
+  return out + "}";
+}
+
+ParseStats& ThreadParseStats() {
+  thread_local ParseStats stats;
+  return stats;
+}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Building with JP_PARSE_STATS defined to 1, e.g. -DJP_PARSE_STATS=1, makes
+// JsonParser count what it parses, and time its hottest functions, in a
+// ParseStats. By default it's 0, and the counting compiles to nothing, so it
+// costs nothing either. It changes the layout of JsonParser, so it has to be
+// the same for every file of a program.
+#ifndef JP_PARSE_STATS
+#define JP_PARSE_STATS 0
+#endif
+
+// JP_STATS(statement) compiles statement only when stats are enabled
+#if JP_PARSE_STATS
+#define JP_STATS(...) __VA_ARGS__
+#else
+#define JP_STATS(...)
+#endif
+
+namespace jp {
+
+// What a parser did, during one parse or many of them
+struct ParseStats {
+  // The tokens a value may start with, and the ones between values, which
+  // tokens counts
+  enum Token {
+    OBJECT_OPEN,
+    OBJECT_CLOSE,
+    ARRAY_OPEN,
+    ARRAY_CLOSE,
+    COMMA,
+    STRING,
+    COLON,
+    BOOL,
+    NUMBER,
+    NULL_VALUE,
+    INVALID,
+  };
+  static const size_t kNumTokens = INVALID + 1;
+
+  uint64_t tokens[kNumTokens] = {};
+
+  // In the input, between the quotes, of strings and keys
+  uint64_t string_bytes = 0;
+  uint64_t escapes = 0;
+
+  // Chunks allocated by the arena, and buffers of the parser which grew
+  uint64_t allocations = 0;
+
+  // Of arrays and objects
+  size_t max_depth = 0;
+
+  // Spent in ParseString, ParseNumber, and skipping whitespace between
+  // tokens, in cycles of the time stamp counter, or nanoseconds on CPUs
+  // without one
+  uint64_t string_cycles = 0;
+  uint64_t number_cycles = 0;
+  uint64_t space_cycles = 0;
+
+  // Adds up the counts, and keeps the larger depth
+  ParseStats& operator+=(const ParseStats& other);
+
+  // As a JSON object, e.g. to be logged
+  std::string ToJson() const;
+};
+
+// The stats of every parse of this thread, added up. They're only counted
+// when JP_PARSE_STATS is enabled.
+ParseStats& ThreadParseStats();
+
+inline uint64_t CycleCount() {
+#if defined(__x86_64__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// Adds the cycles from its construction to its destruction to *counter
+class CycleTimer {
+ public:
+  explicit CycleTimer(uint64_t* counter)
+      : counter_(counter), start_(CycleCount()) {}
+  ~CycleTimer() { *counter_ += CycleCount() - start_; }
+
+  CycleTimer(const CycleTimer&) = delete;
+  CycleTimer& operator=(const CycleTimer&) = delete;
+
+ private:
+  uint64_t* const counter_;
+  const uint64_t start_;
+};
+}
@@ -0,0 +1,80 @@
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "json_document.h"
+#include "json_parser.h"
+#include "parse_stats.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+TEST(ParseStats, Add) {
+  ParseStats a;
+  a.tokens[ParseStats::STRING] = 2;
+  a.escapes = 1;
+  a.max_depth = 3;
+  ParseStats b;
+  b.tokens[ParseStats::STRING] = 1;
+  b.tokens[ParseStats::NUMBER] = 4;
+  b.max_depth = 2;
+  b.string_cycles = 10;
+  a += b;
+  EXPECT_EQ(3, a.tokens[ParseStats::STRING]);
+  EXPECT_EQ(4, a.tokens[ParseStats::NUMBER]);
+  EXPECT_EQ(1, a.escapes);
+  EXPECT_EQ(3, a.max_depth);
+  EXPECT_EQ(10, a.string_cycles);
+}
+
+TEST(ParseStats, ToJson) {
+  ParseStats stats;
+  stats.tokens[ParseStats::OBJECT_OPEN] = 1;
+  stats.string_bytes = 12;
+  const string json = stats.ToJson();
+  EXPECT_NE(string::npos, json.find("\"object_open\": 1,"));
+  EXPECT_NE(string::npos, json.find("\"string_bytes\": 12,"));
+  // it's valid JSON
+  JsonParser{json}.Parse();
+}
+
+#if JP_PARSE_STATS
+
+TEST(ParseStats, Counts) {
+  const string json =
+      " {\"a\": [1, -2.5, \"x\\ny\"], \"b\": {\"c\": [[true, null]]}} ";
+  JsonParser parser{json};
+  parser.Parse();
+  const ParseStats& stats = parser.stats();
+  EXPECT_EQ(2, stats.tokens[ParseStats::OBJECT_OPEN]);
+  EXPECT_EQ(2, stats.tokens[ParseStats::OBJECT_CLOSE]);
+  EXPECT_EQ(3, stats.tokens[ParseStats::ARRAY_OPEN]);
+  EXPECT_EQ(3, stats.tokens[ParseStats::ARRAY_CLOSE]);
+  EXPECT_EQ(4, stats.tokens[ParseStats::COMMA]);
+  EXPECT_EQ(4, stats.tokens[ParseStats::STRING]);
+  EXPECT_EQ(3, stats.tokens[ParseStats::COLON]);
+  EXPECT_EQ(2, stats.tokens[ParseStats::NUMBER]);
+  EXPECT_EQ(1, stats.tokens[ParseStats::BOOL]);
+  EXPECT_EQ(1, stats.tokens[ParseStats::NULL_VALUE]);
+  EXPECT_EQ(0, stats.tokens[ParseStats::INVALID]);
+  EXPECT_EQ(7, stats.string_bytes);
+  EXPECT_EQ(1, stats.escapes);
+  EXPECT_EQ(4, stats.max_depth);
+  EXPECT_GT(stats.string_cycles, 0);
+  EXPECT_GT(stats.number_cycles, 0);
+}
+
+TEST(ParseStats, PerThread) {
+  std::thread([]() {
+    EXPECT_EQ(0, ThreadParseStats().tokens[ParseStats::NUMBER]);
+    JsonDocument doc;
+    doc.Parse("[1, 2]");
+    doc.Parse("[3]");
+    EXPECT_EQ(3, ThreadParseStats().tokens[ParseStats::NUMBER]);
+    EXPECT_EQ(1, ThreadParseStats().max_depth);
+  }).join();
+}
+
+#endif
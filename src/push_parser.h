@@ -0,0 +1,366 @@
+#pragma once
+
+#include <assert.h>
+#include <cinttypes>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "helpers.h"
+#include "json_parser.h"
+#include "string_ref.h"
+#include "structural_index.h"
+
+namespace jp {
+
+// A PushParser parses a JSON document which arrives in chunks, e.g. from a
+// socket, without having to buffer the whole document. It's a resumable state
+// machine: every call to Feed parses as much as it can, and keeps the partial
+// token at the end of the chunk (a string, number or literal) until the next
+// chunk arrives.
+//
+// Values are reported to Handler as they are parsed, see JsonParser::Parse
+// for its methods. Strings are only valid until the handler returns, as the
+// chunk they are in may be gone after that. To build a JsonValue, use a
+// DomBuilder as the handler:
+//
+//   DomBuilder builder{nullptr, false};
+//   PushParser<DomBuilder> parser{builder};
+//   while (...) {
+//     parser.Feed(chunk, size);
+//   }
+//   parser.Finish();
+//   JsonValue val = builder.TakeRoot();
+template <typename Handler>
+class PushParser {
+ public:
+  explicit PushParser(Handler& handler) : handler_(handler) {}
+
+  // Parses the next chunk of the input
+  void Feed(const char* data, size_t size);
+  void Feed(StringRef chunk) { Feed(chunk.data(), chunk.size()); }
+
+  // Signals the end of the input, and makes sure it was a whole document
+  void Finish();
+
+  // Number of bytes fed so far
+  size_t offset() const { return offset_; }
+
+  // Inputs with arrays and objects nested more deeply than max_depth are
+  // rejected, like with JsonParser::set_max_depth
+  void set_max_depth(size_t max_depth) { max_depth_ = max_depth; }
+
+ private:
+  // What the grammar expects next
+  enum class State : int8_t {
+    VALUE,          // a value, e.g. after ':' or ','
+    FIRST_ELEMENT,  // a value or ']', after '['
+    FIRST_KEY,      // a key or '}', after '{'
+    KEY,            // a key, after ',' in an object
+    COLON,          // ':' after a key
+    AFTER_VALUE,    // ',' or the end of the current container
+    DONE,           // only whitespace, after the outermost value
+  };
+
+  // Kind of the token that continues in the next chunk
+  enum class Token : int8_t { NONE, STRING, NUMBER, LITERAL };
+
+  struct Container {
+    bool is_object;
+    size_t size;
+  };
+
+  // Forwards the scalar parsed by JsonParser to the handler, as a key if a
+  // key is expected. Strings are always marked to be copied.
+  struct ScalarSink {
+    void StartObject() { assert(false); }
+    void Key(StringRef, bool) { assert(false); }
+    void EndObject(size_t) { assert(false); }
+    void StartArray() { assert(false); }
+    void EndArray(size_t) { assert(false); }
+    void String(StringRef str, bool) {
+      if (parser.state_ == State::FIRST_KEY || parser.state_ == State::KEY) {
+        parser.handler_.Key(str, true);
+      } else {
+        parser.handler_.String(str, true);
+      }
+    }
+    void Int64(int64_t num) { parser.handler_.Int64(num); }
+    void Uint64(uint64_t num) { parser.handler_.Uint64(num); }
+    void Number(double num) { parser.handler_.Number(num); }
+    void Bool(bool val) { parser.handler_.Bool(val); }
+    void Null() { parser.handler_.Null(); }
+
+    PushParser& parser;
+  };
+
+  static bool IsNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+           c == 'e' || c == 'E';
+  }
+
+  static bool IsLiteralChar(char c) { return c >= 'a' && c <= 'z'; }
+
+  // Returns the end of the token starting at (or continuing at) p, or nullptr
+  // if it doesn't end before end
+  const char* ScanToken(const char* p, const char* end);
+
+  // Parses the complete token [begin, token_end), followed by at least one
+  // more char before limit, and reports it
+  void EmitToken(const char* begin, const char* token_end, const char* limit);
+
+  // Checks that a value may start at the current position
+  void ExpectValue(bool is_string);
+
+  // Called after a value is complete
+  void ValueDone();
+
+  // Checks that one more array or object may be nested
+  void PushLevel() {
+    if (stack_.size() >= max_depth_) {
+      Error(Describe(ParseErrorCode::TOO_DEEP));
+    }
+  }
+
+  void EndContainer(bool is_object);
+
+  [[noreturn]] void Error(const std::string& message) const {
+    throw std::runtime_error(message + " at offset " +
+                             std::to_string(offset_));
+  }
+
+  Handler& handler_;
+  State state_ = State::VALUE;
+  std::vector<Container> stack_;
+  size_t max_depth_ = JsonParser::kDefaultMaxDepth;
+
+  // The partial token at the end of the last chunk
+  Token token_ = Token::NONE;
+  std::string buffer_;
+  bool escape_pending_ = false;  // the partial string ends with a backslash
+
+  // Offset of the char being parsed, from the start of the input
+  size_t offset_ = 0;
+};
+
+template <typename Handler>
+void PushParser<Handler>::Feed(const char* p, size_t size) {
+  const char* const begin = p;
+  const char* const end = p + size;
+  const size_t chunk_offset = offset_;
+
+  if (token_ != Token::NONE) {
+    // finish the token from the previous chunk
+    const char* token_end = ScanToken(p, end);
+    if (!token_end) {
+      buffer_.append(p, end);
+      offset_ += size;
+      return;
+    }
+    buffer_.append(p, token_end);
+    // numbers and literals need a char after them
+    buffer_ += ' ';
+    token_ = Token::NONE;
+    EmitToken(&buffer_[0], &buffer_[0] + buffer_.size() - 1,
+              &buffer_[0] + buffer_.size());
+    buffer_.clear();
+    p = token_end;
+  }
+
+  while (p != end) {
+    offset_ = chunk_offset + (p - begin);
+    const char c = *p;
+    if (IsSpace(c)) {
+      ++p;
+      continue;
+    }
+    switch (c) {
+      case '{':
+        ExpectValue(false);
+        PushLevel();
+        handler_.StartObject();
+        stack_.push_back(Container{true, 0});
+        state_ = State::FIRST_KEY;
+        ++p;
+        break;
+      case '[':
+        ExpectValue(false);
+        PushLevel();
+        handler_.StartArray();
+        stack_.push_back(Container{false, 0});
+        state_ = State::FIRST_ELEMENT;
+        ++p;
+        break;
+      case '}':
+        EndContainer(true);
+        ++p;
+        break;
+      case ']':
+        EndContainer(false);
+        ++p;
+        break;
+      case ',':
+        if (state_ != State::AFTER_VALUE || stack_.empty()) {
+          Error("unexpected ','");
+        }
+        state_ = stack_.back().is_object ? State::KEY : State::VALUE;
+        ++p;
+        break;
+      case ':':
+        if (state_ != State::COLON) {
+          Error("unexpected ':'");
+        }
+        state_ = State::VALUE;
+        ++p;
+        break;
+      default: {
+        if (c == '"') {
+          token_ = Token::STRING;
+          escape_pending_ = false;
+        } else if (IsNumberChar(c)) {
+          token_ = Token::NUMBER;
+        } else if (IsLiteralChar(c)) {
+          token_ = Token::LITERAL;
+        } else {
+          Error("unexpected char '" + std::string(1, c) + "'");
+        }
+        ExpectValue(c == '"');
+
+        const char* token_end =
+            ScanToken(token_ == Token::STRING ? p + 1 : p, end);
+        if (!token_end) {
+          buffer_.assign(p, end);
+          offset_ = chunk_offset + size;
+          return;
+        }
+        token_ = Token::NONE;
+        EmitToken(p, token_end, end);
+        p = token_end;
+      }
+    }
+  }
+  offset_ = chunk_offset + size;
+}
+
+template <typename Handler>
+void PushParser<Handler>::Finish() {
+  if (token_ == Token::NUMBER || token_ == Token::LITERAL) {
+    buffer_ += ' ';
+    token_ = Token::NONE;
+    EmitToken(&buffer_[0], &buffer_[0] + buffer_.size() - 1,
+              &buffer_[0] + buffer_.size());
+    buffer_.clear();
+  }
+  if (token_ != Token::NONE || state_ != State::DONE) {
+    Error("unexpected end of input");
+  }
+}
+
+template <typename Handler>
+const char* PushParser<Handler>::ScanToken(const char* p, const char* end) {
+  switch (token_) {
+    case Token::STRING:
+      if (escape_pending_ && p != end) {
+        escape_pending_ = false;
+        ++p;
+      }
+      while (p != end) {
+        p = FindStringSpecialChar(p, end);
+        if (p == end) {
+          break;
+        }
+        if (*p == '"') {
+          return p + 1;
+        }
+        if (*p == '\\') {
+          if (p + 1 == end) {
+            escape_pending_ = true;
+            return nullptr;
+          }
+          p += 2;
+        } else {
+          // control chars are reported when the string is parsed
+          ++p;
+        }
+      }
+      return nullptr;
+    case Token::NUMBER:
+      while (p != end && IsNumberChar(*p)) {
+        ++p;
+      }
+      return p == end ? nullptr : p;
+    case Token::LITERAL:
+      while (p != end && IsLiteralChar(*p)) {
+        ++p;
+      }
+      return p == end ? nullptr : p;
+    case Token::NONE:
+      break;
+  }
+  assert(false);
+  return nullptr;
+}
+
+template <typename Handler>
+void PushParser<Handler>::EmitToken(const char* begin, const char* token_end,
+                                    const char* limit) {
+  assert(token_end < limit || *begin == '"');
+  const bool is_key = state_ == State::FIRST_KEY || state_ == State::KEY;
+  ScalarSink sink{*this};
+  const char* after = JsonParser{begin, limit}.ParseScalar(sink);
+  if (after != token_end) {
+    Error("invalid token '" + std::string(begin, token_end) + "'");
+  }
+  if (is_key) {
+    state_ = State::COLON;
+  } else {
+    ValueDone();
+  }
+}
+
+template <typename Handler>
+void PushParser<Handler>::ExpectValue(bool is_string) {
+  switch (state_) {
+    case State::VALUE:
+    case State::FIRST_ELEMENT:
+      return;
+    case State::FIRST_KEY:
+    case State::KEY:
+      if (is_string) {
+        return;
+      }
+      Error("expected a string key");
+    case State::DONE:
+      Error("unexpected value after the end of input");
+    default:
+      Error("expected ',' or the end of a container");
+  }
+}
+
+template <typename Handler>
+void PushParser<Handler>::ValueDone() {
+  if (stack_.empty()) {
+    state_ = State::DONE;
+    return;
+  }
+  ++stack_.back().size;
+  state_ = State::AFTER_VALUE;
+}
+
+template <typename Handler>
+void PushParser<Handler>::EndContainer(bool is_object) {
+  const State first = is_object ? State::FIRST_KEY : State::FIRST_ELEMENT;
+  if (stack_.empty() || stack_.back().is_object != is_object ||
+      (state_ != first && state_ != State::AFTER_VALUE)) {
+    Error(is_object ? "unexpected '}'" : "unexpected ']'");
+  }
+  const size_t size = stack_.back().size;
+  stack_.pop_back();
+  if (is_object) {
+    handler_.EndObject(size);
+  } else {
+    handler_.EndArray(size);
+  }
+  ValueDone();
+}
+}
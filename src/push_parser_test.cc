@@ -0,0 +1,128 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dom_builder.h"
+#include "json_parser.h"
+#include "push_parser.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+// Records the events of a parser as a string
+struct Recorder {
+  void StartObject() { events += "{"; }
+  void Key(StringRef key, bool) { events += key.str() + ":"; }
+  void EndObject(size_t n) { events += "}" + std::to_string(n) + " "; }
+  void StartArray() { events += "["; }
+  void EndArray(size_t n) { events += "]" + std::to_string(n) + " "; }
+  void String(StringRef str, bool) { events += "'" + str.str() + "' "; }
+  void Int64(int64_t num) { events += std::to_string(num) + " "; }
+  void Uint64(uint64_t num) { events += std::to_string(num) + "u "; }
+  void Number(double num) { events += std::to_string(num) + " "; }
+  void Bool(bool val) { events += val ? "true " : "false "; }
+  void Null() { events += "null "; }
+
+  string events;
+};
+
+string PushEvents(const string& json, size_t chunk_size) {
+  Recorder recorder;
+  PushParser<Recorder> parser{recorder};
+  for (size_t i = 0; i < json.size(); i += chunk_size) {
+    parser.Feed(json.data() + i, std::min(chunk_size, json.size() - i));
+  }
+  parser.Finish();
+  return recorder.events;
+}
+}
+
+TEST(PushParser, MatchesParser) {
+  const std::vector<string> jsons{
+      "{\"name\": \"Carl\", \"age\": -0.012e2, \"food\": [\"spa\\\"ghetti\", "
+      "true, false, null, 1234567], \"sub\": {\"a\\\\\": {}, \"b\": []}}",
+      "  12  ", "\"str\\n\"", "[[[]], [[1], 2]]", "null"};
+  for (const auto& json : jsons) {
+    Recorder expected;
+    JsonParser{json}.Parse(expected);
+    for (size_t chunk_size = 1; chunk_size <= json.size(); ++chunk_size) {
+      EXPECT_EQ(expected.events, PushEvents(json, chunk_size))
+          << json << " in chunks of " << chunk_size;
+    }
+  }
+}
+
+TEST(PushParser, InvalidJson) {
+  const std::vector<string> jsons{
+      ",",          "{\"a\":[ :}",   "{\"num\": 10, }", "{\"name\" }",
+      "{\"name....}", "[1 2]",      "[1.2.3]",         "[tru]",
+      "{1: 2}",     "[1] x",        "[1}",             "[\"\\q\"]",
+      "[",          "",             "[1,]",            "{\"a\" 1}"};
+  for (const auto& json : jsons) {
+    for (size_t chunk_size = 1; chunk_size <= json.size() + 1; ++chunk_size) {
+      EXPECT_THROW(PushEvents(json, chunk_size), std::exception)
+          << json << " in chunks of " << chunk_size;
+    }
+  }
+}
+
+TEST(PushParser, Dom) {
+  const string json = "{\"a\": [1, \"two\"], \"b\": {\"c\": true}}";
+  DomBuilder builder{nullptr, false};
+  PushParser<DomBuilder> parser{builder};
+  parser.Feed(json.substr(0, 9));
+  parser.Feed(json.substr(9));
+  parser.Finish();
+  EXPECT_EQ(json.size(), parser.offset());
+
+  JsonValue val = builder.TakeRoot();
+  const auto& obj = val.getObject();
+  EXPECT_EQ(1, obj.at("a").getArray()[0].getNumber());
+  EXPECT_EQ("two", obj.at("a").getArray()[1].getString());
+  EXPECT_TRUE(obj.at("b").getObject().at("c").getBool());
+}
+
+TEST(PushParser, MaxDepth) {
+  const string members = "{\"a\":{\"b\":[{}]}}";
+  Recorder recorder;
+  PushParser<Recorder> exact{recorder};
+  exact.set_max_depth(4);
+  exact.Feed(members);
+  EXPECT_NO_THROW(exact.Finish());
+
+  PushParser<Recorder> too_deep{recorder};
+  too_deep.set_max_depth(3);
+  EXPECT_THROW(too_deep.Feed(members), std::runtime_error);
+
+  // deeper than the default limit, fed a chunk at a time
+  const size_t depth = JsonParser::kDefaultMaxDepth + 1;
+  const string deep = string(depth, '[') + string(depth, ']');
+  DomBuilder builder{nullptr, false};
+  PushParser<DomBuilder> parser{builder};
+  try {
+    for (size_t i = 0; i < deep.size(); i += 100) {
+      parser.Feed(deep.data() + i, std::min<size_t>(100, deep.size() - i));
+    }
+    ADD_FAILURE();
+  } catch (const std::runtime_error& e) {
+    EXPECT_EQ("arrays and objects are nested too deeply at offset 1024",
+              string(e.what()));
+  }
+}
+
+TEST(PushParser, ValueAfterEnd) {
+  for (const string json : {"1 2", "{} []", "true null", "[] \"x\""}) {
+    try {
+      PushEvents(json, json.size());
+      ADD_FAILURE() << json;
+    } catch (const std::runtime_error& e) {
+      EXPECT_EQ(0, string(e.what()).find(
+                       "unexpected value after the end of input"))
+          << e.what();
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace jp {
+
+// A StringRef is a non-owning view of a sequence of chars, similar to
+// std::string_view. It doesn't have to be null terminated.
+class StringRef {
+ public:
+  StringRef() : data_(""), size_(0) {}
+  StringRef(const char* str) : data_(str), size_(std::strlen(str)) {}
+  StringRef(const char* data, size_t size) : data_(data), size_(size) {}
+  StringRef(const std::string& str) : data_(str.data()), size_(str.size()) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  size_t length() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+
+  char operator[](size_t i) const { return data_[i]; }
+
+  std::string str() const { return std::string(data_, size_); }
+  operator std::string() const { return str(); }
+
+  int compare(StringRef other) const {
+    const int cmp = std::memcmp(data_, other.data_, std::min(size_, other.size_));
+    if (cmp != 0) {
+      return cmp;
+    }
+    return size_ < other.size_ ? -1 : (size_ > other.size_ ? 1 : 0);
+  }
+
+  friend bool operator==(StringRef a, StringRef b) {
+    return a.size_ == b.size_ && std::memcmp(a.data_, b.data_, a.size_) == 0;
+  }
+  friend bool operator!=(StringRef a, StringRef b) { return !(a == b); }
+  friend bool operator<(StringRef a, StringRef b) { return a.compare(b) < 0; }
+
+  friend std::ostream& operator<<(std::ostream& os, StringRef s) {
+    return os.write(s.data_, s.size_);
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+// FNV-1a hash of the chars of a StringRef
+struct StringRefHash {
+  size_t operator()(StringRef s) const {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : s) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+};
+}
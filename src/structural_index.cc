@@ -0,0 +1,336 @@
+#include "structural_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "helpers.h"
+#include "utf8.h"
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+namespace jp {
+
+const size_t StructuralIndex::kMaxInputSize;
+
+namespace {
+
+const size_t kBlockSize = 64;
+
+// Bit i of each mask is set if the ith char of a block is of that class
+struct BlockMasks {
+  uint64_t backslash;
+  uint64_t quote;
+  uint64_t op;     // one of {}[]:,
+  uint64_t space;  // JSON whitespace
+  uint64_t non_ascii;
+};
+
+using ClassifyFn = void (*)(const char* block, BlockMasks* masks);
+
+enum CharClass : uint8_t {
+  kOther = 0,
+  kBackslash = 1,
+  kQuote = 2,
+  kOp = 3,
+  kSpace = 4,
+};
+
+struct CharClassTable {
+  CharClassTable() {
+    std::memset(classes, kOther, sizeof(classes));
+    classes[static_cast<uint8_t>('\\')] = kBackslash;
+    classes[static_cast<uint8_t>('"')] = kQuote;
+    for (const char c : {'{', '}', '[', ']', ':', ','}) {
+      classes[static_cast<uint8_t>(c)] = kOp;
+    }
+    for (const char c : {' ', '\t', '\n', '\r'}) {
+      classes[static_cast<uint8_t>(c)] = kSpace;
+    }
+  }
+  uint8_t classes[256];
+};
+
+const CharClassTable char_classes;
+
+void ClassifyScalar(const char* block, BlockMasks* masks) {
+  uint64_t m[5] = {0, 0, 0, 0, 0};
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    m[char_classes.classes[static_cast<uint8_t>(block[i])]] |= uint64_t{1}
+                                                               << i;
+  }
+  masks->backslash = m[kBackslash];
+  masks->quote = m[kQuote];
+  masks->op = m[kOp];
+  masks->space = m[kSpace];
+  masks->non_ascii = 0;
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    masks->non_ascii |= uint64_t(static_cast<uint8_t>(block[i]) >> 7) << i;
+  }
+}
+
+#if defined(__x86_64__)
+
+inline __m128i Eq(__m128i in, char c) {
+  return _mm_cmpeq_epi8(in, _mm_set1_epi8(c));
+}
+
+// SSE2 is part of x86-64, so it's always available
+void ClassifySse2(const char* block, BlockMasks* masks) {
+  *masks = BlockMasks{0, 0, 0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+    const __m128i op =
+        _mm_or_si128(_mm_or_si128(_mm_or_si128(Eq(in, '{'), Eq(in, '}')),
+                                  _mm_or_si128(Eq(in, '['), Eq(in, ']'))),
+                     _mm_or_si128(Eq(in, ':'), Eq(in, ',')));
+    const __m128i space =
+        _mm_or_si128(_mm_or_si128(Eq(in, ' '), Eq(in, '\t')),
+                     _mm_or_si128(Eq(in, '\n'), Eq(in, '\r')));
+    const int shift = 16 * i;
+    masks->backslash |= uint64_t(uint16_t(_mm_movemask_epi8(Eq(in, '\\'))))
+                        << shift;
+    masks->quote |= uint64_t(uint16_t(_mm_movemask_epi8(Eq(in, '"'))))
+                    << shift;
+    masks->op |= uint64_t(uint16_t(_mm_movemask_epi8(op))) << shift;
+    masks->space |= uint64_t(uint16_t(_mm_movemask_epi8(space))) << shift;
+    masks->non_ascii |= uint64_t(uint16_t(_mm_movemask_epi8(in))) << shift;
+  }
+}
+
+__attribute__((target("avx2"))) inline __m256i Eq(__m256i in, char c) {
+  return _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c));
+}
+
+__attribute__((target("avx2"))) void ClassifyAvx2(const char* block,
+                                                  BlockMasks* masks) {
+  *masks = BlockMasks{0, 0, 0, 0, 0};
+  for (int i = 0; i < 2; ++i) {
+    const __m256i in =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+    const __m256i op = _mm256_or_si256(
+        _mm256_or_si256(_mm256_or_si256(Eq(in, '{'), Eq(in, '}')),
+                        _mm256_or_si256(Eq(in, '['), Eq(in, ']'))),
+        _mm256_or_si256(Eq(in, ':'), Eq(in, ',')));
+    const __m256i space =
+        _mm256_or_si256(_mm256_or_si256(Eq(in, ' '), Eq(in, '\t')),
+                        _mm256_or_si256(Eq(in, '\n'), Eq(in, '\r')));
+    const int shift = 32 * i;
+    masks->backslash |= uint64_t(uint32_t(_mm256_movemask_epi8(Eq(in, '\\'))))
+                        << shift;
+    masks->quote |= uint64_t(uint32_t(_mm256_movemask_epi8(Eq(in, '"'))))
+                    << shift;
+    masks->op |= uint64_t(uint32_t(_mm256_movemask_epi8(op))) << shift;
+    masks->space |= uint64_t(uint32_t(_mm256_movemask_epi8(space))) << shift;
+    masks->non_ascii |= uint64_t(uint32_t(_mm256_movemask_epi8(in))) << shift;
+  }
+}
+
+#endif
+
+struct Classifier {
+  ClassifyFn classify;
+  const char* name;
+};
+
+const Classifier kClassifiers[] = {
+#if defined(__x86_64__)
+    {ClassifyAvx2, "avx2"},
+    {ClassifySse2, "sse2"},
+#endif
+    {ClassifyScalar, "scalar"},
+};
+
+bool IsSupported(const Classifier& classifier) {
+#if defined(__x86_64__)
+  if (classifier.classify == ClassifyAvx2) {
+    return __builtin_cpu_supports("avx2");
+  }
+#endif
+  return true;
+}
+
+// The classifier in use, the best one the CPU supports by default
+const Classifier*& CurrentClassifier() {
+  static const Classifier* classifier = []() {
+    for (const auto& c : kClassifiers) {
+      if (IsSupported(c)) {
+        return &c;
+      }
+    }
+    return &kClassifiers[0];
+  }();
+  return classifier;
+}
+
+// Sets every bit from the first set bit of x up to (not including) the next
+// set bit, and so on, e.g. 00100100 -> 00011100
+inline uint64_t PrefixXor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Finds the chars which are escaped by a backslash, i.e. which are preceded by
+// an odd number of backslashes. prev_escaped carries whether the first char of
+// the next block is escaped.
+inline uint64_t FindEscaped(uint64_t backslash, uint64_t& prev_escaped) {
+  if (!backslash) {
+    const uint64_t escaped = prev_escaped;
+    prev_escaped = 0;
+    return escaped;
+  }
+  // an escaped backslash doesn't start a new escape
+  backslash &= ~prev_escaped;
+  const uint64_t follows_escape = backslash << 1 | prev_escaped;
+
+  // runs of backslashes starting on an odd bit are cleared by the addition,
+  // so the carries tell where runs starting on an even bit end
+  const uint64_t even_bits = 0x5555555555555555ULL;
+  const uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+  uint64_t sequences_starting_on_even_bits;
+  prev_escaped = __builtin_add_overflow(odd_sequence_starts, backslash,
+                                        &sequences_starting_on_even_bits);
+  const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+}  // namespace
+
+void StructuralIndex::Reserve(size_t n) {
+  if (size_ + n <= capacity_) {
+    return;
+  }
+  const size_t capacity = std::max(capacity_ * 2, size_ + n);
+  std::unique_ptr<uint32_t[]> positions{new uint32_t[capacity]};
+  if (size_) {
+    std::memcpy(positions.get(), positions_.get(), size_ * sizeof(uint32_t));
+  }
+  positions_ = std::move(positions);
+  capacity_ = capacity;
+}
+
+void StructuralIndex::Build(const char* p, const char* end,
+                            bool validate_utf8) {
+  const size_t len = end - p;
+  if (len > kMaxInputSize) {
+    JP_THROW(std::length_error("input is too large to be indexed"));
+  }
+  const ClassifyFn classify = CurrentClassifier()->classify;
+
+  size_ = 0;
+  // a typical document has a token every 4-8 bytes
+  Reserve(len / 4 + kBlockSize);
+
+  uint64_t prev_escaped = 0;
+  uint64_t prev_in_string = 0;  // all ones if the previous block ended in one
+  uint64_t prev_scalar = 0;      // 1 if the previous block ended with a scalar
+  size_t first_non_ascii = len;  // offset of the block
+
+  char padded[kBlockSize];
+  for (size_t offset = 0; offset < len; offset += kBlockSize) {
+    const char* block = p + offset;
+    if (len - offset < kBlockSize) {
+      // the last block is padded with spaces
+      std::memset(padded, ' ', kBlockSize);
+      std::memcpy(padded, block, len - offset);
+      block = padded;
+    }
+
+    BlockMasks masks;
+    classify(block, &masks);
+    if (masks.non_ascii && first_non_ascii == len) {
+      first_non_ascii = offset;
+    }
+
+    const uint64_t escaped = FindEscaped(masks.backslash, prev_escaped);
+    const uint64_t quote = masks.quote & ~escaped;
+
+    // bits of the opening quote and the contents of strings are set, but not
+    // the closing quote
+    const uint64_t in_string = PrefixXor(quote) ^ prev_in_string;
+    prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+    const uint64_t scalar = ~(masks.op | masks.space | masks.quote) & ~in_string;
+    const uint64_t scalar_start = scalar & ~(scalar << 1 | prev_scalar);
+    prev_scalar = scalar >> 63;
+
+    uint64_t structurals =
+        (masks.op & ~in_string) | (quote & in_string) | scalar_start;
+
+    Reserve(kBlockSize);
+    uint32_t* out = positions_.get() + size_;
+    while (structurals) {
+      *out++ = static_cast<uint32_t>(offset + __builtin_ctzll(structurals));
+      structurals &= structurals - 1;
+    }
+    size_ = out - positions_.get();
+  }
+
+  // everything before the first block which isn't ASCII is valid, so that's
+  // where validating starts, if there is one
+  invalid_utf8_ = validate_utf8 && first_non_ascii != len
+                      ? ValidateUtf8(p + first_non_ascii, end) - p
+                      : len;
+}
+
+void StructuralIndex::Trim(size_t max_bytes) {
+  if (capacity_ * sizeof(uint32_t) > max_bytes) {
+    positions_.reset();
+    size_ = capacity_ = 0;
+  }
+}
+
+const char* StructuralIndex::Implementation() {
+  return CurrentClassifier()->name;
+}
+
+bool StructuralIndex::SetImplementation(const char* name) {
+  for (const auto& c : kClassifiers) {
+    if (std::strcmp(c.name, name) == 0 && IsSupported(c)) {
+      CurrentClassifier() = &c;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* FindStringSpecialChar(const char* p, const char* end,
+                                  bool non_ascii) {
+#if defined(__x86_64__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  // control chars are the ones below 0x20, i.e. max(c, 0x1f) == 0x1f
+  const __m128i control = _mm_set1_epi8(0x1f);
+  // the high bit of non-ASCII chars, if they're special
+  const __m128i high = _mm_set1_epi8(non_ascii ? static_cast<char>(0x80) : 0);
+  for (; end - p >= 16; p += 16) {
+    const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(in, quote), _mm_cmpeq_epi8(in, backslash)),
+        _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(in, control), control),
+                     _mm_and_si128(in, high)));
+    const int mask = _mm_movemask_epi8(special);
+    if (mask) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  const unsigned char high_bit = non_ascii ? 0x80 : 0;
+  for (; p != end; ++p) {
+    const unsigned char c = *p;
+    if (c == '"' || c == '\\' || c < 0x20 || (c & high_bit)) {
+      return p;
+    }
+  }
+  return end;
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <memory>
+
+namespace jp {
+
+// A StructuralIndex holds the offsets of every token of a JSON input: the
+// structural chars ({, }, [, ], :, ,), the opening quote of every string, and
+// the first char of every other scalar (numbers, true, false, null, and
+// anything invalid). Whitespace and the contents of strings are not indexed,
+// so a parser walking the index never has to look at them.
+//
+// The index is built in a single pass over the input, 64 bytes at a time.
+// Chars are classified with AVX2 or SSE2 instructions, depending on what the
+// CPU supports, or with a lookup table on other platforms.
+class StructuralIndex {
+ public:
+  // Inputs have to be smaller than this, as offsets are 32 bits
+  static const size_t kMaxInputSize = UINT32_MAX;
+
+  // Builds the index of [p, end), replacing the previous one. If
+  // validate_utf8 is true, the input is validated as UTF-8 too, which only
+  // takes another pass over it from the first char which isn't ASCII, if
+  // there's one.
+  void Build(const char* p, const char* end, bool validate_utf8 = false);
+
+  size_t size() const { return size_; }
+
+  // Offset of the first byte of the input which isn't valid UTF-8, or the
+  // size of the input if there's none, or if it wasn't validated
+  size_t invalid_utf8() const { return invalid_utf8_; }
+
+  // Frees the offsets, if there's room for more than max_bytes of them. The
+  // memory is otherwise kept for the next index.
+  void Trim(size_t max_bytes);
+  uint32_t operator[](size_t i) const { return positions_[i]; }
+
+  // Name of the char classifier in use: "avx2", "sse2" or "scalar"
+  static const char* Implementation();
+
+  // Forces the given classifier, e.g. to compare them in tests. Returns false
+  // if it's not supported on this CPU. Not thread safe.
+  static bool SetImplementation(const char* name);
+
+ private:
+  // Makes sure there's room for n more offsets
+  void Reserve(size_t n);
+
+  std::unique_ptr<uint32_t[]> positions_;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  size_t invalid_utf8_ = 0;
+};
+
+// Returns the first char in [p, end) which needs attention inside a string: a
+// quote, a backslash or a control char, or if non_ascii is true, also a char
+// which isn't ASCII. Returns end if there's none.
+const char* FindStringSpecialChar(const char* p, const char* end,
+                                  bool non_ascii = false);
+}
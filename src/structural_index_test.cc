@@ -0,0 +1,111 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "json_parser.h"
+#include "structural_index.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+// Straightforward char by char version of the index. Like in the index, a
+// backslash escapes the next char even outside of strings, which can only
+// happen in invalid JSON.
+static std::vector<uint32_t> ReferenceIndex(const string& json) {
+  std::vector<uint32_t> out;
+  bool in_string = false;
+  bool in_scalar = false;
+  bool escaped = false;
+  for (size_t i = 0; i < json.size(); ++i) {
+    const char c = json[i];
+    const bool quote = c == '"' && !escaped;
+    escaped = c == '\\' && !escaped;
+    if (in_string) {
+      in_string = !quote;
+      continue;
+    }
+    const bool op = c == '{' || c == '}' || c == '[' || c == ']' ||
+                    c == ':' || c == ',';
+    const bool space = c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    const bool scalar = !op && !space && c != '"';
+    if (quote) {
+      in_string = true;
+    }
+    if (quote || op || (scalar && !in_scalar)) {
+      out.push_back(i);
+    }
+    in_scalar = scalar;
+  }
+  return out;
+}
+
+static std::vector<uint32_t> Index(const string& json) {
+  StructuralIndex index;
+  index.Build(json.data(), json.data() + json.size());
+  std::vector<uint32_t> out;
+  for (size_t i = 0; i < index.size(); ++i) {
+    out.push_back(index[i]);
+  }
+  return out;
+}
+
+TEST(StructuralIndex, Simple) {
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 4, 6, 7, 8, 10, 14, 15, 16}),
+            Index("{\"a\": [1, true]}x"));
+}
+
+TEST(StructuralIndex, MatchesReference) {
+  const char alphabet[] = "{}[]:,\"\\\\ \n1a-";
+  std::mt19937 gen(42);
+  for (const char* impl : {"avx2", "sse2", "scalar"}) {
+    const string previous = StructuralIndex::Implementation();
+    if (!StructuralIndex::SetImplementation(impl)) {
+      continue;
+    }
+    for (int i = 0; i < 2000; ++i) {
+      string json(gen() % 300, ' ');
+      for (auto& c : json) {
+        c = alphabet[gen() % (sizeof(alphabet) - 1)];
+      }
+      EXPECT_EQ(ReferenceIndex(json), Index(json)) << impl << ": " << json;
+    }
+    StructuralIndex::SetImplementation(previous.c_str());
+  }
+}
+
+TEST(StructuralIndex, FindStringSpecialChar) {
+  const string s = string(40, 'a') + "\x01" + "\"";
+  EXPECT_EQ(s.data() + 40, FindStringSpecialChar(s.data(), s.data() + s.size()));
+  EXPECT_EQ(s.data() + 40, FindStringSpecialChar(s.data(), s.data() + 41));
+  EXPECT_EQ(s.data() + 30, FindStringSpecialChar(s.data(), s.data() + 30));
+
+  const string u = string(20, 'a') + "\xc3\xa9\"";
+  const char* end = u.data() + u.size();
+  EXPECT_EQ(u.data() + 22, FindStringSpecialChar(u.data(), end));
+  EXPECT_EQ(u.data() + 20, FindStringSpecialChar(u.data(), end, true));
+  EXPECT_EQ(u.data() + 21, FindStringSpecialChar(u.data() + 21, end, true));
+}
+
+TEST(JsonParser, IndexedInvalidJson) {
+  std::vector<string> jsons{"[1-2]", "[truex]", "[12a]", "[\"a\"b]",
+                            "{\"a\":1}x", "[1] 2", "[nul]", "\f[]"};
+  for (const auto& json : jsons) {
+    EXPECT_THROW(JsonParser{json}.Parse(), std::exception) << json;
+  }
+}
+
+TEST(JsonParser, LongStrings) {
+  // escapes and quotes around the 64 byte block boundaries
+  for (size_t n = 50; n < 140; ++n) {
+    const string key(n, 'k');
+    const string json =
+        "{\"" + key + "\\\\\": [\"" + string(n, 'v') + "\\\"\"], \"x\": 1}";
+    const auto obj = JsonParser{json}.Parse().getObject();
+    EXPECT_EQ(string(n, 'v') + "\"",
+              obj.at(key + "\\").getArray()[0].getString());
+    EXPECT_EQ(1, obj.at("x").getNumber());
+  }
+}
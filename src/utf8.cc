@@ -0,0 +1,282 @@
+#include "utf8.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace jp {
+
+namespace {
+
+using ValidateFn = const char* (*)(const char* p, const char* end);
+
+inline bool IsContinuation(char c) { return (c & 0xC0) == 0x80; }
+
+const char* ValidateScalar(const char* p, const char* end) {
+  while (p != end) {
+    // skip ASCII 8 bytes at a time
+    uint64_t word;
+    while (end - p >= 8 &&
+           (std::memcpy(&word, p, 8), (word & 0x8080808080808080ULL) == 0)) {
+      p += 8;
+    }
+    if (p == end) {
+      break;
+    }
+    const uint8_t c = *p;
+    if (c < 0x80) {
+      ++p;
+      continue;
+    }
+    // the length of the sequence, and the range of its second byte, which
+    // rules out overlong sequences, surrogates and code points which are too
+    // large
+    ptrdiff_t len;
+    uint8_t min = 0x80;
+    uint8_t max = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+      len = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+      len = 3;
+      min = c == 0xE0 ? 0xA0 : min;
+      max = c == 0xED ? 0x9F : max;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+      len = 4;
+      min = c == 0xF0 ? 0x90 : min;
+      max = c == 0xF4 ? 0x8F : max;
+    } else {
+      return p;
+    }
+    if (end - p < len) {
+      return p;
+    }
+    const uint8_t second = p[1];
+    if (second < min || second > max) {
+      return p;
+    }
+    for (ptrdiff_t i = 2; i < len; ++i) {
+      if (!IsContinuation(p[i])) {
+        return p;
+      }
+    }
+    p += len;
+  }
+  return end;
+}
+
+#if defined(__x86_64__)
+
+// What's wrong with a pair of consecutive bytes, as bits which are looked up
+// from the high nibble of the first byte, its low nibble, and the high nibble
+// of the second byte, and and-ed together
+const uint8_t kTooShort = 1 << 0;   // 11______ 0_______ or 11______ 11______
+const uint8_t kTooLong = 1 << 1;    // 0_______ 10______
+const uint8_t kOverlong3 = 1 << 2;  // 11100000 100_____
+const uint8_t kTooLarge = 1 << 3;   // 11110100 1001____, 11110101+ 10______
+const uint8_t kSurrogate = 1 << 4;  // 11101101 101_____
+const uint8_t kOverlong2 = 1 << 5;  // 1100000_ 10______
+const uint8_t kTooLarge1000 = 1 << 6;  // 11110101+ 1000____
+const uint8_t kOverlong4 = 1 << 6;     // 11110000 1000____
+const uint8_t kTwoConts = 1 << 7;      // 10______ 10______
+// the errors which only depend on the high nibble of the first byte
+const uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+const uint8_t kFirstHigh[16] = {
+    // 0_______ ________
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+    kTooLong,
+    // 10______ ________
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    // 1100____ ________
+    kTooShort | kOverlong2,
+    // 1101____ ________
+    kTooShort,
+    // 1110____ ________
+    kTooShort | kOverlong3 | kSurrogate,
+    // 1111____ ________
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4};
+
+const uint8_t kFirstLow[16] = {
+    // ____0000 ________
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    // ____0001 ________
+    kCarry | kOverlong2,
+    // ____001_ ________
+    kCarry, kCarry,
+    // ____0100 ________
+    kCarry | kTooLarge,
+    // ____0101 ________ and above
+    kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+    // ____1101 ________
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000};
+
+const uint8_t kSecondHigh[16] = {
+    // ________ 0_______
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooShort, kTooShort,
+    // ________ 1000____
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 |
+        kOverlong4,
+    // ________ 1001____
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    // ________ 101_____
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    // ________ 11______
+    kTooShort, kTooShort, kTooShort, kTooShort};
+
+// The largest byte which doesn't start a sequence that is cut off by the end
+// of a block of 32
+const uint8_t kMaxComplete[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+
+__attribute__((target("avx2"))) inline __m256i Table(const uint8_t* t) {
+  return _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));
+}
+
+__attribute__((target("avx2"))) inline __m256i HighNibbles(__m256i in) {
+  return _mm256_and_si256(_mm256_srli_epi16(in, 4), _mm256_set1_epi8(0x0F));
+}
+
+// The bytes of in, shifted by n bytes, with the last ones of prev shifted in
+template <int n>
+__attribute__((target("avx2"))) inline __m256i Prev(__m256i in, __m256i prev) {
+  return _mm256_alignr_epi8(in, _mm256_permute2x128_si256(prev, in, 0x21),
+                            16 - n);
+}
+
+// Validates [p, end) one byte at a time, to find where an error is, knowing
+// that everything before p is valid, except maybe a sequence which starts at
+// most 3 bytes before p, and continues after it. The validator starts at that
+// sequence, after the continuations of the one before it.
+const char* ValidateRest(const char* begin, const char* p, const char* end) {
+  const char* start = p - std::min<ptrdiff_t>(3, p - begin);
+  while (start != p && IsContinuation(*start)) {
+    ++start;
+  }
+  return ValidateScalar(start, end);
+}
+
+__attribute__((target("avx2"))) const char* ValidateAvx2(const char* p,
+                                                         const char* end) {
+  const __m256i first_high = Table(kFirstHigh);
+  const __m256i first_low = Table(kFirstLow);
+  const __m256i second_high = Table(kSecondHigh);
+  const __m256i max_complete =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kMaxComplete));
+
+  const char* const begin = p;
+  __m256i prev = _mm256_setzero_si256();
+  __m256i prev_incomplete = _mm256_setzero_si256();
+  char padded[32];
+  for (; p < end; p += 32) {
+    const char* block = p;
+    if (end - p < 32) {
+      // the last block is padded with ASCII
+      std::memset(padded, 0, sizeof(padded));
+      std::memcpy(padded, p, end - p);
+      block = padded;
+    }
+    const __m256i in =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i error = prev_incomplete;
+    if (_mm256_movemask_epi8(in)) {
+      const __m256i prev1 = Prev<1>(in, prev);
+      const __m256i special = _mm256_and_si256(
+          _mm256_and_si256(
+              _mm256_shuffle_epi8(first_high, HighNibbles(prev1)),
+              _mm256_shuffle_epi8(
+                  first_low, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+          _mm256_shuffle_epi8(second_high, HighNibbles(in)));
+      // the third and fourth bytes of sequences have to be continuations,
+      // which is the only case two continuations may follow each other
+      const __m256i must_continue = _mm256_and_si256(
+          _mm256_or_si256(
+              _mm256_subs_epu8(Prev<2>(in, prev), _mm256_set1_epi8(0x60)),
+              _mm256_subs_epu8(Prev<3>(in, prev), _mm256_set1_epi8(0x70))),
+          _mm256_set1_epi8(static_cast<char>(0x80)));
+      error = _mm256_xor_si256(must_continue, special);
+      prev_incomplete = _mm256_subs_epu8(in, max_complete);
+    } else {
+      prev_incomplete = _mm256_setzero_si256();
+    }
+    if (!_mm256_testz_si256(error, error)) {
+      // the error is in this block, or in a sequence starting before it
+      return ValidateRest(begin, p, end);
+    }
+    prev = in;
+    if (end - p <= 32) {
+      break;
+    }
+  }
+  // a sequence may be cut off by the end
+  if (!_mm256_testz_si256(prev_incomplete, prev_incomplete)) {
+    return ValidateRest(begin, p, end);
+  }
+  return end;
+}
+
+#endif
+
+struct Validator {
+  ValidateFn validate;
+  const char* name;
+};
+
+const Validator kValidators[] = {
+#if defined(__x86_64__)
+    {ValidateAvx2, "avx2"},
+#endif
+    {ValidateScalar, "scalar"},
+};
+
+bool IsSupported(const Validator& validator) {
+#if defined(__x86_64__)
+  if (validator.validate == ValidateAvx2) {
+    return __builtin_cpu_supports("avx2");
+  }
+#endif
+  return true;
+}
+
+// The validator in use, the best one the CPU supports by default
+const Validator*& CurrentValidator() {
+  static const Validator* validator = []() {
+    for (const auto& v : kValidators) {
+      if (IsSupported(v)) {
+        return &v;
+      }
+    }
+    return &kValidators[0];
+  }();
+  return validator;
+}
+
+}  // namespace
+
+const char* ValidateUtf8(const char* p, const char* end) {
+  return CurrentValidator()->validate(p, end);
+}
+
+const char* Utf8Implementation() { return CurrentValidator()->name; }
+
+bool SetUtf8Implementation(const char* name) {
+  for (const auto& v : kValidators) {
+    if (std::strcmp(v.name, name) == 0 && IsSupported(v)) {
+      CurrentValidator() = &v;
+      return true;
+    }
+  }
+  return false;
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace jp {
+
+// Returns the first byte of [p, end) which starts an invalid UTF-8 sequence,
+// or which is a continuation byte without one, or end if it's all valid.
+// Sequences which are cut off by end are invalid, and so are overlong ones,
+// surrogates, and code points above U+10FFFF, as per RFC 3629.
+//
+// If the CPU supports AVX2, it's validated 32 bytes at a time, with ASCII
+// skipped and everything else checked with the lookup algorithm of
+// "Validating UTF-8 In Less Than One Instruction Per Byte" by John Keiser and
+// Daniel Lemire. Otherwise ASCII is skipped 8 bytes at a time, and everything
+// else is validated one byte at a time.
+const char* ValidateUtf8(const char* p, const char* end);
+
+// Name of the validator in use: "avx2" or "scalar"
+const char* Utf8Implementation();
+
+// Forces the given validator, e.g. to compare them in tests. Returns false if
+// it's not supported on this CPU. Not thread safe.
+bool SetUtf8Implementation(const char* name);
+
+// The replacement char U+FFFD, for what can't be decoded
+const uint32_t kReplacementChar = 0xFFFD;
+
+inline bool IsHighSurrogate(uint32_t code_point) {
+  return code_point >= 0xD800 && code_point <= 0xDBFF;
+}
+
+inline bool IsLowSurrogate(uint32_t code_point) {
+  return code_point >= 0xDC00 && code_point <= 0xDFFF;
+}
+
+// Writes code_point, which mustn't be above U+10FFFF, to out as UTF-8, and
+// returns the number of bytes written, up to 4
+inline size_t EncodeUtf8(uint32_t code_point, char* out) {
+  if (code_point < 0x80) {
+    out[0] = static_cast<char>(code_point);
+    return 1;
+  }
+  if (code_point < 0x800) {
+    out[0] = static_cast<char>(0xC0 | code_point >> 6);
+    out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+    return 2;
+  }
+  if (code_point < 0x10000) {
+    out[0] = static_cast<char>(0xE0 | code_point >> 12);
+    out[1] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+    out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+    return 3;
+  }
+  out[0] = static_cast<char>(0xF0 | code_point >> 18);
+  out[1] = static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+  out[2] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+  out[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+  return 4;
+}
+}
@@ -0,0 +1,98 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utf8.h"
+
+using namespace ::testing;
+using namespace jp;
+using std::string;
+
+namespace {
+
+// Offset of the first invalid byte of s, with each implementation, which
+// have to agree
+size_t FirstInvalid(const string& s) {
+  const string previous = Utf8Implementation();
+  size_t offset = string::npos;
+  for (const char* impl : {"avx2", "scalar"}) {
+    if (!SetUtf8Implementation(impl)) {
+      continue;
+    }
+    const size_t impl_offset =
+        ValidateUtf8(s.data(), s.data() + s.size()) - s.data();
+    if (offset != string::npos) {
+      EXPECT_EQ(offset, impl_offset) << impl;
+    }
+    offset = impl_offset;
+  }
+  SetUtf8Implementation(previous.c_str());
+  return offset;
+}
+
+string Encode(uint32_t code_point) {
+  char buf[4];
+  return string(buf, EncodeUtf8(code_point, buf));
+}
+}
+
+TEST(Utf8, Valid) {
+  for (const string s :
+       {"", "abc", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+        "\xed\x9f\xbf", "\xee\x80\x80", "\xf4\x8f\xbf\xbf", "\xc2\x80"}) {
+    EXPECT_EQ(s.size(), FirstInvalid(s)) << s;
+    // at the end of a long input, and across a block boundary
+    for (size_t prefix : {31, 33, 62, 100}) {
+      EXPECT_EQ(prefix + s.size(), FirstInvalid(string(prefix, 'a') + s));
+    }
+  }
+}
+
+TEST(Utf8, Invalid) {
+  // overlong, surrogates, too large, stray continuations, and cut short
+  for (const string s :
+       {"\xc0\xaf", "\xc1\xbf", "\xe0\x9f\xbf", "\xf0\x8f\xbf\xbf",
+        "\xed\xa0\x80", "\xed\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80",
+        "\xff", "\x80", "\xbf", "\xc3", "\xe2\x82", "\xf0\x9f\x98", "\xc3\x41",
+        "\xe2\x82\x41", "\xc3\xa9\xa9"}) {
+    const size_t offset = s.size() == 3 && s[0] == '\xc3' ? 2 : 0;
+    EXPECT_EQ(offset, FirstInvalid(s)) << s;
+    for (size_t prefix : {30, 31, 32, 63, 100}) {
+      const string prefixed = string(prefix - 2, 'a') + "\xc3\xa9" + s + "abc";
+      EXPECT_EQ(prefix + offset, FirstInvalid(prefixed)) << prefix << s;
+    }
+  }
+}
+
+TEST(Utf8, MatchesScalar) {
+  std::mt19937 gen(42);
+  const uint32_t ranges[][2] = {
+      {0x20, 0x7F}, {0x80, 0x7FF}, {0x800, 0xFFFF}, {0x10000, 0x10FFFF}};
+  for (int i = 0; i < 2000; ++i) {
+    string s;
+    while (s.size() < gen() % 300) {
+      const auto& range = ranges[gen() % 4];
+      const uint32_t code_point =
+          range[0] + gen() % (range[1] - range[0] + 1);
+      if (!(IsHighSurrogate(code_point) || IsLowSurrogate(code_point))) {
+        s += Encode(code_point);
+      }
+    }
+    EXPECT_EQ(s.size(), FirstInvalid(s));
+
+    // corrupting a byte, which most of the time makes it invalid
+    if (!s.empty()) {
+      s[gen() % s.size()] = static_cast<char>(gen());
+      FirstInvalid(s);
+    }
+  }
+}
+
+TEST(Utf8, Encode) {
+  EXPECT_EQ("A", Encode('A'));
+  EXPECT_EQ("\xc3\xa9", Encode(0xE9));
+  EXPECT_EQ("\xef\xbf\xbd", Encode(kReplacementChar));
+  EXPECT_EQ("\xf0\x9f\x98\x80", Encode(0x1F600));
+}